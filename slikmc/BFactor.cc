@@ -8,6 +8,7 @@
 #include "BFactor.h"
 #include "PConstants.h"
 #include <cmath>
+#include <assert.h>
 #include "Utility.h"
 
 BFactor::BFactor(PProtein* chain) {
@@ -50,6 +51,15 @@ BFactor::BFactor(PProtein* chain) {
 			this->atom_bfactors[i].push_back( atom->getTempFactor());
 			this->atom_variance[i].push_back( atom->getTempFactor() / (8 * PI * PI));
 		}
+		//N, CA and C are the first three atoms of every residue.
+		for( int j = 0; j < 3; j++) {
+			double variance = this->atom_variance[i][j];
+			this->ref_x.push_back( this->atom_pos[i][j].x);
+			this->ref_y.push_back( this->atom_pos[i][j].y);
+			this->ref_z.push_back( this->atom_pos[i][j].z);
+			this->half_inv_variance.push_back( 0.5 / variance);
+			this->log_norm.push_back( -0.5 * log( 2 * PI * variance));
+		}
 	}
 	return;
 }
@@ -60,18 +70,79 @@ double BFactor::evalAtomPositions(PProtein* chain, const int s, const int e) {
 //	assert( chain->IsSubChainOf( this->protein) || chain->getTopLevelChain() == NULL);
 	Debug::check( e - s + 1 == chain->size(), "indices and subchain size doesn't match");
 
-	int index_start = s;
-	//logged probability density;
+	BFactor::getBackbonePositions( chain, this->pos_x, this->pos_y, this->pos_z);
+	return this->evalBackbone( &this->pos_x[0], &this->pos_y[0], &this->pos_z[0], s, e);
+}
+
+double BFactor::evalResidue( PResidue* residue, const int index) {
+	double x[3], y[3], z[3];
+	const string* ids[3] = { &PID::N, &PID::C_ALPHA, &PID::C};
+	for( int j = 0; j < 3; j++) {
+		Vector3 pos = residue->getAtomPosition( *ids[j]);
+		x[j] = pos.x;
+		y[j] = pos.y;
+		z[j] = pos.z;
+	}
+	return this->evalBackbone( x, y, z, index, index);
+}
+
+double BFactor::evalBackbone(const double* x, const double* y, const double* z, const int s, const int e) const {
+	assert( s >= 0 && s <= e && 3 * (e + 1) <= this->log_norm.size());
+	const int n = 3 * (e - s + 1);
+	const double* rx = &this->ref_x[3 * s];
+	const double* ry = &this->ref_y[3 * s];
+	const double* rz = &this->ref_z[3 * s];
+	const double* h = &this->half_inv_variance[3 * s];
+	const double* c = &this->log_norm[3 * s];
+
+	//Four independent partial sums, so that the compiler maps the loop to SIMD lanes without reordering a single sum.
+	double sum[4] = { 0, 0, 0, 0};
+	int k = 0;
+	for( ; k + 4 <= n; k += 4) {
+		for( int l = 0; l < 4; l++) {
+			double dx = x[k + l] - rx[k + l];
+			double dy = y[k + l] - ry[k + l];
+			double dz = z[k + l] - rz[k + l];
+			sum[l] += c[k + l] - h[k + l] * (dx * dx + dy * dy + dz * dz);
+		}
+	}
+	for( ; k < n; k++) {
+		double dx = x[k] - rx[k];
+		double dy = y[k] - ry[k];
+		double dz = z[k] - rz[k];
+		sum[0] += c[k] - h[k] * (dx * dx + dy * dy + dz * dz);
+	}
+	return (sum[0] + sum[1]) + (sum[2] + sum[3]);
+}
+
+void BFactor::getBackbonePositions(PChain* chain, vector<double>& x, vector<double>& y, vector<double>& z) {
+	int n = 3 * chain->size();
+	x.resize( n);
+	y.resize( n);
+	z.resize( n);
+	const string* ids[3] = { &PID::N, &PID::C_ALPHA, &PID::C};
+	for( int i = 0; i < chain->size(); i++) {
+		HASH_MAP_STR(PAtom *)* atom_map = chain->getResidue(i)->getAtomMap();
+		for( int j = 0; j < 3; j++) {
+			//One lookup per atom; PResidue::getAtom() hashes the name twice.
+			Vector3 pos = atom_map->find( *ids[j])->second->getPos();
+			x[3 * i + j] = pos.x;
+			y[3 * i + j] = pos.y;
+			z[3 * i + j] = pos.z;
+		}
+	}
+}
+
+double BFactor::evalAtomPositionsReference(PProtein* chain, const int s, const int e) {
+	Debug::check( e - s + 1 == chain->size(), "indices and subchain size doesn't match");
 	double log_pd = 0;
 	for( int i = 0; i < chain->size(); i++) {
 		PResidue* residue = chain->getResidue(i);
+		int index = s + i;
 		Vector3 N = residue->getAtomPosition( PID::N);
 		Vector3 Ca = residue->getAtomPosition( PID::C_ALPHA);
 		Vector3 C = residue->getAtomPosition( PID::C);
 
-		//Get the global index in the vectors
-		int index = index_start + i;
-
 		double d_N = (N - this->atom_pos[index][0]).norm();
 		double p_d_N = this->getProbDensity_log( 0, this->atom_variance[index][0], d_N);
 
@@ -81,7 +152,7 @@ double BFactor::evalAtomPositions(PProtein* chain, const int s, const int e) {
 		double d_C = (C - this->atom_pos[index][2]).norm();
 		double p_d_C = this->getProbDensity_log( 0, this->atom_variance[index][2], d_C);
 
-		log_pd += ( p_d_N + p_d_Ca + p_d_C);
+		log_pd += p_d_N + p_d_Ca + p_d_C;
 	}
 	return log_pd;
 }
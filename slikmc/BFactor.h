@@ -31,6 +31,36 @@ public:
 	 */
 	double evalAtomPositions( PProtein* chain, const int s, const int e);
 
+	/**
+	 * @brief Evaluate the backbone atoms of one residue according to B-factors.
+	 * @param residue the residue to be evaluated
+	 * @param index index of the residue in the top level chain
+	 * @return products of probability densities of the residue's backbone atoms in logarithm
+	 */
+	double evalResidue( PResidue* residue, const int index);
+
+	/**
+	 * @brief Evaluate the backbone atoms of residues s to e from a coordinate buffer.
+	 * @param x x coordinates of the backbone atoms: N, CA and C of residue s + i at 3i, 3i + 1 and 3i + 2
+	 * @param y y coordinates in the same layout
+	 * @param z z coordinates in the same layout
+	 * @param s index of starting residue in the top level chain
+	 * @param e index of ending residue in the top level chain
+	 * @return products of probability densities of the backbone atoms in logarithm
+	 */
+	double evalBackbone( const double* x, const double* y, const double* z, const int s, const int e) const;
+
+	/**
+	 * @brief Reference implementation of evalAtomPositions(), evaluating every atom through getProbDensity_log().
+	 * Used to check and benchmark the kernel.
+	 */
+	double evalAtomPositionsReference( PProtein* chain, const int s, const int e);
+
+	/**
+	 * @brief Get the backbone atom coordinates of a chain in the layout of evalBackbone().
+	 */
+	static void getBackbonePositions( PChain* chain, vector<double>& x, vector<double>& y, vector<double>& z);
+
 	/**
 	 * @brief Output atom positions and their B-factors to a file
 	 * @param filename output filename
@@ -43,6 +73,28 @@ private:
 	vector< vector<double> > atom_bfactors;
 	vector< vector<double> > atom_variance;
 
+	/*
+	 * Backbone atoms of the top level chain as structure of arrays: N, CA and C of residue i
+	 * are the entries 3i, 3i + 1 and 3i + 2.
+	 */
+	vector<double> ref_x;
+	vector<double> ref_y;
+	vector<double> ref_z;
+	/**
+	 * @brief 1 / (2 * variance) of every backbone atom
+	 */
+	vector<double> half_inv_variance;
+	/**
+	 * @brief log( 1 / sqrt( 2 * PI * variance)) of every backbone atom
+	 */
+	vector<double> log_norm;
+	/**
+	 * @brief Backbone coordinates of the chain being evaluated, reused by every evaluation
+	 */
+	vector<double> pos_x;
+	vector<double> pos_y;
+	vector<double> pos_z;
+
 	/**
 	 * @brief Evaluate probability density of an atom position given desired atom position and B-factor.
 	 * @param mean desired atom position
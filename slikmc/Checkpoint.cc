@@ -0,0 +1,183 @@
+/*
+ * Checkpoint.cc
+ *
+ *  Created on: Oct 17, 2026
+ */
+
+#include "Checkpoint.h"
+#include "PExtension.h"
+#include "Utility.h"
+#include <stdint.h>
+#include <string.h>
+#include <stdio.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/stat.h>
+
+static const char CHECKPOINT_MAGIC[8] = { 'S', 'L', 'I', 'K', 'C', 'K', 'P', '1'};
+static const uint32_t CHECKPOINT_VERSION = 2;
+
+/**
+ * @brief File header, followed by the record.
+ */
+struct CheckpointHeader {
+	char magic[8];
+	uint32_t version;
+	uint32_t reserved;
+	uint64_t size;
+	uint64_t checksum;
+};
+
+/**
+ * @brief 64-bit FNV-1a hash of the record.
+ */
+static uint64_t checksum( const char* data, const size_t n) {
+	uint64_t h = 14695981039346656037ULL;
+	for( size_t i = 0; i < n; i++) {
+		h ^= (unsigned char)data[i];
+		h *= 1099511628211ULL;
+	}
+	return h;
+}
+
+Checkpoint::Checkpoint(const string& filename) {
+	this->filename = filename;
+	this->position = 0;
+}
+
+const string& Checkpoint::getFilename() const {
+	return this->filename;
+}
+
+void Checkpoint::clear() {
+	//Keep the capacity, so the buffer is allocated only once.
+	this->buffer.clear();
+	this->position = 0;
+}
+
+void Checkpoint::put(const void* data, const size_t n) {
+	const char* p = (const char*)data;
+	this->buffer.insert( this->buffer.end(), p, p + n);
+}
+
+void Checkpoint::putPositions(PProtein* chain) {
+	int num_atoms = 0;
+	for( int i = 0; i < chain->size(); i++) {
+		num_atoms += chain->getResidue(i)->getAtoms()->size();
+	}
+	this->put( num_atoms);
+	for( int i = 0; i < chain->size(); i++) {
+		vector<PAtom*>* atoms = chain->getResidue(i)->getAtoms();
+		for( int j = 0; j < atoms->size(); j++) {
+			Vector3 pos = (*atoms)[j]->getPos();
+			double xyz[3] = { pos.x, pos.y, pos.z};
+			this->put( xyz, sizeof( xyz));
+		}
+	}
+}
+
+bool Checkpoint::commit() {
+	CheckpointHeader header;
+	memcpy( header.magic, CHECKPOINT_MAGIC, sizeof( header.magic));
+	header.version = CHECKPOINT_VERSION;
+	header.reserved = 0;
+	header.size = this->buffer.size();
+	header.checksum = checksum( this->buffer.empty() ? NULL : &this->buffer[0], this->buffer.size());
+
+	string tmp = this->filename + ".tmp";
+	int fd = open( tmp.c_str(), O_WRONLY | O_CREAT | O_TRUNC, 0644);
+	if( fd < 0)
+		return false;
+	bool ok = Utility::writeFully( fd, &header, sizeof( CheckpointHeader));
+	if( ok && !this->buffer.empty())
+		ok = Utility::writeFully( fd, &this->buffer[0], this->buffer.size());
+	//The data must be on disk before the rename makes them the latest checkpoint.
+	ok = ok && fsync( fd) == 0;
+	ok = close( fd) == 0 && ok;
+	if( !ok) {
+		unlink( tmp.c_str());
+		return false;
+	}
+
+	string prev = this->filename + ".prev";
+	if( this->exists() && rename( this->filename.c_str(), prev.c_str()) != 0)
+		return false;
+	if( rename( tmp.c_str(), this->filename.c_str()) != 0)
+		return false;
+
+	//Make the renames durable as well.
+	size_t slash = this->filename.find_last_of( '/');
+	string dir = slash == string::npos ? "." : this->filename.substr( 0, slash + 1);
+	int dir_fd = open( dir.c_str(), O_RDONLY);
+	if( dir_fd >= 0) {
+		fsync( dir_fd);
+		close( dir_fd);
+	}
+	return true;
+}
+
+bool Checkpoint::exists() const {
+	struct stat st;
+	return stat( this->filename.c_str(), &st) == 0;
+}
+
+bool Checkpoint::load() {
+	if( this->loadFile( this->filename))
+		return true;
+	if( this->loadFile( this->filename + ".prev")) {
+		cerr << "Checkpoint " << this->filename << " is damaged, resuming from the previous checkpoint" << endl;
+		return true;
+	}
+	this->clear();
+	return false;
+}
+
+bool Checkpoint::loadFile(const string& filename) {
+	int fd = open( filename.c_str(), O_RDONLY);
+	if( fd < 0)
+		return false;
+	CheckpointHeader header;
+	bool ok = Utility::readFully( fd, &header, sizeof( CheckpointHeader));
+	ok = ok && memcmp( header.magic, CHECKPOINT_MAGIC, sizeof( header.magic)) == 0 && header.version == CHECKPOINT_VERSION;
+	if( ok) {
+		this->buffer.resize( header.size);
+		this->position = 0;
+		if( header.size > 0)
+			ok = Utility::readFully( fd, &this->buffer[0], header.size);
+		ok = ok && checksum( header.size > 0 ? &this->buffer[0] : NULL, header.size) == header.checksum;
+	}
+	close( fd);
+	return ok;
+}
+
+bool Checkpoint::get(void* data, const size_t n) {
+	if( this->position + n > this->buffer.size())
+		return false;
+	if( n > 0)
+		memcpy( data, &this->buffer[this->position], n);
+	this->position += n;
+	return true;
+}
+
+bool Checkpoint::getPositions(PProtein* chain) {
+	int num_atoms = 0;
+	if( !this->get( num_atoms))
+		return false;
+	int count = 0;
+	for( int i = 0; i < chain->size(); i++) {
+		count += chain->getResidue(i)->getAtoms()->size();
+	}
+	if( count != num_atoms)
+		return false;
+	for( int i = 0; i < chain->size(); i++) {
+		vector<PAtom*>* atoms = chain->getResidue(i)->getAtoms();
+		for( int j = 0; j < atoms->size(); j++) {
+			double xyz[3];
+			if( !this->get( xyz, sizeof( xyz)))
+				return false;
+			(*atoms)[j]->changePosition_nonGridUpdate( Vector3( xyz[0], xyz[1], xyz[2]));
+		}
+	}
+	chain->updateAtomsGrid();
+	return true;
+}
@@ -0,0 +1,117 @@
+/*
+ * Checkpoint.h
+ *
+ *  Created on: Oct 17, 2026
+ */
+
+#ifndef CHECKPOINT_H_
+#define CHECKPOINT_H_
+
+#include "PProtein.h"
+#include <vector.h>
+#include <string>
+using namespace std;
+
+/**
+ * @brief A checkpoint of a sampling run, used to resume a Markov chain after the job is interrupted.
+ *
+ * A sampler serializes its state into the record with the put() functions and saves it with commit();
+ * after load() the values are read back with the get() functions in the same order.
+ *
+ * The record is assembled in a memory buffer that is reused by every checkpoint. commit() writes it to
+ * <filename>.tmp, flushes it to disk and renames it over <filename>, after keeping the previous checkpoint as
+ * <filename>.prev. A rename is atomic, therefore a crash at any point leaves at least one complete checkpoint.
+ * load() verifies the checksum and falls back to <filename>.prev if the latest checkpoint is damaged.
+ */
+class Checkpoint {
+public:
+	/**
+	 * @brief Constructor
+	 * @param filename name of the checkpoint file
+	 */
+	Checkpoint( const string& filename);
+
+	const string& getFilename() const;
+
+	/**
+	 * @brief Start a new record.
+	 */
+	void clear();
+
+	/**
+	 * @brief Append n bytes to the record.
+	 */
+	void put( const void* data, const size_t n);
+
+	/**
+	 * @brief Append a value of plain data type to the record.
+	 */
+	template<class T> void put( const T& value) {
+		this->put( &value, sizeof( T));
+	}
+
+	/**
+	 * @brief Append a vector of plain data type, preceded by its size.
+	 */
+	template<class T> void putVector( const vector<T>& values) {
+		int size = values.size();
+		this->put( size);
+		if( size > 0)
+			this->put( &values[0], size * sizeof( T));
+	}
+
+	/**
+	 * @brief Append the positions of all atoms of a chain.
+	 */
+	void putPositions( PProtein* chain);
+
+	/**
+	 * @brief Save the record to disk atomically.
+	 * @return true if the checkpoint is written
+	 */
+	bool commit();
+
+	/**
+	 * @brief Check if a checkpoint exists on disk.
+	 */
+	bool exists() const;
+
+	/**
+	 * @brief Load the latest valid checkpoint from disk and rewind the record.
+	 * @return true if a valid checkpoint is found
+	 */
+	bool load();
+
+	/**
+	 * @brief Read the next n bytes of the record.
+	 * @return false if the record has fewer bytes left
+	 */
+	bool get( void* data, const size_t n);
+
+	template<class T> bool get( T& value) {
+		return this->get( &value, sizeof( T));
+	}
+
+	template<class T> bool getVector( vector<T>& values) {
+		int size = 0;
+		if( !this->get( size) || size < 0)
+			return false;
+		values.resize( size);
+		return size == 0 || this->get( &values[0], size * sizeof( T));
+	}
+
+	/**
+	 * @brief Read back the atom positions saved by putPositions() into a chain of the same topology and update its grid.
+	 * @return false if the number of atoms does not match
+	 */
+	bool getPositions( PProtein* chain);
+
+private:
+	bool loadFile( const string& filename);
+
+	string filename;
+	vector<char> buffer;
+	size_t position;
+};
+
+#endif /* CHECKPOINT_H_ */
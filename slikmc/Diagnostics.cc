@@ -0,0 +1,260 @@
+/*
+ * Diagnostics.cc
+ *
+ *  Created on: Oct 17, 2026
+ */
+
+#include "Diagnostics.h"
+#include "DihedralAngle.h"
+#include "Checkpoint.h"
+#include "Utility.h"
+#include <math.h>
+#include <limits>
+#include <sys/mman.h>
+
+ConvergenceMonitor::ConvergenceMonitor() {
+	this->reset( 0, -1);
+}
+
+void ConvergenceMonitor::reset(const int s, const int e) {
+	this->num_torsions = 2 * (e - s + 1);
+	this->count = 0;
+	this->batch_size = 1;
+	this->in_batch = 0;
+	this->num_batches = 0;
+	this->reference.assign( this->num_torsions, 0);
+	this->current_sum.assign( this->num_torsions, 0);
+	this->current_sumsq.assign( this->num_torsions, 0);
+	this->batch_sum.assign( MAX_BATCHES * this->num_torsions, 0);
+	this->batch_sumsq.assign( MAX_BATCHES * this->num_torsions, 0);
+	this->s = s;
+}
+
+void ConvergenceMonitor::add(PProtein* protein) {
+	int T = this->num_torsions;
+	for( int i = 0; i < T / 2; i++) {
+		DihedralAngle da;
+		protein->getDihedralAngleAtResidue( this->s + i, da);
+		double angles[2] = { da.phi, da.psi};
+		for( int a = 0; a < 2; a++) {
+			int k = 2 * i + a;
+			if( this->count == 0)
+				this->reference[k] = angles[a];
+			//Unwrap to (-180, 180] around the reference angle.
+			double x = fmod( angles[a] - this->reference[k], 360.0);
+			if( x > 180) x -= 360;
+			else if( x <= -180) x += 360;
+			this->current_sum[k] += x;
+			this->current_sumsq[k] += x * x;
+		}
+	}
+	this->count += 1;
+	this->in_batch += 1;
+	if( this->in_batch < this->batch_size)
+		return;
+
+	for( int k = 0; k < T; k++) {
+		this->batch_sum[this->num_batches * T + k] = this->current_sum[k];
+		this->batch_sumsq[this->num_batches * T + k] = this->current_sumsq[k];
+		this->current_sum[k] = 0;
+		this->current_sumsq[k] = 0;
+	}
+	this->in_batch = 0;
+	this->num_batches += 1;
+	if( this->num_batches < MAX_BATCHES)
+		return;
+
+	//All batches are full: merge neighbours and double the batch size.
+	for( int b = 0; b < MAX_BATCHES / 2; b++) {
+		for( int k = 0; k < T; k++) {
+			this->batch_sum[b * T + k] = this->batch_sum[2 * b * T + k] + this->batch_sum[(2 * b + 1) * T + k];
+			this->batch_sumsq[b * T + k] = this->batch_sumsq[2 * b * T + k] + this->batch_sumsq[(2 * b + 1) * T + k];
+		}
+	}
+	this->num_batches = MAX_BATCHES / 2;
+	this->batch_size *= 2;
+}
+
+int ConvergenceMonitor::getNumTorsions() const {
+	return this->num_torsions;
+}
+
+long ConvergenceMonitor::getSamples() const {
+	return this->count;
+}
+
+void ConvergenceMonitor::summarize(TorsionSummary* summaries) const {
+	int T = this->num_torsions;
+	//Batches of a single sample say nothing about autocorrelation, wait for the first merge.
+	int B = this->batch_size > 1 ? this->num_batches - this->num_batches % 2 : 0;
+	for( int k = 0; k < T; k++) {
+		TorsionSummary& summary = summaries[k];
+		summary.n = 0;
+		summary.mean[0] = summary.mean[1] = 0;
+		summary.var[0] = summary.var[1] = 0;
+		summary.ess = 0;
+		if( B == 0)
+			continue;
+
+		double b_size = (double)this->batch_size;
+		double n_half = (B / 2) * b_size;
+		double sum[2] = { 0, 0};
+		double sumsq[2] = { 0, 0};
+		for( int b = 0; b < B; b++) {
+			int h = b < B / 2 ? 0 : 1;
+			sum[h] += this->batch_sum[b * T + k];
+			sumsq[h] += this->batch_sumsq[b * T + k];
+		}
+		for( int h = 0; h < 2; h++) {
+			summary.mean[h] = sum[h] / n_half;
+			summary.var[h] = max( 0.0, (sumsq[h] - n_half * summary.mean[h] * summary.mean[h]) / (n_half - 1));
+		}
+
+		double n = 2 * n_half;
+		double mean = (sum[0] + sum[1]) / n;
+		double var = max( 0.0, (sumsq[0] + sumsq[1] - n * mean * mean) / (n - 1));
+		double var_batch = 0;
+		for( int b = 0; b < B; b++) {
+			double d = this->batch_sum[b * T + k] / b_size - mean;
+			var_batch += d * d;
+		}
+		//Asymptotic variance of the mean estimated by batch means.
+		double var_asymptotic = b_size * var_batch / (B - 1);
+		summary.n = (long)n;
+		summary.ess = var_asymptotic > 0 ? n * var / var_asymptotic : n;
+	}
+}
+
+void ConvergenceMonitor::save(Checkpoint& checkpoint) const {
+	checkpoint.put( this->s);
+	checkpoint.put( this->num_torsions);
+	checkpoint.put( this->count);
+	checkpoint.put( this->batch_size);
+	checkpoint.put( this->in_batch);
+	checkpoint.put( this->num_batches);
+	checkpoint.putVector( this->reference);
+	checkpoint.putVector( this->current_sum);
+	checkpoint.putVector( this->current_sumsq);
+	checkpoint.putVector( this->batch_sum);
+	checkpoint.putVector( this->batch_sumsq);
+}
+
+bool ConvergenceMonitor::restore(Checkpoint& checkpoint) {
+	int s = 0, num_torsions = 0;
+	bool ok = checkpoint.get( s) && checkpoint.get( num_torsions);
+	ok = ok && s == this->s && num_torsions == this->num_torsions;
+	ok = ok && checkpoint.get( this->count);
+	ok = ok && checkpoint.get( this->batch_size);
+	ok = ok && checkpoint.get( this->in_batch);
+	ok = ok && checkpoint.get( this->num_batches);
+	ok = ok && checkpoint.getVector( this->reference);
+	ok = ok && checkpoint.getVector( this->current_sum);
+	ok = ok && checkpoint.getVector( this->current_sumsq);
+	ok = ok && checkpoint.getVector( this->batch_sum);
+	ok = ok && checkpoint.getVector( this->batch_sumsq);
+	return ok;
+}
+
+double ConvergenceMonitor::getESS(const TorsionSummary* summaries, const int num_chains, const int num_torsions, const int k) {
+	double ess = 0;
+	for( int c = 0; c < num_chains; c++) {
+		const TorsionSummary& summary = summaries[c * num_torsions + k];
+		if( summary.n == 0)
+			return 0;
+		ess += summary.ess;
+	}
+	return ess;
+}
+
+double ConvergenceMonitor::getRhat(const TorsionSummary* summaries, const int num_chains, const int num_torsions, const int k) {
+	//Halves may differ in length between chains; use the shortest one.
+	double n = numeric_limits<double>::infinity();
+	double grand_mean = 0;
+	double W = 0;
+	int m = 2 * num_chains;
+	for( int c = 0; c < num_chains; c++) {
+		const TorsionSummary& summary = summaries[c * num_torsions + k];
+		if( summary.n == 0)
+			return numeric_limits<double>::infinity();
+		n = min( n, summary.n / 2.0);
+		for( int h = 0; h < 2; h++) {
+			grand_mean += summary.mean[h] / m;
+			W += summary.var[h] / m;
+		}
+	}
+	double B_over_n = 0;
+	for( int c = 0; c < num_chains; c++) {
+		const TorsionSummary& summary = summaries[c * num_torsions + k];
+		for( int h = 0; h < 2; h++) {
+			double d = summary.mean[h] - grand_mean;
+			B_over_n += d * d / (m - 1);
+		}
+	}
+	if( W == 0)
+		return B_over_n == 0 ? 1.0 : numeric_limits<double>::infinity();
+	double var_plus = (n - 1) / n * W + B_over_n;
+	return sqrt( var_plus / W);
+}
+
+bool ConvergenceMonitor::isConverged(const TorsionSummary* summaries, const int num_chains, const int num_torsions, const StopCriteria& criteria) {
+	if( !criteria.enabled())
+		return false;
+	for( int k = 0; k < num_torsions; k++) {
+		if( criteria.min_ess > 0 && ConvergenceMonitor::getESS( summaries, num_chains, num_torsions, k) < criteria.min_ess)
+			return false;
+		if( criteria.max_rhat > 0 && !(ConvergenceMonitor::getRhat( summaries, num_chains, num_torsions, k) < criteria.max_rhat))
+			return false;
+	}
+	return true;
+}
+
+void ConvergenceMonitor::writeCSV(ostream& out, const TorsionSummary* summaries, const int num_chains, const int num_torsions, const int s) {
+	out << "residue,angle,ess,rhat" << endl;
+	for( int k = 0; k < num_torsions; k++) {
+		out << s + k / 2 << "," << (k % 2 == 0 ? "phi" : "psi") << ","
+				<< ConvergenceMonitor::getESS( summaries, num_chains, num_torsions, k) << ","
+				<< ConvergenceMonitor::getRhat( summaries, num_chains, num_torsions, k) << endl;
+	}
+}
+
+ConvergenceBoard::ConvergenceBoard(const int num_chains, const int num_torsions) {
+	this->num_chains = num_chains;
+	this->num_torsions = num_torsions;
+	this->size = sizeof( Header) + num_chains * num_torsions * sizeof( TorsionSummary);
+	void* memory = mmap( NULL, this->size, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_ANONYMOUS, -1, 0);
+	Debug::check( memory != MAP_FAILED, "Cannot allocate shared memory for convergence diagnostics");
+	this->header = (Header*)memory;
+	this->summaries = (TorsionSummary*)((char*)memory + sizeof( Header));
+
+	pthread_mutexattr_t attr;
+	pthread_mutexattr_init( &attr);
+	pthread_mutexattr_setpshared( &attr, PTHREAD_PROCESS_SHARED);
+	pthread_mutex_init( &this->header->mutex, &attr);
+	pthread_mutexattr_destroy( &attr);
+	this->header->stop = 0;
+	for( int i = 0; i < num_chains * num_torsions; i++) {
+		this->summaries[i].n = 0;
+	}
+}
+
+ConvergenceBoard::~ConvergenceBoard() {
+	pthread_mutex_destroy( &this->header->mutex);
+	munmap( this->header, this->size);
+}
+
+bool ConvergenceBoard::publish(const int chain, const ConvergenceMonitor& monitor, const StopCriteria& criteria) {
+	Debug::check( monitor.getNumTorsions() == this->num_torsions, "Convergence board and monitor have different torsions");
+	pthread_mutex_lock( &this->header->mutex);
+	monitor.summarize( this->summaries + chain * this->num_torsions);
+	if( this->header->stop == 0 && ConvergenceMonitor::isConverged( this->summaries, this->num_chains, this->num_torsions, criteria))
+		this->header->stop = 1;
+	bool stop = this->header->stop != 0;
+	pthread_mutex_unlock( &this->header->mutex);
+	return stop;
+}
+
+void ConvergenceBoard::getSummaries(vector<TorsionSummary>& summaries) {
+	pthread_mutex_lock( &this->header->mutex);
+	summaries.assign( this->summaries, this->summaries + this->num_chains * this->num_torsions);
+	pthread_mutex_unlock( &this->header->mutex);
+}
@@ -0,0 +1,165 @@
+/*
+ * Diagnostics.h
+ *
+ *  Created on: Oct 17, 2026
+ */
+
+#ifndef DIAGNOSTICS_H_
+#define DIAGNOSTICS_H_
+
+#include "PProtein.h"
+#include <vector.h>
+#include <iostream>
+#include <pthread.h>
+using namespace std;
+
+class Checkpoint;
+
+/**
+ * @brief Convergence summary of one torsion in one Markov chain.
+ */
+struct TorsionSummary {
+	/**
+	 * @brief number of samples summarized, 0 if the chain is too short to be diagnosed
+	 */
+	long n;
+	/**
+	 * @brief mean and variance of the first and the second half of the samples, used for split-R-hat
+	 */
+	double mean[2];
+	double var[2];
+	/**
+	 * @brief effective sample size
+	 */
+	double ess;
+};
+
+/**
+ * @brief Criteria to stop sampling before the time budget is used up. A criterion set to 0 is not checked.
+ */
+struct StopCriteria {
+	StopCriteria() : min_ess(0), max_rhat(0) {}
+	/**
+	 * @brief stop when the effective sample size of every loop torsion (summed over chains) is at least min_ess
+	 */
+	double min_ess;
+	/**
+	 * @brief stop when the split-R-hat of every loop torsion is below max_rhat
+	 */
+	double max_rhat;
+	bool enabled() const { return min_ess > 0 || max_rhat > 0; }
+};
+
+/**
+ * @brief Online convergence diagnostics of the backbone dihedral angles (phi, psi) of a loop.
+ *
+ * Every sample costs O(1) per torsion: the samples are accumulated in at most MAX_BATCHES batches of equal size,
+ * and when all batches are full, neighbouring batches are merged and the batch size doubles.
+ * The effective sample size is estimated by batch means, split-R-hat from the two halves of the batches.
+ * Angles are unwrapped relative to the first sample of the chain.
+ */
+class ConvergenceMonitor {
+public:
+	ConvergenceMonitor();
+
+	/**
+	 * @brief Start monitoring the torsions of residues s to e; torsion 2 * i is the phi angle and torsion 2 * i + 1 the psi angle of residue s + i.
+	 */
+	void reset( const int s, const int e);
+
+	/**
+	 * @brief Add the current conformation of the top level chain as a sample.
+	 */
+	void add( PProtein* protein);
+
+	int getNumTorsions() const;
+	long getSamples() const;
+
+	/**
+	 * @brief Summarize every torsion of this chain.
+	 * @param summaries array of getNumTorsions() entries
+	 */
+	void summarize( TorsionSummary* summaries) const;
+
+	void save( Checkpoint& checkpoint) const;
+	bool restore( Checkpoint& checkpoint);
+
+	/**
+	 * @brief Effective sample size of torsion k summed over chains.
+	 * @param summaries num_chains * num_torsions summaries, chain by chain
+	 * @return 0 if any chain is too short
+	 */
+	static double getESS( const TorsionSummary* summaries, const int num_chains, const int num_torsions, const int k);
+
+	/**
+	 * @brief Split-R-hat of torsion k over all chains, each chain split into two halves.
+	 * @return infinity if any chain is too short
+	 */
+	static double getRhat( const TorsionSummary* summaries, const int num_chains, const int num_torsions, const int k);
+
+	/**
+	 * @brief Check the stop criteria on all torsions.
+	 */
+	static bool isConverged( const TorsionSummary* summaries, const int num_chains, const int num_torsions, const StopCriteria& criteria);
+
+	/**
+	 * @brief Export as CSV with columns residue,angle,ess,rhat.
+	 * @param s index of the first monitored residue
+	 */
+	static void writeCSV( ostream& out, const TorsionSummary* summaries, const int num_chains, const int num_torsions, const int s);
+
+	static const int MAX_BATCHES = 64;
+
+private:
+	int s;
+	int num_torsions;
+	long count;
+	long batch_size;
+	long in_batch;
+	int num_batches;
+
+	vector<double> reference;
+	vector<double> current_sum;
+	vector<double> current_sumsq;
+	/**
+	 * @brief Sums and sums of squares of every batch, indexed by batch * num_torsions + torsion.
+	 */
+	vector<double> batch_sum;
+	vector<double> batch_sumsq;
+};
+
+/**
+ * @brief Summaries of several Markov chains running in forked worker processes, kept in shared memory.
+ * Create it before forking; every chain publishes its summaries and the first chain that finds all chains converged
+ * raises the stop flag for the others.
+ */
+class ConvergenceBoard {
+public:
+	ConvergenceBoard( const int num_chains, const int num_torsions);
+	~ConvergenceBoard();
+
+	/**
+	 * @brief Publish the summaries of one chain and check the stop criteria on all chains.
+	 * @return true if sampling should stop
+	 */
+	bool publish( const int chain, const ConvergenceMonitor& monitor, const StopCriteria& criteria);
+
+	/**
+	 * @brief Copy the latest summaries of all chains.
+	 */
+	void getSummaries( vector<TorsionSummary>& summaries);
+
+private:
+	struct Header {
+		pthread_mutex_t mutex;
+		int stop;
+	};
+
+	int num_chains;
+	int num_torsions;
+	size_t size;
+	Header* header;
+	TorsionSummary* summaries;
+};
+
+#endif /* DIAGNOSTICS_H_ */
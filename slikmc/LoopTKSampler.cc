@@ -13,7 +13,7 @@
 #include <sstream>
 using namespace std;
 
-LoopTKSampler::LoopTKSampler(PProtein* protein) {
+LoopTKSampler::LoopTKSampler(PProtein* protein) : telemetry( "looptk") {
 	this->chain = protein;
 	this->bfactor = NULL;
 	this->use_BFactor = false;
@@ -25,7 +25,8 @@ LoopTKSampler::~LoopTKSampler() {
 }
 
 void LoopTKSampler::sample( const double time_duration, const int s, const int e, const int num_conformation) {
-	clock_t begin = clock();
+	this->telemetry.reset( 1);
+	SampleWriter writer;
 	int num_generated = 0;
 	vector<PProtein*> proteins;
 	priority_queue< Protein_Score, vector<Protein_Score>, CompareProtein_Score > pq;
@@ -33,16 +34,21 @@ void LoopTKSampler::sample( const double time_duration, const int s, const int e
 	PProtein* prev = this->chain;
 	while( true) {
 		cout << "Generating # " << num_generated << endl << flush;
+		double t = Telemetry::now();
 		vector<PProtein*> curr_vector = PSampMethods::SeedSampleBackbone( prev, s, e);
+		this->telemetry.record( Telemetry::IK_CLOSURE, t);
 		assert( curr_vector.size() == 1);
 
 		PProtein* curr = curr_vector[0];
+		this->telemetry.record( 0, Telemetry::ACCEPTED);
 
 		//record every conformation
 		if( num_conformation == -1) {
 			stringstream ss;
 			ss << num_generated;
-			PDBIO::writeToFile( curr, "../pdbfiles_out/loopTK_" + ss.str() + ".pdb");
+			t = Telemetry::now();
+			writer.write( curr, "../pdbfiles_out/loopTK_" + ss.str() + ".pdb");
+			this->telemetry.record( Telemetry::OUTPUT, t);
 		}
 		//record only top-scored conformations
 		else {
@@ -69,14 +75,13 @@ void LoopTKSampler::sample( const double time_duration, const int s, const int e
 		num_generated += 1;
 		cout << "done" << endl;
 
-		clock_t current = clock();
-		if( (current - begin) / 1000 > time_duration ) {
+		this->telemetry.finishIteration();
+		if( this->telemetry.getWallTime() > time_duration ) {
 			cout << "Run out of time. Sampling stops" << endl;
 			break;
 		}
 	}
-	clock_t curr = clock();
-	cout << "Duration:" << (curr - begin) / 1000.0 << endl;
+	cout << "Duration:" << this->telemetry.getWallTime() << endl;
 
 	if(num_conformation != -1) {
 		int i = 0;
@@ -84,22 +89,28 @@ void LoopTKSampler::sample( const double time_duration, const int s, const int e
 			stringstream ss;
 			ss << i;
 			PProtein* p = pq.top().protein;
-			PDBIO::writeToFile(p, "../pdbfiles_out/loopTK_" + ss.str() + ".pdb");
+			double t = Telemetry::now();
+			writer.write( p, "../pdbfiles_out/loopTK_" + ss.str() + ".pdb");
+			this->telemetry.record( Telemetry::OUTPUT, t);
 			delete p;
 			pq.pop();
 			cout << "***Record # " << i << endl;
 			i++;
 		}
 	}
+	double t = Telemetry::now();
+	writer.flush();
+	this->telemetry.record( Telemetry::OUTPUT, t);
+	this->telemetry.write( "../pdbfiles_out/loopTK_telemetry.json", "../pdbfiles_out/loopTK_telemetry.csv");
 }
 
 double LoopTKSampler::evaluate_log(PProtein* chain) {
+	double t = Telemetry::now();
 	double log_prob_rplot = 0;
 	int start = 0;
 	int end = chain->size() - 1;
 	for( int i = start; i <= end; i++) {
-		double temp = this->rplot.getResidueAngleProbability( chain, i);
-		log_prob_rplot += log(temp);
+		log_prob_rplot += this->rplot.getResidueAngleProbability_log( chain, i);
 	}
 
 	double log_prob_bfactor = 0;
@@ -109,6 +120,7 @@ double LoopTKSampler::evaluate_log(PProtein* chain) {
 		else
 			log_prob_bfactor = this->bfactor->evalAtomPositions( chain, 0, chain->size() - 1);
 	}
+	this->telemetry.record( Telemetry::PRIOR, t);
 	return log_prob_rplot + log_prob_bfactor;
 }
 
@@ -120,7 +132,7 @@ bool CompareProtein_Score::operator ()(Protein_Score& t1, Protein_Score& t2) {
 }
 
 PProtein* LoopTKSampler::perturb(PProtein* protein, const double time_duration, const int s, const int e) {
-	clock_t begin = clock();
+	double begin = Telemetry::now();
 
 	PProtein* prev = protein;
 	int iter = 0;
@@ -132,8 +144,7 @@ PProtein* LoopTKSampler::perturb(PProtein* protein, const double time_duration,
 		delete prev;
 		prev = curr_vector[0];
 
-		clock_t current = clock();
-		if( (current - begin) / 1000 > time_duration )
+		if( Telemetry::now() - begin > time_duration )
 		{
 			cout << "Run out of time. Sampling stops" << endl;
 			break;
@@ -153,6 +164,10 @@ void LoopTKSampler::enableBFactors(PProtein* protein) {
 	this->use_BFactor = true;
 }
 
+const Telemetry& LoopTKSampler::getTelemetry() const {
+	return this->telemetry;
+}
+
 void LoopTKSampler::disableBFactors() {
 	this->use_BFactor = false;
 }
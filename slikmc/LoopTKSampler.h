@@ -10,6 +10,8 @@
 #include "PProtein.h"
 #include "RamachandranPlot.h"
 #include "BFactor.h"
+#include "Telemetry.h"
+#include "SampleWriter.h"
 
 /**
  * @brief An auxiliary class for class LoopTKSampler. This class is a data structure for storing a chain conformation and its score.
@@ -44,7 +46,8 @@ public:
 
 	/**
 	 * @brief Sample conformations of sub-loop from residue s to residue e.
-	 * @param time time duration to sample
+	 * Per-stage timings are written to ../pdbfiles_out/loopTK_telemetry.json and loopTK_telemetry.csv.
+	 * @param time wall-clock time duration to sample in seconds
 	 * @param s index of starting residue
 	 * @param e index of ending residue
 	 * @param num number of top-scores conformations to be saved, by default, save all conformations.
@@ -61,7 +64,7 @@ public:
 	/**
 	 * @brief Perturb a chain segment for some time.
 	 * @param chain the chain to be perturbed
-	 * @param time time duration to perturb
+	 * @param time wall-clock time duration to perturb in seconds
 	 * @param s index of starting residue
 	 * @param e index of ending residue
 	 * @return a perturbed chain
@@ -78,12 +81,19 @@ public:
 	 * @brief Disable using B-factors as priors.
 	 */
 	void disableBFactors();
+
+	/**
+	 * @brief Get per-stage timings of the last sample() call. Every generated conformation counts as accepted for block 0.
+	 */
+	const Telemetry& getTelemetry() const;
 private:
 	BFactor* bfactor;
 	RamachandranPlot rplot;
 	PProtein* chain;
 
 	bool use_BFactor;
+
+	Telemetry telemetry;
 };
 
 #endif /* LOOPTKSAMPLER_H_ */
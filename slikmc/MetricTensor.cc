@@ -0,0 +1,188 @@
+/*
+ * MetricTensor.cc
+ *
+ *  Created on: Oct 17, 2026
+ */
+
+#include "MetricTensor.h"
+#include "PTools.h"
+#include "PNumRoutines.h"
+#include "SLIKMC.h"
+#include "Utility.h"
+#include <math.h>
+#include <assert.h>
+
+double MetricTensor::evalBlock_log(PProtein* block, int& status) {
+	int pivots[3] = { 1, 2, 3};
+	return MetricTensor::evalBlock_log( block, pivots, status);
+}
+
+double MetricTensor::evalBlock_log(PProtein* block, const int pivots[3], int& status) {
+	int last = block->size() - 1;
+	Debug::check( pivots[0] > 0 && pivots[0] < pivots[1] && pivots[1] < pivots[2] && pivots[2] == last, "Pivots do not match the block");
+	status = 0;
+
+	//x: phi, psi of the first residue; y: phi, psi of the three pivot residues.
+	int dofs[NUM_FREE + NUM_DEPENDENT] = { 0, 1,
+			2 * pivots[0], 2 * pivots[0] + 1, 2 * pivots[1], 2 * pivots[1] + 1, 2 * pivots[2], 2 * pivots[2] + 1};
+	Vector3 ca_end = block->getAtomPos( PID::BACKBONE, 3 * last + 1);
+	Vector3 c_end = block->getAtomPos( PID::BACKBONE, 3 * last + 2);
+
+	//dc/dx and dc/dy: rows 0-2 for C-alpha, rows 3-5 for C (same layout as PTools::ComputeJacobian).
+	double dc_dx[NUM_DEPENDENT][NUM_FREE];
+	double dc_dy[NUM_DEPENDENT][NUM_DEPENDENT];
+	for( int k = 0; k < NUM_FREE + NUM_DEPENDENT; k++) {
+		//DOF rotates about the bond from atom (index - 1) to atom index.
+		int index = 3 * (dofs[k] / 2) + (dofs[k] % 2) + 1;
+		Vector3 q = block->getAtomPos( PID::BACKBONE, index - 1);
+		Vector3 r = block->getAtomPos( PID::BACKBONE, index);
+		Vector3 t = r - q;
+		t /= t.norm();
+		Vector3 v_ca, v_c;
+		v_ca.setCross( t, ca_end - r);
+		v_c.setCross( t, c_end - r);
+		double* col[NUM_DEPENDENT];
+		for( int i = 0; i < NUM_DEPENDENT; i++) {
+			col[i] = k < NUM_FREE ? &dc_dx[i][k] : &dc_dy[i][k - NUM_FREE];
+		}
+		*col[0] = v_ca.x; *col[1] = v_ca.y; *col[2] = v_ca.z;
+		*col[3] = v_c.x; *col[4] = v_c.y; *col[5] = v_c.z;
+	}
+	//The last DOF rotates about C-alpha -> C, the C-alpha does not move.
+	assert( (dc_dy[0][5] < EPSILON) && (dc_dy[1][5] < EPSILON) && (dc_dy[2][5] < EPSILON));
+
+	//df/dx = -(dc/dy)^-1 * dc/dx; the sign does not matter for the tensor below.
+	if( !MetricTensor::solve( dc_dy, dc_dx)) {
+		status = -1;
+		return 1;
+	}
+
+	//dh/dx = I + (df/dx)^T * (df/dx), accumulated over the first NUM_FREE rows as in the reference implementation.
+	double dh_dx[NUM_FREE][NUM_FREE];
+	for( int i = 0; i < NUM_FREE; i++) {
+		for( int j = 0; j < NUM_FREE; j++) {
+			double temp = i == j ? 1 : 0;
+			for( int k = 0; k < NUM_FREE; k++) {
+				temp += dc_dx[k][i] * dc_dx[k][j];
+			}
+			dh_dx[i][j] = temp;
+		}
+	}
+	double det = dh_dx[0][0] * dh_dx[1][1] - dh_dx[0][1] * dh_dx[1][0];
+	return log( det);
+}
+
+bool MetricTensor::solve(double A[NUM_DEPENDENT][NUM_DEPENDENT], double B[NUM_DEPENDENT][NUM_FREE]) {
+	const int N = NUM_DEPENDENT;
+	for( int c = 0; c < N; c++) {
+		int pivot = c;
+		for( int i = c + 1; i < N; i++) {
+			if( fabs( A[i][c]) > fabs( A[pivot][c]))
+				pivot = i;
+		}
+		//GSL reports a singular LU factorization only for exactly zero pivots.
+		if( A[pivot][c] == 0)
+			return false;
+		if( pivot != c) {
+			for( int j = c; j < N; j++) {
+				double temp = A[c][j]; A[c][j] = A[pivot][j]; A[pivot][j] = temp;
+			}
+			for( int j = 0; j < NUM_FREE; j++) {
+				double temp = B[c][j]; B[c][j] = B[pivot][j]; B[pivot][j] = temp;
+			}
+		}
+		for( int i = c + 1; i < N; i++) {
+			double factor = A[i][c] / A[c][c];
+			for( int j = c + 1; j < N; j++) {
+				A[i][j] -= factor * A[c][j];
+			}
+			for( int j = 0; j < NUM_FREE; j++) {
+				B[i][j] -= factor * B[c][j];
+			}
+		}
+	}
+	for( int i = N - 1; i >= 0; i--) {
+		for( int j = 0; j < NUM_FREE; j++) {
+			double temp = B[i][j];
+			for( int k = i + 1; k < N; k++) {
+				temp -= A[i][k] * B[k][j];
+			}
+			B[i][j] = temp / A[i][i];
+		}
+	}
+	return true;
+}
+
+double MetricTensor::evalBlockReference_log( PProtein* protein, int& status) {
+	//NOTE: Their code starts at 1.
+	//Therefore, the matrix should be 6 + 1 (x, y, z, rx, ry, rz)by size * 2 + 1with the first row and first column junk values.
+	int size = protein->size();
+	double** Jac_ca =  Utility::new_Double2D( 6 + 1, size * 2 + 1);
+	double** Jac_c = Utility::new_Double2D( 6 + 1, size * 2 + 1);
+
+	//NOTE: By default, ComputeJacobian function calculates the Jacobian for the last backbone atom.
+	PTools::ComputeJacobian( protein, Jac_c);
+	Vector3 ca_pos = protein->getAtomPos(PID::BACKBONE, size * 3 - 2);
+	PTools::ComputeJacobian( protein, Jac_ca, ca_pos);
+
+	assert( (Jac_ca[1][8] < EPSILON) && (Jac_ca[2][8] < EPSILON) && (Jac_ca[3][8] < EPSILON));
+
+	//Next, throw out all garbage lines and all the angular Jacobian entries
+	double** dc_dx = Utility::new_Double2D( 6 + 1, 2 + 1);
+	double** dc_dy = Utility::new_Double2D( 6 + 1, 6 + 1);
+
+	for( int i = 1; i <= 3; i++)
+	{
+		for( int j = 1; j <= 2; j++)
+		{
+			dc_dx[i][j] = Jac_ca[i][j];
+		}
+
+		for( int j = 1; j <= 6; j++)
+		{
+			dc_dy[i][j] = Jac_ca[i][j + 2];
+		}
+	}
+
+	for( int i = 4; i <= 6; i++)
+	{
+		for( int j = 1; j <= 2; j++)
+		{
+			dc_dx[i][j] = Jac_c[i - 3][j];
+		}
+
+		for( int j = 1; j <= 6; j++)
+		{
+			dc_dy[i][j] = Jac_c[i - 3][j + 2];
+		}
+	}
+
+	double** dc_dy_inverse = Utility::new_Double2D( 6 + 1, 6 + 1);
+	PNumRoutines::nr_inverse( dc_dy, 6, dc_dy_inverse, status);
+	double tensor = 1;
+	if( status != -1) {
+		double** df_dx = Utility::new_Double2D( 6 + 1, 2 + 1);
+		Utility::matrix_multiply_trash( 6, 6, 2, dc_dy_inverse, dc_dx, df_dx, -1);
+
+		double** dh_dx = Utility::new_Double2D( 2 + 1, 2 + 1);
+		Utility::matrix_square_transposeA( 2, 2, df_dx, dh_dx);
+
+		//Add the identity
+		dh_dx[1][1] += 1;
+		dh_dx[2][2] += 1;
+
+		//Get the determinant
+		double det = dh_dx[1][1] * dh_dx[2][2] - dh_dx[1][2] * dh_dx[2][1];
+
+		tensor = log(det);
+		Utility::delete_Double2D( df_dx, 6 + 1);
+		Utility::delete_Double2D( dh_dx, 2 + 1);
+	}
+
+	Utility::delete_Double2D( Jac_c, 6 + 1);
+	Utility::delete_Double2D( Jac_ca, 6 + 1);
+	Utility::delete_Double2D( dc_dx, 6 + 1);
+	Utility::delete_Double2D( dc_dy, 6 + 1);
+	Utility::delete_Double2D( dc_dy_inverse, 6 + 1);
+	return tensor;
+}
@@ -0,0 +1,64 @@
+/*
+ * MetricTensor.h
+ *
+ *  Created on: Oct 17, 2026
+ */
+
+#ifndef METRICTENSOR_H_
+#define METRICTENSOR_H_
+
+#include <PProtein.h>
+
+/**
+ * @brief Metric tensor of the closed-loop manifold of one block.
+ * The phi, psi of the first residue are the free variables x, the phi, psi of the three pivot residues y are decided by IK,
+ * and the constraint c is the position of the C-alpha and C atoms of the last residue (the last pivot).
+ */
+class MetricTensor {
+public:
+	/**
+	 * @brief Number of dependent (IK) DOFs, also the number of constraint equations.
+	 */
+	static const int NUM_DEPENDENT = 6;
+
+	/**
+	 * @brief Number of free DOFs.
+	 */
+	static const int NUM_FREE = 2;
+
+	/**
+	 * @brief Calculate the metric tensor of one 4-residue block with pivots {1, 2, 3} in logarithm.
+	 * Fixed-size kernel: both Jacobians are built in one pass over the backbone and dc/dy is factorized on the stack instead of inverted.
+	 * @param block a 4-residue block to be evaluated
+	 * @param status -1 if dc/dy is singular; otherwise 0
+	 * @return log of the determinant of the metric tensor
+	 */
+	static double evalBlock_log( PProtein* block, int& status);
+
+	/**
+	 * @brief Calculate the metric tensor of one block with arbitrary width in logarithm.
+	 * @param block a block to be evaluated
+	 * @param pivots indices of the three IK pivot residues in the block; 0 < pivots[0] < pivots[1] < pivots[2] = size - 1
+	 * @param status -1 if dc/dy is singular; otherwise 0
+	 * @return log of the determinant of the metric tensor
+	 */
+	static double evalBlock_log( PProtein* block, const int pivots[3], int& status);
+
+	/**
+	 * @brief Reference implementation of evalBlock_log() for 4-residue blocks with pivots {1, 2, 3}, with PTools::ComputeJacobian and GSL inversion on heap matrices.
+	 * Kept for validating and benchmarking the fixed-size kernel.
+	 * @param block a 4-residue block to be evaluated
+	 * @param status -1 if dc/dy is singular; otherwise 0
+	 * @return log of the determinant of the metric tensor
+	 */
+	static double evalBlockReference_log( PProtein* block, int& status);
+
+private:
+	/**
+	 * @brief Solve A * X = B in place by Gaussian elimination with partial pivoting; X is stored in B.
+	 * @return false if A is singular
+	 */
+	static bool solve( double A[NUM_DEPENDENT][NUM_DEPENDENT], double B[NUM_DEPENDENT][NUM_FREE]);
+};
+
+#endif /* METRICTENSOR_H_ */
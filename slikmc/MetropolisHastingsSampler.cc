@@ -13,13 +13,19 @@
 #include "math/MatrixTemplate.h"
 #include "PConstants.h"
 #include "PExtension.h"
+#include "Checkpoint.h"
+#include "Utility.h"
+#include <string.h>
 using namespace std;
 using namespace Math;
 
-MHSampler::MHSampler(PProtein* protein) {
+MHSampler::MHSampler(PProtein* protein) : telemetry( "mh") {
 	this->chain = protein;
 	this->bfactor = NULL;
 	this->use_BFactor = false;
+	this->seed = 1;
+	this->checkpointInterval = 0;
+	this->resume = false;
 	return;
 }
 
@@ -29,40 +35,39 @@ MHSampler::~MHSampler() {
 }
 
 void MHSampler::sample( const double time_duration, const double std_perturb) {
-	//In order to adapt to LoopTK tool functions, vector should start from 1.
-	int size_dihedral = this->chain->size() * 2 + 1;
-
-	int size = size_dihedral;
-	VectorTemplate<double> mean( size);
-	mean.setZero();
-	MatrixTemplate<double> variance( size, size);
-	variance.setZero();
-	for( int i = 0; i < size; i++) {
-		variance(i, i) = std_perturb * std_perturb;
-	}
-
-	Gaussian<double> gaussian;
-	gaussian.resize( size);
-	gaussian.setMean( mean);
-	gaussian.setCovariance( variance);
-
 	int size_residue = this->chain->size();
 	int size_rotation = size_residue * 2 + 1;
 
-	clock_t begin = clock();
+	this->telemetry.reset( 1);
+	SampleWriter writer;
 	int count_success = 0;
 	int count_total = 0;
+	vector<double> perturb( size_rotation);
+
+	Random::seed( this->seed);
+	Checkpoint* checkpoint = NULL;
+	if( this->checkpointInterval > 0) {
+		checkpoint = new Checkpoint( this->checkpointFile);
+		if( this->resume && checkpoint->exists()) {
+			Debug::check( checkpoint->load(), "Cannot read checkpoint " + this->checkpointFile);
+			Debug::check( this->loadCheckpoint( *checkpoint, std_perturb, count_success, count_total),
+					"Checkpoint " + this->checkpointFile + " does not match the chain or the sampling settings");
+			cout << "Resume sampling from # " << count_total << endl;
+		}
+		this->resume = false;
+	}
 
 	while( true) {
-		PChainState* state = this->chain->saveChainState();
+		double t = Telemetry::now();
+		this->chain->saveChainState( &this->state);
+		this->telemetry.record( Telemetry::RESTORE, t);
 		double P = this->getP_log( this->chain);
 		double Q = 1;
 
 		bool success = false;
 		cout << "Sampling # " << count_total;
-		VectorTemplate<double> perturb( size_rotation);
-		gaussian.generate( perturb);
-
+		//Independent normal perturbations of every backbone dihedral angle, drawn in one batch.
+		Random::fillNormal( &perturb[0], size_rotation - 1, 0, std_perturb);
 		for( int i = 0; i < size_rotation - 1; i++) {
 			this->chain->RotateChain_noGridUpdate("backbone", i, forward, perturb[i]);
 		}
@@ -71,29 +76,57 @@ void MHSampler::sample( const double time_duration, const double std_perturb) {
 		double P_proposal = this->getP_log( this->chain);
 		double Q_proposal = 1;
 		if( this->MHStep( P, Q, P_proposal, Q_proposal) == true) {
+			t = Telemetry::now();
 			this->chain->updateAtomsGrid();
-			if( this->chain->InAnyCollision() == false) {
+			bool collision = this->chain->InAnyCollision();
+			this->telemetry.record( Telemetry::COLLISION, t);
+			if( collision == false) {
 				stringstream ss;
 				ss << count_success;
-				PDBIO::writeToFile(chain, "../pdbfiles_out/mh_" + ss.str() + ".pdb");
+				t = Telemetry::now();
+				writer.write( this->chain, "../pdbfiles_out/mh_" + ss.str() + ".pdb");
+				this->telemetry.record( Telemetry::OUTPUT, t);
 				count_success += 1;
 				success = true;
+				this->telemetry.record( 0, Telemetry::ACCEPTED);
 			}
+			else
+				this->telemetry.record( 0, Telemetry::REJECTED_COLLISION);
 		}
+		else
+			this->telemetry.record( 0, Telemetry::REJECTED_MH);
 		if( success == false) {
-			this->chain->restoreChainState_noGridUpdate( state);
+			t = Telemetry::now();
+			this->chain->restoreChainState_noGridUpdate( &this->state);
+			this->telemetry.record( Telemetry::RESTORE, t);
 			cout << "\tReject." << endl;
 		}
 		else
 			cout << "\tAccept." << endl;
+		this->state.stopRecording();
 
 		count_total += 1;
-		clock_t curr = clock();
-		if( (curr - begin) / 1000 > time_duration ) {
+		this->telemetry.finishIteration();
+		if( checkpoint != NULL && count_total % this->checkpointInterval == 0) {
+			//Accepted conformations must be on disk before the checkpoint refers to them.
+			t = Telemetry::now();
+			writer.flush();
+			this->saveCheckpoint( *checkpoint, std_perturb, count_success, count_total);
+			if( !checkpoint->commit())
+				cerr << "Cannot write checkpoint " << this->checkpointFile << endl;
+			this->telemetry.record( Telemetry::OUTPUT, t);
+		}
+		if( this->telemetry.getWallTime() > time_duration ) {
 			cout << "Run out of time. Sampling stops" << endl;
 			break;
 		}
 	}
+	double t = Telemetry::now();
+	writer.flush();
+	this->telemetry.record( Telemetry::OUTPUT, t);
+	this->telemetry.write( "../pdbfiles_out/mh_telemetry.json", "../pdbfiles_out/mh_telemetry.csv");
+	if( checkpoint != NULL)
+		delete checkpoint;
 
 	cout << "Duration: " << time_duration << endl;
 	cout << " Total sampling: " << count_total << endl;
@@ -110,7 +143,7 @@ bool MHSampler::MHStep( double P, double Q, double P_proposal, double Q_proposal
 	}
 	else {
 		double ratio = exp(ratio_log);
-		double temp = (double)rand()/(double)RAND_MAX;
+		double temp = Random::nextDouble( 1);
 		if( temp < ratio)
 			return true;
 		else
@@ -137,19 +170,75 @@ void MHSampler::disableBfactors() {
 	return;
 }
 
+void MHSampler::setSeed(const unsigned int seed) {
+	this->seed = seed;
+}
+
+void MHSampler::enableCheckpoint(const string& filename, const int interval) {
+	Debug::check( interval > 0, "Checkpoint interval should be positive");
+	this->checkpointFile = filename;
+	this->checkpointInterval = interval;
+}
+
+void MHSampler::disableCheckpoint() {
+	this->checkpointInterval = 0;
+	this->resume = false;
+}
+
+void MHSampler::resumeFromCheckpoint() {
+	Debug::check( this->checkpointInterval > 0, "Enable checkpoints before resuming from a checkpoint");
+	this->resume = true;
+}
+
+void MHSampler::saveCheckpoint(Checkpoint& checkpoint, const double std_perturb, const int count_success, const int count_total) {
+	int settings[] = { this->use_BFactor, this->chain->size(), (int)this->seed, this->checkpointInterval};
+	checkpoint.clear();
+	checkpoint.put( settings, sizeof( settings));
+	checkpoint.put( std_perturb);
+	checkpoint.put( count_success);
+	checkpoint.put( count_total);
+	PRandomState random;
+	PRandom::local().getState( random);
+	checkpoint.put( random);
+	this->telemetry.save( checkpoint);
+	checkpoint.putPositions( this->chain);
+}
+
+bool MHSampler::loadCheckpoint(Checkpoint& checkpoint, const double std_perturb, int& count_success, int& count_total) {
+	int settings[] = { this->use_BFactor, this->chain->size(), (int)this->seed, this->checkpointInterval};
+	int saved[4];
+	double saved_perturb = 0;
+	bool ok = checkpoint.get( saved, sizeof( saved)) && memcmp( saved, settings, sizeof( settings)) == 0;
+	ok = ok && checkpoint.get( saved_perturb) && saved_perturb == std_perturb;
+	ok = ok && checkpoint.get( count_success);
+	ok = ok && checkpoint.get( count_total);
+	PRandomState random;
+	ok = ok && checkpoint.get( random);
+	if( ok)
+		PRandom::local().setState( random);
+	ok = ok && this->telemetry.restore( checkpoint);
+	ok = ok && checkpoint.getPositions( this->chain);
+	return ok;
+}
+
+const Telemetry& MHSampler::getTelemetry() const {
+	return this->telemetry;
+}
+
 double MHSampler::getP_log( PProtein* chain)
 {
+	double t = Telemetry::now();
 	double log_prob_rplot = 0;
 	int start = 0;
 	int end = chain->size() - 1;
 	for( int i = start; i <= end; i++) {
-		double temp = this->rplot.getResidueAngleProbability( chain, i);
-		log_prob_rplot += log(temp);
+		log_prob_rplot += this->rplot.getResidueAngleProbability_log( chain, i);
 	}
 
 	double log_prob_bfactor = 0;
 	if( this->use_BFactor)
 		log_prob_bfactor = this->bfactor->evalAtomPositions( chain, 0, chain->size() - 1);
+	this->telemetry.record( Telemetry::PRIOR, t);
 	return log_prob_rplot + log_prob_bfactor;
 }
 
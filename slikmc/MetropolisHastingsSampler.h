@@ -11,6 +11,9 @@
 #include "RamachandranPlot.h"
 #include "PProtein.h"
 #include "math/Gaussian.h"
+#include "Telemetry.h"
+#include "SampleWriter.h"
+#include "Checkpoint.h"
 using namespace Math;
 
 
@@ -30,7 +33,8 @@ public:
 
 	/**
 	 * @brief Sample conformations of protein.
-	 * @param time time duration for sampling
+	 * Per-stage timings and outcomes are written to ../pdbfiles_out/mh_telemetry.json and mh_telemetry.csv.
+	 * @param time wall-clock time duration for sampling in seconds
 	 * @param radius perturbation radius in degrees
 	 */
 	void sample( const double time, const double radius);
@@ -45,10 +49,41 @@ public:
 	 * @brief Disable using B-factors as priors.
 	 */
 	void disableBfactors();
+
+	/**
+	 * @brief Set the random seed, 1 by default.
+	 */
+	void setSeed( const unsigned int seed);
+
+	/**
+	 * @brief Enable periodic checkpoints holding the conformation, counters, telemetry and settings, see SLIKMCSampler::enableCheckpoint().
+	 * @param filename name of the checkpoint file
+	 * @param interval number of iterations between two checkpoints
+	 */
+	void enableCheckpoint( const string& filename, const int interval = 1000);
+
+	/**
+	 * @brief Disable checkpoints.
+	 */
+	void disableCheckpoint();
+
+	/**
+	 * @brief Let the next sample() call continue from the latest checkpoint if it exists.
+	 */
+	void resumeFromCheckpoint();
+
+	/**
+	 * @brief Get per-stage timings and outcomes of the last sample() call. The whole chain is tracked as block 0.
+	 */
+	const Telemetry& getTelemetry() const;
 private:
 	BFactor* bfactor;
 	RamachandranPlot rplot;
 	PProtein* chain;
+	/**
+	 * @brief Undo log of the current move, reused by every move.
+	 */
+	PChainState state;
 
 	/**
 	 * @brief Metropolis-Hastings step to decide whether to accept a proposal conformation
@@ -67,7 +102,25 @@ private:
 	 */
 	double getP_log( PProtein* chain);
 
+	/**
+	 * @brief Store the chain and the counters in a checkpoint record.
+	 */
+	void saveCheckpoint( Checkpoint& checkpoint, const double std_perturb, const int count_success, const int count_total);
+
+	/**
+	 * @brief Restore the chain and the counters from a checkpoint record.
+	 * @return false if the record does not match the chain or the current settings
+	 */
+	bool loadCheckpoint( Checkpoint& checkpoint, const double std_perturb, int& count_success, int& count_total);
+
 	bool use_BFactor;
+
+	Telemetry telemetry;
+
+	unsigned int seed;
+	string checkpointFile;
+	int checkpointInterval;
+	bool resume;
 };
 
 #endif /* BASICMETROPOLISSAMPLING_H_ */
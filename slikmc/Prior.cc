@@ -16,3 +16,19 @@ double Prior::evaluate(PChain* protein) {
 	cerr << "Warning: No self-defined evaluate function" << endl;
 	return 0;
 }
+
+bool Prior::dependsOn(const int first, const int last) {
+	return true;
+}
+
+bool Prior::isLocal() {
+	return false;
+}
+
+double Prior::evaluateRange(PChain* protein, const int first, const int last) {
+	return this->evaluate( protein);
+}
+
+bool Prior::evaluateDelta(PChain* protein, const int first, const int last, double& delta) {
+	return false;
+}
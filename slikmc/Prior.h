@@ -12,15 +12,52 @@
 #include <PChain.h>
 /**
  * @brief Interface for user defined priors.
+ *
+ * A prior only has to override evaluate(), which is called on the top level chain for every proposal.
+ * A prior that depends on a few residues, or is a sum of terms over residues, can tell the sampler so:
+ * dependsOn() declares its support, and a local prior (isLocal()) evaluates only the terms that change
+ * when a block of residues moves, or returns the change itself.
  */
 class Prior {
 public:
 	virtual ~Prior();
 	/**
 	 * @brief Override this function to define custom energy/prior function.
+	 * @param protein the top level chain
 	 * @return Probability density in logarithm.
 	 */
 	virtual double evaluate( PChain* protein);
+
+	/**
+	 * @brief Override this function to declare the residues the prior depends on.
+	 * The prior is not evaluated for moves of blocks it does not depend on. By default it depends on every residue.
+	 * @param first index of the first residue of a block in the top level chain
+	 * @param last index of the last residue of the block
+	 * @return true if the prior depends on the position of any residue from first to last
+	 */
+	virtual bool dependsOn( const int first, const int last);
+
+	/**
+	 * @brief Override this function to return true if the prior implements evaluateRange(), and optionally evaluateDelta().
+	 */
+	virtual bool isLocal();
+
+	/**
+	 * @brief Evaluate the terms of the prior that depend on residues first to last of the top level chain.
+	 * The value may differ from evaluate() by any amount that does not depend on the positions of these residues,
+	 * e.g. the terms between residues outside of the range. By default it is evaluate().
+	 * @return Probability density in logarithm, up to a constant for the range.
+	 */
+	virtual double evaluateRange( PChain* protein, const int first, const int last);
+
+	/**
+	 * @brief Compute the change of the prior caused by moving residues first to last.
+	 * Before proposing moves of a block, the sampler calls evaluateRange() on the current conformation; a prior
+	 * may keep what it needs from that call and return the exact change for every proposal.
+	 * @param delta stores the change of the prior in logarithm since the last call of evaluateRange()
+	 * @return false if the prior does not compute changes (default); evaluateRange() is then called instead
+	 */
+	virtual bool evaluateDelta( PChain* protein, const int first, const int last, double& delta);
 };
 
 #endif /* PRIOR_H_ */
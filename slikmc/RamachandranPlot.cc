@@ -11,139 +11,74 @@
 #include <sstream>
 #include <assert.h>
 #include "PConstants.h"
+#include "Utility.h"
+#include <math.h>
 
 using namespace std;
 
-RamachandranPlot::RamachandranPlot(int gridnum, char* file_pro, char* file_pre_pro, char* file_gly, char* file_generic) {
+RamachandranPlot::RamachandranPlot(int gridnum, const char* file_pro, const char* file_pre_pro, const char* file_gly, const char* file_generic) {
 	// TODO Auto-generated constructor stub
 	this->size = gridnum * gridnum;
 	this->gridnum = gridnum;
 	this->gridlength = 360.0 / gridnum;
-//	cout << "Constructing " << file_pro << endl;
-	this->pro = this->construct( file_pro);
 
-//	cout << "Constructing " << file_pre_pro << endl;
-	this->pre_pro = this->construct( file_pre_pro);
+	const char* files[4] = { file_pro, file_pre_pro, file_gly, file_generic};
+	for( int t = PRO; t <= GENERIC; t++) {
+//		cout << "Constructing " << files[t] << endl;
+		double* data = this->construct( files[t]);
 
-//	cout << "Constructing " << file_gly << endl;
-	this->gly = this->construct( file_gly);
+		//Built before the empty grids get their floor, so that they are never drawn.
+		this->tables[t].build( data, size);
 
-//	cout << "Constructing " << file_generic << endl;
-	this->gen = this->construct( file_generic);
-
-	this->pro_acc = new double[ size + 1];
-	this->pre_pro_acc = new double[ size + 1];
-	this->gly_acc = new double[ size + 1];
-	this->gen_acc = new double[ size + 1];
-
-	double sum_pro = 0; this->pro_acc[0] = 0;
-	double sum_pre_pro = 0; this->pre_pro_acc[0] = 0;
-	double sum_gly = 0; this->gly_acc[0] = 0;
-	double sum_gen = 0; this->gen_acc[0] = 0;
-
-	for( int i = 0; i < size; i++) {
-		sum_pro += this->pro[i];
-		sum_pre_pro += this->pre_pro[i];
-		sum_gly += this->gly[i];
-		sum_gen += this->gen[i];
-
-		this->pro_acc[i + 1] = sum_pro;
-		this->pre_pro_acc[ i + 1] = sum_pre_pro;
-		this->gly_acc[ i + 1] = sum_gly;
-		this->gen_acc[ i + 1] = sum_gen;
-
-		if( this->pro[i] == 0.0) {
-			this->pro[i] = 0.000000000001;
-		}
-		if( this->pre_pro[i] == 0.0) {
-			this->pre_pro[i] = 0.000000000001;
+		for( int i = 0; i < size; i++) {
+			if( data[i] == 0.0) {
+				data[i] = 0.000000000001;
+			}
 		}
-		if( this->gly[i] == 0.0) {
-			this->gly[i] = 0.000000000001;
+
+		this->log_grid[t].resize( size);
+		this->log_phi[t].assign( gridnum, 0);
+		this->log_psi[t].assign( gridnum, 0);
+		for( int x = 0; x < gridnum; x++) {
+			for( int y = 0; y < gridnum; y++) {
+				double p = data[x * gridnum + y];
+				this->log_grid[t][x * gridnum + y] = log( p);
+				this->log_phi[t][x] += p;
+				this->log_psi[t][y] += p;
+			}
 		}
-		if( this->gen[i] == 0.0) {
-			this->gen[i] = 0.000000000001;
+		for( int i = 0; i < gridnum; i++) {
+			this->log_phi[t][i] = log( this->log_phi[t][i]);
+			this->log_psi[t][i] = log( this->log_psi[t][i]);
 		}
+		delete[] data;
 	}
 	return;
 }
 
 RamachandranPlot::~RamachandranPlot() {
-	if( this->gen_acc != NULL)
-		delete this->gen_acc;
-	if( this->pre_pro_acc != NULL)
-		delete this->pre_pro_acc;
-	if( this->gly_acc != NULL)
-		delete this->gly_acc;
-	if( this->pro_acc != NULL)
-		delete this->pro_acc;
 	return;
 }
 
-//Perform a binary search and return a pair of angles
+//Draw a grid from the alias table and a pair of angles uniformly within the grid
 DihedralAngle* RamachandranPlot::getRandomDihedralAngle( int type) {
-	double p = (double)rand()/(double)RAND_MAX;
-	assert( p >= 0 && p <= 1);
-
-	double* data = NULL;
-	switch( type)
-	{
-	case PRO:
-		data = this->pro_acc;
-		break;
-	case PRE_PRO:
-		data = this->pre_pro_acc;
-		break;
-	case GLY:
-		data = this->gly_acc;
-		break;
-	case GENERIC:
-		data = this->gen_acc;
-		break;
-	default:
+	if( type < PRO || type > GENERIC) {
 		cout << "Error" << endl;
 		exit(-1);
- 	}
-	/*NOTE: Actually the data size is size + 1 with an extra 0 added.
-	This makes sure that data[start] <=p <= data[end] and
-	therefore we can perform the binary search.
-	*/
-	int start = 0;
-	int end = this->size;
-	while (start < end - 1)
-	{
-		int mid = (int) ((start + end) / 2);
-		if (data[mid] > p)
-		{
-			end = mid;
-		}
-		else {
-			start = mid;
-		}
-
-	}
-//	cout << data[start] << "\t" << data[end] << "\t" << p << endl;
-	assert( start == (end - 1));
-	if( !(data[start] <= p && p <= data[end]))
-	{
-		cout << p << endl;
-		cout << data[start] << "\t" << data[end] << endl;
-		cout << start << "\t" << end << endl;
-		cout << type << endl;
-		exit(-1);
 	}
+	int start = this->tables[type].sample();
 
-	//NOTE: start ranges from 0 to 399
+	//NOTE: start ranges from 0 to size - 1
 	int x = (int)(start / this->gridnum);
 	int y = start % this->gridnum;
 	DihedralAngle* da = new DihedralAngle();
-	da->phi = this->gridlength * x - 180 + ((double)rand()/(double)RAND_MAX) * this->gridlength;
-	da->psi = this->gridlength * y - 180 + ((double)rand()/(double)RAND_MAX) * this->gridlength;
+	da->phi = this->gridlength * x - 180 + Random::nextDouble( this->gridlength);
+	da->psi = this->gridlength * y - 180 + Random::nextDouble( this->gridlength);
 	return da;
 }
 
-double* RamachandranPlot::construct(char* filename) {
-	double* data = new double[size];
+double* RamachandranPlot::construct(const char* filename) {
+	double* data = new double[size]();
 	ifstream in;
 	in.open( filename);
 	if( in.is_open())
@@ -169,22 +104,20 @@ DihedralAngle* RamachandranPlot::getRandomDihedralAngle(string name, string name
 	/*TODO: currently, doesn't consider pre_proline figure in other code.
 	 * Therefore, only call this function by given ONE parameter.
 	 */
-	int type = -1;
+	return this->getRandomDihedralAngle( RamachandranPlot::getResidueClass( name, name_next));
+}
+
+int RamachandranPlot::getResidueClass(const string& name, const string& name_next) {
 	if( name_next == "PRO")
-		type = PRE_PRO;
-	else if( name == "GLY")
-		type = GLY;
+		return PRE_PRO;
 	else if( name == "PRO")
-		type = PRO;
-	else
-		type = GENERIC;
-	assert( type != -1);
-	return this->getRandomDihedralAngle(type);
+		return PRO;
+	else if( name == "GLY")
+		return GLY;
+	return GENERIC;
 }
 
-double RamachandranPlot::getResidueAngleProbability(PChain* chain, int index) {
-
-	const DihedralAngle* angle_pair = chain->getDihedralAngleAtResidue(index);
+int RamachandranPlot::getResidueClass(PChain* chain, int index) {
 	string name = chain->getResidue(index)->getName();
 	string name_next = "";
 	if( index < chain->size() - 1) {
@@ -201,66 +134,59 @@ double RamachandranPlot::getResidueAngleProbability(PChain* chain, int index) {
 		}
 		//else, it is the end of the chain (the chain is also the top chain).
 	}
-	double* data = NULL;
-	if( name_next == "PRO")
-		data = this->pre_pro;
-	else if( name == "PRO")
-		data = this->pro;
-	else if( name == "GLY")
-		data = this->gly;
-	else
-		data = this->gen;
+	return RamachandranPlot::getResidueClass( name, name_next);
+}
 
-	double prob = 0.0;
-	//Kind like a marginalization process
-	//NOTE: The dihedral angle pair of the first residue in the top level chain.
-	if( angle_pair->phi > 300.0) {
-			int y = (int)((angle_pair->psi  + 180.0)/ this->gridlength);
-			for( int x = 0; x < this->gridnum; x++)
-			{
-				int data_index = x * this->gridnum + y;
-				if(!(data_index >= 0 && data_index < this->size))
-				{
-					cerr << "Ramachandran Plot error!" << endl;
-					chain->printBackbonePosition();
-					chain->printDihedralAngles();
-					exit(-1);
-				}
-				prob += data[ data_index];
-			}
-		}
-		//NOTE: The dihedral angle pair of the last residue in the top level chain.
-		else if( angle_pair->psi > 300.0)
-		{
-			int x = (int)((angle_pair->phi + 180.0) / this->gridlength);
-			for( int y = 0; y < this->gridnum; y++)
-			{
-				int data_index = x * this->gridnum + y;
-				if(!(data_index >= 0 && data_index < this->size))
-				{
-					cerr << "Ramachandran Plot error!" << endl;
-					chain->printBackbonePosition();
-					chain->printDihedralAngles();
-					exit(-1);
-				}
-				prob += data[ data_index];
-			}
-		}
-		//NOTE: Not the first nor the last residue in the top level chain.
-		else
-		{
-			int x = (int)((angle_pair->phi + 180.0) / this->gridlength);
-			int y = (int)((angle_pair->psi  + 180.0)/ this->gridlength);
+int RamachandranPlot::getGridNum() const {
+	return this->gridnum;
+}
 
-			int data_index = x * this->gridnum + y;
-			if(!(data_index >= 0 && data_index < this->size))
-			{
-				cerr << "Ramachandran Plot error!" << endl;
-				chain->printBackbonePosition();
-				chain->printDihedralAngles();
-				exit(-1);
-			}
-			prob = data[ data_index];
-		}
-	return prob;
+double RamachandranPlot::getResidueAngleProbability(PChain* chain, int index) {
+	return exp( this->getResidueAngleProbability_log( chain, index));
+}
+
+double RamachandranPlot::getResidueAngleProbability_log(PChain* chain, int index) {
+	DihedralAngle angle_pair;
+	chain->getDihedralAngleAtResidue( index, angle_pair);
+	return this->getLogDensity( RamachandranPlot::getResidueClass( chain, index), angle_pair.phi, angle_pair.psi);
+}
+
+double RamachandranPlot::getLogDensity(const int type, const double phi, const double psi, const bool interpolate) const {
+	assert( type >= PRO && type <= GENERIC);
+	int x0, x1, y0, y1;
+	double wx, wy;
+	//NOTE: The dihedral angle pair of the first residue in the top level chain, marginalized over phi.
+	if( phi > 300.0) {
+		this->locate( psi, interpolate, y0, y1, wy);
+		const vector<double>& table = this->log_psi[type];
+		return (1 - wy) * table[y0] + wy * table[y1];
+	}
+	//NOTE: The dihedral angle pair of the last residue in the top level chain, marginalized over psi.
+	if( psi > 300.0) {
+		this->locate( phi, interpolate, x0, x1, wx);
+		const vector<double>& table = this->log_phi[type];
+		return (1 - wx) * table[x0] + wx * table[x1];
+	}
+	//NOTE: Not the first nor the last residue in the top level chain.
+	this->locate( phi, interpolate, x0, x1, wx);
+	this->locate( psi, interpolate, y0, y1, wy);
+	const double* grid = &this->log_grid[type][0];
+	int n = this->gridnum;
+	if( !interpolate)
+		return grid[x0 * n + y0];
+	return (1 - wx) * ((1 - wy) * grid[x0 * n + y0] + wy * grid[x0 * n + y1])
+			+ wx * ((1 - wy) * grid[x1 * n + y0] + wy * grid[x1 * n + y1]);
+}
+
+void RamachandranPlot::locate(const double angle, const bool interpolate, int& i0, int& i1, double& w) const {
+	//Grid i covers [gridlength * i - 180, gridlength * (i + 1) - 180) and is centered half a grid above.
+	double u = (angle + 180.0) / this->gridlength;
+	if( interpolate)
+		u -= 0.5;
+	double f = floor( u);
+	i0 = (int)f % this->gridnum;
+	if( i0 < 0)
+		i0 += this->gridnum;
+	i1 = i0 + 1 == this->gridnum ? 0 : i0 + 1;
+	w = interpolate ? u - f : 0;
 }
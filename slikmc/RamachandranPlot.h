@@ -12,11 +12,15 @@
 #include <vector.h>
 #include "PChain.h"
 #include "DihedralAngle.h"
+#include "Utility.h"
 using namespace std;
 
 /**
  * @brief The class RamachandranPlot is used to initialize and store database for Ramachandran plot, sample backbone dihedral angles according to residue type
  * and evaluate the probability of one conformation according to backbone structure.
+ *
+ * The probabilities are stored as log-densities indexed by residue class (see getResidueClass()), so that evaluating a residue
+ * costs one table lookup. Callers that evaluate the same chain repeatedly should compute the classes once and use getLogDensity().
  */
 class RamachandranPlot {
 public:
@@ -28,8 +32,8 @@ public:
 	 * @param file_gly library location for Glycine
 	 * @param file_generic library location for generic residues
 	 */
-	RamachandranPlot( int size = 36, char* file_pro = "../Data/RamachandranPlot/pro.txt", char* file_pre_pro = "../Data/RamachandranPlot/pre_pro.txt",
-			char* file_gly = "../Data/RamachandranPlot/gly.txt", char* file_generic = "../Data/RamachandranPlot/gen.txt");
+	RamachandranPlot( int size = 36, const char* file_pro = "../Data/RamachandranPlot/pro.txt", const char* file_pre_pro = "../Data/RamachandranPlot/pre_pro.txt",
+			const char* file_gly = "../Data/RamachandranPlot/gly.txt", const char* file_generic = "../Data/RamachandranPlot/gen.txt");
 
 	/**
 	 * @brief Destructor
@@ -59,22 +63,52 @@ public:
 	 */
 	double getResidueAngleProbability( PChain* chain, int index);
 
+	/**
+	 * @brief Same as getResidueAngleProbability() in logarithm.
+	 */
+	double getResidueAngleProbability_log( PChain* chain, int index);
+
+	/**
+	 * @brief Look up the log-density of a pair of dihedral angles without any allocation.
+	 * A phi (psi) angle above 300 means the angle is undefined at the chain end; the density is then marginalized over it.
+	 * @param type residue class {PRO, PRE_PRO, GLY, GENERIC}
+	 * @param phi backbone phi angle in degrees
+	 * @param psi backbone psi angle in degrees
+	 * @param interpolate false: density of the grid containing (phi, psi), which is also the density getRandomDihedralAngle() draws from;
+	 * true: bilinear interpolation between the centers of the four nearest grids, periodic in both angles
+	 * @return log-density
+	 */
+	double getLogDensity( const int type, const double phi, const double psi, const bool interpolate = false) const;
+
+	/**
+	 * @brief Classify a residue for the lookup.
+	 * @param name name of the residue
+	 * @param name_next name of the succeeding residue, "" if there is none
+	 * @return residue class {PRO, PRE_PRO, GLY, GENERIC}
+	 */
+	static int getResidueClass( const string& name, const string& name_next);
+
+	/**
+	 * @brief Classify a residue of a chain; the succeeding residue is looked up in the top level chain if the residue ends a sub-chain.
+	 */
+	static int getResidueClass( PChain* chain, int index);
+
+	int getGridNum() const;
+
 	static const int PRO = 0;
 	static const int PRE_PRO = 1;
 	static const int GLY = 2;
 	static const int GENERIC = 3;
 
 private:
-	//accumulative probabilities
-	double* pro_acc;
-	double* pre_pro_acc;
-	double* gly_acc;
-	double* gen_acc;
-	//pure probabilities
-	double* pro;
-	double* pre_pro;
-	double* gly;
-	double* gen;
+	//alias tables of the grids, indexed by residue class
+	AliasTable tables[4];
+	//log probabilities of the grids, indexed by residue class and phi_index * gridnum + psi_index
+	vector<double> log_grid[4];
+	//log marginal probabilities over psi, for residues without psi
+	vector<double> log_phi[4];
+	//log marginal probabilities over phi, for residues without phi
+	vector<double> log_psi[4];
 	int size;
 	int gridnum;
 	double gridlength;
@@ -84,7 +118,15 @@ private:
 	 * @param filename data file
 	 * @return a database
 	 */
-	double* construct( char* filename);
+	double* construct( const char* filename);
+
+	/**
+	 * @brief Find the grids to look up for an angle, periodic in [-180, 180).
+	 * @param i0 grid containing the angle, or the grid whose center is just below the angle if interpolating
+	 * @param i1 the next grid
+	 * @param w weight of grid i1, 0 if not interpolating
+	 */
+	void locate( const double angle, const bool interpolate, int& i0, int& i1, double& w) const;
 };
 
 #endif /* RAMACHANDRANPLOT_H_ */
@@ -8,12 +8,38 @@
 #include "Rotamer.h"
 #include <fstream>
 #include <iostream>
+#include <limits>
 #include "Utility.h"
+#include "RotamerImage.h"
+#include <string.h>
+#include <math.h>
+#include <unistd.h>
+#include <sys/stat.h>
 #include <PResources.h>
 #include <PExtension.h>
 
 using namespace std;
 
+RotamerLibrary::RotamerLibrary() {
+	for( int i = 0; i < NUM_BINS * NUM_BINS; i++)
+		this->grids[i] = NULL;
+}
+
+void RotamerLibrary::init() {
+	for( int i = 0; i < NUM_BINS * NUM_BINS; i++)
+		this->grids[i] = NULL;
+	const RotamerImageHeader* header = this->image.getHeader();
+	for( int g = 0; g < header->num_grids; g++) {
+		const RotamerImageGrid* grid = this->image.getGrids() + g;
+		int x = (grid->phi + 180) / 10;
+		int y = (grid->psi + 180) / 10;
+		Debug::check( grid->phi % 10 == 0 && grid->psi % 10 == 0 && x >= 0 && x < NUM_BINS && y >= 0 && y < NUM_BINS,
+				"RotamerLibrary: backbone angles out of the grid");
+		Debug::check( this->grids[x * NUM_BINS + y] == NULL, "RotamerLibrary: rotamers of one grid are not contiguous");
+		this->grids[x * NUM_BINS + y] = grid;
+	}
+}
+
 Rotamer::Rotamer(PProtein* protein) {
 	this->init();
 	//Since the reading process is slow, just read necessary amino acids
@@ -34,17 +60,71 @@ Rotamer::Rotamer(PProtein* protein) {
 	return;
 }
 
-void Rotamer::sample(const string& residue_name, const double& phi_d, const double& psi_d, int& rotamerIndex, vector<double>& dAngles) {
+Rotamer::Rotamer() {
+	this->init();
+}
+
+Rotamer::~Rotamer() {
+	for( int i = 0; i < this->libraries.size(); i++)
+		delete this->libraries[i];
+}
+
+bool Rotamer::compile(const string& res_name_U) {
+	string libname = this->getLibraryName( res_name_U);
+	struct stat st;
+	if( stat( libname.c_str(), &st) != 0)
+		return false;
+	unlink( RotamerImage::getFilename( libname).c_str());
+	this->read( res_name_U);
+	RotamerImage image;
+	return image.open( RotamerImage::getFilename( libname), libname);
+}
+
+string Rotamer::getLibraryName(const string& res_name_U) {
+	string res_name = String::toLower( res_name_U);
+	if( this->isSpecial( String::toUpper( res_name_U)))
+		return "../Data/ExtendedOpt1-5/" + res_name + ".bbdep.densities.lib";
+	return "../Data/ExtendedOpt1-5/" + res_name + ".bbdep.rotamers.lib";
+}
+
+int Rotamer::getResidueType(const string& residue_name) {
+	map<string, int>::iterator iter = this->residueTypes.find( residue_name);
+	if( iter != this->residueTypes.end())
+		return iter->second;
+	if( residue_name == "ALA" || residue_name == "GLY")
+		return -1;
+	//Unknown residue
+	return this->type( residue_name);
+}
+
+const RotamerImageGrid* Rotamer::getGrid(const int type, const double phi_d, const double psi_d) {
 	//Process the dihedral angles to find the grid point
 	int phi = (int)(phi_d / 10.0) * 10;
 	int psi = (int)(psi_d / 10.0) * 10;
 
-	bool isSpecial = this->isSpecial( residue_name);
-	if( !isSpecial) {
-		this->sample_common( residue_name, phi, psi, rotamerIndex, dAngles);
+	Debug::check( type >= 0 && type < this->libraries.size(), "Rotamer: residue without rotamers");
+	const RotamerLibrary* library = this->libraries[type];
+	const RotamerImageGrid* grid = library == NULL ? NULL : library->getGrid( phi, psi);
+	if( grid == NULL || grid->count == 0) {
+		cerr << "No matched item? There must be something wrong!" << endl;
+		cout << "key:" << this->residueNames[type] << "\t" << phi << "\t" << psi << endl;
+		abort();
+	}
+	return grid;
+}
+
+void Rotamer::sample(const string& residue_name, const double& phi_d, const double& psi_d, int& rotamerIndex, vector<double>& dAngles) {
+	this->sample( this->getResidueType( residue_name), phi_d, psi_d, rotamerIndex, dAngles);
+}
+
+void Rotamer::sample(const int type, const double phi_d, const double psi_d, int& rotamerIndex, vector<double>& dAngles) {
+	const RotamerImageGrid* grid = this->getGrid( type, phi_d, psi_d);
+	const RotamerLibrary* library = this->libraries[type];
+	if( !library->image.getHeader()->special) {
+		this->sample_common( library, grid, rotamerIndex, dAngles);
 	}
 	else {
-		this->sample_Special( residue_name, phi, psi, rotamerIndex, dAngles);
+		this->sample_Special( library, grid, rotamerIndex, dAngles);
 	}
 	return;
 }
@@ -52,40 +132,38 @@ void Rotamer::sample(const string& residue_name, const double& phi_d, const doub
 void Rotamer::output(char* filename) {
 	ofstream out;
 	out.open( filename);
-	for(GridMapIter gridIter = this->gridMap.begin(); gridIter != this->gridMap.end(); gridIter++) {
-		const RotamerGridKey* key = &gridIter->first;
-		RotamerGrid* grid = &gridIter->second;
-
-		out << key->name << "\t" << key->phi << "\t" << key->psi << endl;
-		for (int i = 0; i < grid->dist_rotamer.size(); i++) {
-			out << grid->dist_rotamer[i].prob << "\t";
-			for (int j = 0; j < grid->n_chi; j++) {
-				out << grid->dist_rotamer[i].means[j] << "\t";
-			}
-			for (int j = 0; j < grid->n_chi; j++) {
-				out << grid->dist_rotamer[i].stds[j] << "\t";
-			}
-			out << endl;
-		}
-	}
-
-	for(GridMapIterSpecial gridIter = this->gridMapSpecial.begin(); gridIter != this->gridMapSpecial.end(); gridIter++) {
-		const RotamerGridKey* key = &gridIter->first;
-		RotamerGridSpecial* grid = &gridIter->second;
-
-		out << key->name << "\t" << key->phi << "\t" << key->psi << endl;
-		for( int i = 0; i < grid->dist_rotamer.size(); i++) {
-			out << grid->dist_rotamer[i].prob << "\t";
-			for (int j = 0; j < grid->n_chi - 1; j++) {
-				out << grid->dist_rotamer[i].means[j] << "\t";
-			}
-			for (int j = 0; j < grid->n_chi - 1; j++) {
-				out << grid->dist_rotamer[i].stds[j] << "\t";
-			}
-			for( int j = 0; j < grid->chi_terminal[i].size(); j++) {
-				out << grid->chi_terminal[i][j] << "\t";
+	//Rotameric residues first, then non-rotameric residues, each by name and grid.
+	for( int special = 0; special <= 1; special++) {
+		for( int type = 0; type < this->libraries.size(); type++) {
+			const RotamerLibrary* library = this->libraries[type];
+			if( library == NULL)
+				continue;
+			const RotamerImage& image = library->image;
+			const RotamerImageHeader* header = image.getHeader();
+			if( header->special != special)
+				continue;
+			int n_chi = special ? header->n_chi - 1 : header->n_chi;
+			for( int x = 0; x < RotamerLibrary::NUM_BINS; x++) {
+				for( int y = 0; y < RotamerLibrary::NUM_BINS; y++) {
+					const RotamerImageGrid* grid = library->getGrid( x * 10 - 180, y * 10 - 180);
+					if( grid == NULL)
+						continue;
+					out << this->residueNames[type] << "\t" << grid->phi << "\t" << grid->psi << endl;
+					for( int r = grid->first; r < grid->first + grid->count; r++) {
+						out << image.getProbs()[r] << "\t";
+						for( int j = 0; j < n_chi; j++) {
+							out << image.getMeans()[r * RotamerImage::MAX_CHI + j] << "\t";
+						}
+						for( int j = 0; j < n_chi; j++) {
+							out << image.getStds()[r * RotamerImage::MAX_CHI + j] << "\t";
+						}
+						for( int j = 0; j < header->size_terminal; j++) {
+							out << image.getTerminal()[r * header->size_terminal + j] << "\t";
+						}
+						out << endl;
+					}
+				}
 			}
-			out << endl;
 		}
 	}
 	out.flush();
@@ -94,42 +172,37 @@ void Rotamer::output(char* filename) {
 }
 
 double Rotamer::evalSidechain_log(PChain* chain, const int start, const int end) {
-	vector<DihedralAngle> da_backbone;
-	chain->getDihedralAngles( da_backbone);
 	double log_prob = 0;
+	DihedralAngle da;
 	for( int i = start; i <= end; i++) {
-		PResidue* residue = chain->getResidue(i);
-		string name = residue->getName();
-		if( name == "ALA" || name == "GLY") continue;
-		int phi = (int)(da_backbone[i].phi / 10) * 10;
-		int psi = (int)(da_backbone[i].psi / 10) * 10;
-
-		int index = 0;
-		vector<double> da_sidechain;
-		residue->getSideChainAngles( index, da_sidechain);
-		int res_index = this->type( name);
-		if( res_index < 0){
-			GridMapIter gridIter = this->gridMap.find( RotamerGridKey(name, phi, psi));
-			if (gridIter == this->gridMap.end()) {
-				cout << "Cannot find the corresponding key" << endl;
-				cout << name << "\t" << phi << "\t" << psi << endl;
-				abort();
-			}
-			const RotamerGrid* grid = &gridIter->second;
-			log_prob += log( grid->dist_rotamer[index].prob);
-			}
-		else {
-			GridMapIterSpecial gridIter = this->gridMapSpecial.find( RotamerGridKey(name, phi, psi));
-			if (gridIter == this->gridMapSpecial.end()) {
-				cout << "Cannot find the corresponding key" << endl;
-				cout << name << "\t" << phi << "\t" << psi << endl;
-				abort();
-			}
-			const RotamerGridSpecial* grid = &gridIter->second;
-			log_prob += log( grid->dist_rotamer[index].prob);
-			int terminalIndex = (int)((da_sidechain.back() - this->degree_start[res_index]) / this->stepLength[res_index]);
-			log_prob += log( grid->chi_terminal[index][terminalIndex]);
-		}
+		chain->getDihedralAngleAtResidue( i, da);
+		log_prob += this->evalResidue_log( chain->getResidue(i), da);
+	}
+	return log_prob;
+}
+
+double Rotamer::evalResidue_log(PResidue* residue, const DihedralAngle& backbone) {
+	return this->evalResidue_log( residue, this->getResidueType( residue->getName()), backbone);
+}
+
+double Rotamer::evalResidue_log(PResidue* residue, const int type, const DihedralAngle& backbone) {
+	if( type < 0) return 0;
+	const RotamerImageGrid* grid = this->getGrid( type, backbone.phi, backbone.psi);
+
+	int index = 0;
+	vector<double> da_sidechain;
+	residue->getSideChainAngles( index, da_sidechain);
+	assert( index >= 0 && index < grid->count);
+
+	const RotamerImage& image = this->libraries[type]->image;
+	const RotamerImageHeader* header = image.getHeader();
+	int r = grid->first + index;
+	double log_prob = log( image.getProbs()[r]);
+	if( header->special) {
+		//The terminal chi angle may be slightly out of the library range after rotation.
+		int terminalIndex = (int)((da_sidechain.back() - header->degree_begin) / header->step_length);
+		terminalIndex = max( 0, min( header->size_terminal - 1, terminalIndex));
+		log_prob += log( image.getTerminal()[r * header->size_terminal + terminalIndex]);
 	}
 	return log_prob;
 }
@@ -140,18 +213,26 @@ void Rotamer::read( const string& res_name_U) {
 		cout << res_name << " does not have a rotamer! Skip reading" << endl;
 		return;
 	}
-	if( this->isSpecial( res_name_U)) {
-		this->read_special( res_name);
+	int type = this->getResidueType( String::toUpper( res_name_U));
+	RotamerLibrary* library = new RotamerLibrary();
+	if( this->isSpecial( String::toUpper( res_name_U))) {
+		this->read_special( res_name, library);
 	}
 	else {
-		this->read_common( res_name);
+		this->read_common( res_name, library);
 	}
+	delete this->libraries[type];
+	this->libraries[type] = library;
 	return;
 }
 
-void Rotamer::read_common( const string& res_name) {
+void Rotamer::read_common( const string& res_name, RotamerLibrary* library) {
 
-	string filename = "../Data/ExtendedOpt1-5/" + res_name + ".bbdep.rotamers.lib";
+	string filename = this->getLibraryName( res_name);
+	if( library->image.open( RotamerImage::getFilename( filename), filename)) {
+		library->init();
+		return;
+	}
 	ifstream in;
 	in.open( filename.c_str());
 	if( !in.is_open()) {
@@ -159,7 +240,13 @@ void Rotamer::read_common( const string& res_name) {
 		abort();
 	}
 
-	int line_index = 1;
+	RotamerImageHeader header;
+	memset( &header, 0, sizeof( RotamerImageHeader));
+	strncpy( header.name, String::toUpper( res_name).c_str(), sizeof( header.name) - 1);
+	header.n_chi = -1;
+	//Rotamers of one grid are consecutive lines of the library.
+	vector<RotamerImageGrid> grids;
+	vector<double> probs, means, stds, terminal;
 	while( true) {
 		string line;
 		getline( in, line);
@@ -178,59 +265,45 @@ void Rotamer::read_common( const string& res_name) {
 		}
 		assert( tokens.size() == 17);
 
-		RotamerGridKey key( tokens[0], atoi( tokens[1].c_str()), atoi( tokens[2].c_str()));
-
-		GridMapIter iter_grid = this->gridMap.find(key);
-		//already in the map
-		if( iter_grid != this->gridMap.end()) {
-			RotamerGrid* grid = &iter_grid->second;
-			double acc = atof( tokens[8].c_str());
-			grid->acc_rotamer.push_back( grid->acc_rotamer.back() + acc);
-
-			ChiDistribution chis;
-			for( int i = 0; i < grid->n_chi; i++) {
-				chis.means.push_back( atof( tokens[9 + i].c_str()));
-				chis.stds.push_back( atof( tokens[13 + i].c_str()));
-			}
-			chis.prob = atof( tokens[8].c_str());
-
-			grid->dist_rotamer.push_back( chis);
-
-
-		}
-		else {
-			RotamerGrid grid;
-			grid.n_chi = 0;
+		int phi = atoi( tokens[1].c_str());
+		int psi = atoi( tokens[2].c_str());
+		if( grids.empty() || grids.back().phi != phi || grids.back().psi != psi) {
+			int n_chi = 0;
 			//count how many chi angles to represent the side-chain conformation.
 			for( int i = 4; i <= 7; i++) {
 				if( tokens[i] != "0") {
-					grid.n_chi += 1;
+					n_chi += 1;
 				}
 				else {
 					for( ; i <=7; i++)
 						assert( tokens[i] == "0");
 				}
 			}
-			grid.acc_rotamer.push_back(0);
-			grid.acc_rotamer.push_back( atof( tokens[8].c_str()));
-
-			ChiDistribution chis;
-			for( int i = 0; i < grid.n_chi; i++) {
-				chis.means.push_back( atof( tokens[9 + i].c_str()));
-				chis.stds.push_back( atof( tokens[13 + i].c_str()));
-			}
-			chis.prob = atof( tokens[8].c_str());
-
-			grid.dist_rotamer.push_back( chis);
-			this->gridMap.insert( std::pair< RotamerGridKey, RotamerGrid>( key, grid));
+			if( header.n_chi < 0)
+				header.n_chi = n_chi;
+			Debug::check( n_chi == header.n_chi, "Rotamer: varying number of chi angles in " + filename);
+			RotamerImageGrid grid = { phi, psi, (int32_t)probs.size(), 0};
+			grids.push_back( grid);
 		}
+		probs.push_back( atof( tokens[8].c_str()));
+		for( int i = 0; i < RotamerImage::MAX_CHI; i++) {
+			means.push_back( i < header.n_chi ? atof( tokens[9 + i].c_str()) : 0);
+			stds.push_back( i < header.n_chi ? atof( tokens[13 + i].c_str()) : 0);
+		}
+		grids.back().count += 1;
 	}
 	in.close();
+	library->image.build( filename, header, grids, probs, means, stds, terminal);
+	this->saveImage( filename, library);
 	return;
 }
 
-void Rotamer::read_special( const string& res_name) {
-	string libname = "../Data/ExtendedOpt1-5/" + res_name + ".bbdep.densities.lib";
+void Rotamer::read_special( const string& res_name, RotamerLibrary* library) {
+	string libname = this->getLibraryName( res_name);
+	if( library->image.open( RotamerImage::getFilename( libname), libname)) {
+		library->init();
+		return;
+	}
 	ifstream libin;
 	libin.open( libname.c_str());
 	if( !libin.is_open()) {
@@ -252,7 +325,18 @@ void Rotamer::read_special( const string& res_name) {
 	}
 	int size_terminal = (this->degree_end[res_index] - this->degree_start[res_index]) / this->stepLength[res_index] + 1;
 
-	int line_index = 1;
+	RotamerImageHeader header;
+	memset( &header, 0, sizeof( RotamerImageHeader));
+	strncpy( header.name, String::toUpper( res_name).c_str(), sizeof( header.name) - 1);
+	header.special = 1;
+	header.n_chi = (index_prob == 5 ? 2: 3);
+	header.size_terminal = size_terminal;
+	header.degree_begin = this->degree_start[res_index];
+	header.degree_end = this->degree_end[res_index];
+	header.step_length = this->stepLength[res_index];
+	//Rotamers of one grid are consecutive lines of the library.
+	vector<RotamerImageGrid> grids;
+	vector<double> probs, means, stds, terminal;
 	while( true) {
 		string line; getline( libin, line);
 		if( line == "") {
@@ -269,174 +353,71 @@ void Rotamer::read_special( const string& res_name) {
 		int size_tokens = index_t + size_terminal;
 		assert( tokens.size() == size_tokens);
 
-		RotamerGridKey key( tokens[0], atoi( tokens[1].c_str()), atoi( tokens[2].c_str()));
-
-		GridMapIterSpecial iter_grid = this->gridMapSpecial.find( key);
-		//already in the map
-		if( iter_grid != this->gridMapSpecial.end()) {
-			RotamerGridSpecial* grid = &iter_grid->second;
-
-			ChiDistribution chis;
-			for( int i = 0; i < grid->n_chi - 1; i++) {
-				chis.means.push_back( atof( tokens[index_mean + i].c_str()));
-				chis.stds.push_back( atof( tokens[index_std + i].c_str()));
-			}
-			chis.prob = atof( tokens[index_prob].c_str());
-			grid->acc_rotamer.push_back( grid->acc_rotamer.back() + chis.prob);
-			grid->dist_rotamer.push_back( chis);
-
-			vector<double> chi2_dist;
-			vector<double> chi2_dist_acc; chi2_dist_acc.push_back(0);
-			for( int i = index_t; i < size_tokens; i++) {
-				chi2_dist.push_back( atof( tokens[i].c_str()));
-				chi2_dist_acc.push_back( chi2_dist_acc.back() + chi2_dist.back());
-			}
-			chi2_dist_acc[ chi2_dist_acc.size() - 1] = 1; //NOTE: Awkward method, atof lost precision 10(-4);
-			grid->chi_terminal.push_back( chi2_dist);
-			grid->acc_terminal.push_back( chi2_dist_acc);
+		int phi = atoi( tokens[1].c_str());
+		int psi = atoi( tokens[2].c_str());
+		if( grids.empty() || grids.back().phi != phi || grids.back().psi != psi) {
+			RotamerImageGrid grid = { phi, psi, (int32_t)probs.size(), 0};
+			grids.push_back( grid);
 		}
-		else {
-			RotamerGridSpecial grid;
-			grid.n_chi = (index_prob == 5 ? 2: 3);
-
-			grid.degree_begin = this->degree_start[res_index];
-			grid.degree_end = this->degree_end[res_index];
-			grid.stepLength = this->stepLength[res_index];
-
-			ChiDistribution chis;
-			for( int i = 0; i < grid.n_chi - 1; i++) {
-				chis.means.push_back( atof( tokens[index_mean + i].c_str()));
-				chis.stds.push_back( atof( tokens[index_std + i].c_str()));
-			}
-			chis.prob = atof( tokens[index_prob].c_str());
-			grid.acc_rotamer.push_back(0);
-			grid.acc_rotamer.push_back( chis.prob);
-			grid.dist_rotamer.push_back( chis);
-
-			vector<double> chi2_dist_acc; chi2_dist_acc.push_back(0);
-			vector<double> chi2_dist;
-
-			for( int i = index_t; i < size_tokens; i++) {
-				chi2_dist.push_back( atof( tokens[i].c_str()));
-				grid.dist_terminal.push_back( this->degree_start[res_index] + this->stepLength[res_index] * (i - index_t));
-				chi2_dist_acc.push_back( chi2_dist.back() + chi2_dist_acc.back());
-			}
-//			NOTE:
-			chi2_dist_acc[ chi2_dist_acc.size() - 1] = 1; //NOTE: Awkward method, atof lost precision
-			grid.chi_terminal.push_back( chi2_dist);
-			grid.acc_terminal.push_back( chi2_dist_acc);
-
-			this->gridMapSpecial.insert( std::pair< RotamerGridKey, RotamerGridSpecial>( key, grid));
+		probs.push_back( atof( tokens[index_prob].c_str()));
+		for( int i = 0; i < RotamerImage::MAX_CHI; i++) {
+			means.push_back( i < header.n_chi - 1 ? atof( tokens[index_mean + i].c_str()) : 0);
+			stds.push_back( i < header.n_chi - 1 ? atof( tokens[index_std + i].c_str()) : 0);
+		}
+		//The densities of the terminal chi angle sum to 1 up to the precision of the library; the alias table normalizes them.
+		for( int i = index_t; i < size_tokens; i++) {
+			terminal.push_back( atof( tokens[i].c_str()));
 		}
+		grids.back().count += 1;
 	}
 	libin.close();
+	library->image.build( libname, header, grids, probs, means, stds, terminal);
+	this->saveImage( libname, library);
 	return;
 }
 
-RotamerGridKey::RotamerGridKey(const string& name, const int& phi, const int& psi) {
-	this->name = name;
-	this->phi = phi;
-	this->psi = psi;
-	return;
+void Rotamer::saveImage(const string& libname, RotamerLibrary* library) {
+	string filename = RotamerImage::getFilename( libname);
+	//Map the image just written so that processes share its pages. The data folder may be read-only;
+	//the library is then parsed every time and kept in memory.
+	if( library->image.write( filename))
+		library->image.open( filename, libname);
+	library->init();
 }
 
-string RotamerGridKey::toString() const {
-	string s = "";
-	s += this->name;
-	s += "\t";
-	s += this->phi;
-	s += "\t";
-	s += this->psi;
-	return s;
-}
-
-void RotamerGridKey::print() const {
-	cout << this->name << "\t" << this->phi << "\t" << this->psi;
-	return;
-}
-
-bool RotamerGridKey::operator ==(const RotamerGridKey& rhv) const {
-	if( (this->name == rhv.name) && ( this->phi == rhv.phi) && ( this->psi == rhv.psi)) {
-		return true;
-	}
-	return false;
-}
-
-
-bool RotamerGridKeyComparator::operator ()(RotamerGridKey k1, RotamerGridKey k2) const {
-	if( k1.name < k2.name) {
-		return true;
-	}
-	else if( k1.phi < k2.phi && k1.name == k2.name) {
-		return true;
-	}
-	else if( k1.psi < k2.psi && k1.name == k2.name && k1.phi == k2.phi) {
-		return true;
-	}
-	return false;
-}
-
-void Rotamer::sample_common(const string& residue_name, const int& phi, const int& psi, int& rotamerIndex, vector<double>& dAngles) {
-		RotamerGridKey key( residue_name, phi, psi);
-		GridMapIter iter = this->gridMap.find( key);
-		if( iter == this->gridMap.end()) {
-			cerr << "No matched item? There must be something wrong! sample_common" << endl;
-			cout << "key:" << key.name << "\t" << key.phi << "\t" << key.psi << endl;
-			abort();
-		}
-
-		RotamerGrid* dist = &iter->second;
-
-		double prob = Random::nextDouble( dist->acc_rotamer.back()) - 0.000000001; if( prob < 0) prob = 0.000000001;
-		int index = BinarySearch::search( dist->acc_rotamer, prob) - 1;
+void Rotamer::sample_common(const RotamerLibrary* library, const RotamerImageGrid* grid, int& rotamerIndex, vector<double>& dAngles) {
+		const RotamerImage& image = library->image;
+		int first = grid->first;
+		int index = AliasTable::sample( image.getRotamerAliasProbs() + first, image.getRotamerAliases() + first, grid->count, Random::nextDouble( 1));
 
 		assert( dAngles.size() == 0);
-		if (!( index <= dist->dist_rotamer.size() && index >= 0)) {
-			cout << "i_max:" << dist->dist_rotamer.size()<< endl;;
-			cout << "i:" << index << endl;
-			cout << "prob:" << prob << endl;
-			for( int i = 0; i < dist->acc_rotamer.size(); i++) {
-				cout << dist->acc_rotamer[i] << "\t";
-			}
-			cout << endl;
-			abort();
-		}
-		const ChiDistribution* rotamer_dist = &dist->dist_rotamer[index];
-		cout << endl;
-		for( int i = 0; i < dist->n_chi; i++) {
-			double mean = rotamer_dist->means[i];
-			double std = rotamer_dist->stds[i];
-			dAngles.push_back( Random::nextNormal( mean, std));
+		const double* means = image.getMeans() + (first + index) * RotamerImage::MAX_CHI;
+		const double* stds = image.getStds() + (first + index) * RotamerImage::MAX_CHI;
+		for( int i = 0; i < image.getHeader()->n_chi; i++) {
+			dAngles.push_back( Random::nextNormal( means[i], stds[i]));
 		}
 		rotamerIndex = index;
 		return;
 }
 
-void Rotamer::sample_Special(const string& residue_name, const int& phi, const int& psi, int& rotamerIndex, vector<double>& dAngles) {
-	RotamerGridKey key( residue_name, phi, psi);
-	GridMapIterSpecial iter = this->gridMapSpecial.find( key);
-	if( iter == this->gridMapSpecial.end()) {
-		cerr << "No matched item? There must be something wrong! sample_special" << endl;
-		cout << "key:" << key.name << "\t" << key.phi << "\t" << key.psi << endl;
-		abort();
-	}
-	RotamerGridSpecial* dist = &iter->second;
-
-	double prob_rotamer = Random::nextDouble( dist->acc_rotamer.back()) - 0.00001; if( prob_rotamer < 0) prob_rotamer = 0.00001;
-	int index = BinarySearch::search( dist->acc_rotamer, prob_rotamer) - 1;
+void Rotamer::sample_Special(const RotamerLibrary* library, const RotamerImageGrid* grid, int& rotamerIndex, vector<double>& dAngles) {
+	const RotamerImage& image = library->image;
+	const RotamerImageHeader* header = image.getHeader();
+	int first = grid->first;
+	int index = AliasTable::sample( image.getRotamerAliasProbs() + first, image.getRotamerAliases() + first, grid->count, Random::nextDouble( 1));
 
 	assert( dAngles.size() == 0);
 
-	const ChiDistribution* rotamer_dist = &dist->dist_rotamer[index];
-	for( int i = 0; i < dist->n_chi - 1; i++) {
-		double mean = rotamer_dist->means[i];
-		double std = rotamer_dist->stds[i];
-		dAngles.push_back( Random::nextNormal( mean, std));
+	int r = first + index;
+	const double* means = image.getMeans() + r * RotamerImage::MAX_CHI;
+	const double* stds = image.getStds() + r * RotamerImage::MAX_CHI;
+	for( int i = 0; i < header->n_chi - 1; i++) {
+		dAngles.push_back( Random::nextNormal( means[i], stds[i]));
 	}
 	//handle the terminal chi
-	double prob_terminal = Random::nextDouble(1) - 0.000001; if( prob_terminal < 0) prob_terminal = 0.00001;
-	int index_terminal = BinarySearch::search( dist->acc_terminal[index], prob_terminal) - 1;
-	double chi_terminal = dist->degree_begin + index_terminal * dist->stepLength;
+	int T = header->size_terminal;
+	int index_terminal = AliasTable::sample( image.getTerminalAliasProbs() + r * T, image.getTerminalAliases() + r * T, T, Random::nextDouble( 1));
+	double chi_terminal = header->degree_begin + index_terminal * header->step_length;
 	dAngles.push_back( chi_terminal);
 
 	rotamerIndex = index;
@@ -506,6 +487,17 @@ void Rotamer::init() {
 	//Non-rotameric amino acids with 3 chis
 	this->typeMap.insert( std::pair< string, int>( "GLN", 6));
 	this->typeMap.insert( std::pair< string, int>( "GLU", 7));
+
+	//Residue types: rotameric residues, then non-rotameric residues, each in alphabetical order
+	for( int special = 0; special <= 1; special++) {
+		for( map<string, int>::iterator iter = this->typeMap.begin(); iter != this->typeMap.end(); iter++) {
+			if( (iter->second >= 0) != (special == 1))
+				continue;
+			this->residueTypes.insert( std::pair< string, int>( iter->first, this->residueNames.size()));
+			this->residueNames.push_back( iter->first);
+		}
+	}
+	this->libraries.assign( this->residueNames.size(), NULL);
 }
 
 void Rotamer::initSidechainDatabase(PProtein* protein) {
@@ -538,38 +530,28 @@ void Rotamer::initSidechainDatabase(PProtein* protein) {
 					residue->getAtomPosition(rotList[3]));
 			curChi.push_back( curDihedral);
 		}
-		int phi = (int)(da_backbone[j].phi / 10) * 10;
-		int psi = (int)(da_backbone[j].psi / 10) * 10;
-		RotamerGridKey key( name, phi, psi);
-		if( !this->isSpecial( name)) {
-			GridMapIter iter = this->gridMap.find( key);
-			assert( iter != this->gridMap.end());
-
-			double error = numeric_limits<double>::max( );
-			int rotamerIndex = -1;
-			for( int k = 0; k < iter->second.dist_rotamer.size(); k++) {
-				double temp = Utility::dist(curChi, iter->second.dist_rotamer[k].means, chiMax);
-				if( error > temp) {
-					error = temp;
-					rotamerIndex = k;
-				}
+		int type = this->getResidueType( name);
+		const RotamerImageGrid* grid = this->getGrid( type, da_backbone[j].phi, da_backbone[j].psi);
+		const RotamerImage& image = this->libraries[type]->image;
+		//The terminal chi angle of non-rotameric residues is not a rotamer mean.
+		int n_chi = image.getHeader()->special ? chiMax - 1 : chiMax;
+		int n_means = image.getHeader()->special ? image.getHeader()->n_chi - 1 : image.getHeader()->n_chi;
+		Debug::check( n_chi > 0 && n_chi <= n_means, "Rotamer: chi angles do not match the library of " + name);
+
+		double error = numeric_limits<double>::max( );
+		int rotamerIndex = -1;
+		for( int k = 0; k < grid->count; k++) {
+			const double* means = image.getMeans() + (grid->first + k) * RotamerImage::MAX_CHI;
+			double temp = 0;
+			for( int i = 0; i < n_chi; i++) {
+				temp += (curChi[i] - means[i]) * (curChi[i] - means[i]);
 			}
-			residue->type_sidechain = rotamerIndex;
-		}
-		else {
-			GridMapIterSpecial iter = this->gridMapSpecial.find( key);
-			assert( iter != this->gridMapSpecial.end());
-			double error = numeric_limits<double>::max( );
-			int rotamerIndex = -1;
-			for( int k = 0; k < iter->second.dist_rotamer.size(); k++) {
-				double temp = Utility::dist(curChi, iter->second.dist_rotamer[k].means,  chiMax - 1);
-				if( error > temp) {
-					error = temp;
-					rotamerIndex = k;
-				}
+			if( error > temp) {
+				error = temp;
+				rotamerIndex = k;
 			}
-			residue->type_sidechain = rotamerIndex;
 		}
+		residue->type_sidechain = rotamerIndex;
 	}
 
 }
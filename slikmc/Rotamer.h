@@ -12,105 +12,57 @@
 #include <iostream>
 #include <map>
 #include <PProtein.h>
+#include "Utility.h"
+#include "RotamerImage.h"
 using namespace std;
 
-class ChiDistribution;
-class RotamerGrid;
-class RotamerGridSpecial;
-class RotamerGridKey;
-class Rotamer;
-
-/**
- * @brief An auxiliary class for class Rotamer. A Comparator to compare two RotamerGridKeys.
- */
-struct RotamerGridKeyComparator {
-     bool operator()(RotamerGridKey lhv, RotamerGridKey rhv) const;
-};
-
-typedef map<RotamerGridKey, RotamerGrid, RotamerGridKeyComparator> GridMap;
-typedef map<RotamerGridKey, RotamerGridSpecial, RotamerGridKeyComparator> GridMapSpecial;
-typedef map<RotamerGridKey, RotamerGrid, RotamerGridKeyComparator>::iterator GridMapIter;
-typedef map<RotamerGridKey, RotamerGridSpecial, RotamerGridKeyComparator>::iterator GridMapIterSpecial;
-
-/**
- * @brief An auxiliary class for class Rotamer. This class is a data structure for storing a specific rotamer in one dihedral angle grid.
- */
-class ChiDistribution {
-public:
-	double prob;
-	vector< double> means;
-	vector< double> stds;
-};
-
 /**
- * @brief An auxilliary class for class Rotamer. This class is a data structure for storing all rotamers in one dihedral angle grid.
+ * @brief An auxiliary class for class Rotamer. The rotamer library of one residue type: a dense grid index over the arrays of a compiled image.
+ * All rotamers of one (phi, psi) grid are contiguous in the image, therefore a lookup is pointer arithmetic.
  */
-class RotamerGrid{
-	friend class Rotamer;
+class RotamerLibrary {
 public:
-	//number of effective chi angles
-	int n_chi;
-	vector<double> acc_rotamer;
-	//accumulated distribution for each rotamer
-	vector<ChiDistribution> dist_rotamer;
-};
+	RotamerLibrary();
 
-/**
- * @brief An auxilliary class for class Rotamer. This class extends RotamerGrid and it adds additional structures for storing non-rotameric residues {ASN, ASP, PHE, TRP, HIS, TYR, GLN, GLU}.
- */
-class RotamerGridSpecial: public RotamerGrid {
-	friend class Rotamer;
-public:
-	int degree_begin;
-	int degree_end;
-	int stepLength;
-	bool check() const;
-	vector<double> dist_terminal;
-	vector< vector<double> > acc_terminal;
-	vector< vector<double> > chi_terminal;
-};
-
-/**
- * @brief An auxilliary class for class Rotamer. This class used as a key to access one RotamerGrid in the map structure.
- */
-class RotamerGridKey {
-	friend class Rotamer;
-	friend struct RotamerGridKeyComparator;
-public:
 	/**
-	 * @brief Constructor
-	 * @param name residue name
-	 * @param phi backbone phi angle in 10 base
-	 * @param psi backebone psi angle in 10 base
+	 * @brief Index the grids of the image.
 	 */
-	RotamerGridKey( const string& name, const int& phi, const int& psi);
+	void init();
 
 	/**
-	 * @brief Get a string containing residue name, backbone phi and psi angles.
-	 * @return a string
+	 * @brief Get the grid of a pair of backbone angles.
+	 * @param phi backbone phi angle in 10 base
+	 * @param psi backbone psi angle in 10 base
+	 * @return the grid, NULL if the library has no such grid
 	 */
-	string toString() const;
+	inline const RotamerImageGrid* getGrid( const int phi, const int psi) const {
+		int x = (phi + 180) / 10;
+		int y = (psi + 180) / 10;
+		if( x < 0 || x >= NUM_BINS || y < 0 || y >= NUM_BINS)
+			return NULL;
+		return this->grids[x * NUM_BINS + y];
+	}
 
 	/**
-	 * @brief Print the residue name, backbone phi,psi angles.
+	 * @brief The compiled library, mapped or built in memory.
 	 */
-	void print() const;
+	RotamerImage image;
 
 	/**
-	 * @brief "==" operator override to compare two RotemerGridKeys.
-	 * @param key an instance of RotamerGridKey
-	 * @return true, same; otherwise, false
+	 * @brief Backbone angles -180, -170, ..., 180.
 	 */
-    bool operator==(const RotamerGridKey& key) const;
+	static const int NUM_BINS = 37;
+
 private:
-	string name;
-	int phi;
-	int psi;
+	const RotamerImageGrid* grids[NUM_BINS * NUM_BINS];
 };
 
 /**
  * @brief The class Rotamer is used to initialize side-chain database by parsing Dunbrack's Backbone Dependent Rotamer Library,
  * sample one side-chain conformation for a given residue, evaluate the probability given one side-chain conformation.
+ *
+ * Residues are identified by a residue type (see getResidueType()); callers evaluating the same chain repeatedly should
+ * look the types up once and use the functions taking a type.
  */
 class Rotamer {
 public:
@@ -121,34 +73,42 @@ public:
 	Rotamer(PProtein* protein);
 
 	/**
-	 * @brief Randomly sample side-chain chi angles given residue name and backbone dihedral angle pair
-	 * @param residue_name name of the residue
-	 * @param phi backbone phi angle
-	 * @param psi backbone psi angle
-	 * @param rotamer_grid stores the grid index of rotamer in the rotamer database (for evaluation purpose)
-	 * @param dAngles stores the side-chain chi angles
+	 * @brief Constructor of an empty database, used to compile libraries.
 	 */
-	void sample( const string& residue_name, const double& phi, const double& psi, int& rotamer_grid, vector<double>& dAngles);
+	Rotamer();
 
 	/**
-	 * @brief Randomly sample side-chain chi angles given rotameric residue name and backbone dihedral angle pair
-	 * @param residue_name name of the residue
-	 * @param phi backbone phi angle
-	 * @param psi backbone psi angle
-	 * @param rotamer_grid stores the grid index of rotamer in the rotamer database (for evaluation purpose)
-	 * @param dAngles stores the side-chain chi angles
+	 * @brief Destructor
+	 */
+	virtual ~Rotamer();
+
+	/**
+	 * @brief Parse the library of a residue and write its compiled image (see RotamerImage), replacing an existing image.
+	 * @param res_name residue name
+	 * @return true if the image is written
 	 */
-	void sample_common( const string& residue_name, const int& phi, const int& psi, int& rotamer_grid, vector<double>& dAngles);
+	bool compile( const string& res_name);
 
 	/**
-	 * @brief Randomly sample side-chain chi angles given non-rotameric residue name and backbone dihedral angle pair
+	 * @brief Get the residue type of a residue name.
+	 * @return index of the library of the residue, -1 for residues without rotamers (ALA, GLY)
+	 */
+	int getResidueType( const string& residue_name);
+
+	/**
+	 * @brief Randomly sample side-chain chi angles given residue name and backbone dihedral angle pair
 	 * @param residue_name name of the residue
 	 * @param phi backbone phi angle
 	 * @param psi backbone psi angle
 	 * @param rotamer_grid stores the grid index of rotamer in the rotamer database (for evaluation purpose)
 	 * @param dAngles stores the side-chain chi angles
 	 */
-	void sample_Special( const string& residue_name, const int& phi, const int& psi, int& rotamer_grid, vector<double>& dAngles);
+	void sample( const string& residue_name, const double& phi, const double& psi, int& rotamer_grid, vector<double>& dAngles);
+
+	/**
+	 * @brief Same as above given the residue type.
+	 */
+	void sample( const int type, const double phi, const double psi, int& rotamer_grid, vector<double>& dAngles);
 
 	/**
 	 * @brief Output the database to a file
@@ -165,7 +125,19 @@ public:
 	 * @return probability density in logarithm
 	 */
 	double evalSidechain_log(PChain* chain, const int s, const int e);
-//	double evalResidue(const string& residue_name, const double& phi, const double& psi, const int& rotamer_index, const vector<double>& angles);
+
+	/**
+	 * @brief Evaluate the side-chain structure of one residue
+	 * @param residue the residue to be evaluated
+	 * @param backbone backbone dihedral angles of the residue
+	 * @return probability density in logarithm, 0 for residues without rotamers
+	 */
+	double evalResidue_log(PResidue* residue, const DihedralAngle& backbone);
+
+	/**
+	 * @brief Same as above given the residue type.
+	 */
+	double evalResidue_log(PResidue* residue, const int type, const DihedralAngle& backbone);
 
 	/**
 	 * @brief Initialize sidechain database according to residues the protein contains
@@ -183,17 +155,40 @@ private:
 	/**
 	 * @brief Read sidechain library given the name of a rotameric residue and construct corresponding database
 	 * @param res_name residue name
+	 * @param library stores the parsed library
 	 */
-	void read_common( const string& res_name);
+	void read_common( const string& res_name, RotamerLibrary* library);
 
 	/**
 	 * @brief Read sidechain library given the name of a non-rotameric residue and construct corresponding database
 	 * @param res_name residue name
+	 * @param library stores the parsed library
+	 */
+	void read_special( const string& res_name, RotamerLibrary* library);
+
+	/**
+	 * @brief Save a library parsed from text as an image next to the text library and map it.
+	 * If the image cannot be written, the library keeps the image built in memory.
+	 */
+	void saveImage( const string& libname, RotamerLibrary* library);
+
+	/**
+	 * @brief Location of the text library of a residue.
+	 */
+	string getLibraryName( const string& res_name);
+
+	/**
+	 * @brief Get the grid of a residue type, abort if there is none.
 	 */
-	void read_special( const string& res_name);
+	const RotamerImageGrid* getGrid( const int type, const double phi, const double psi);
 
-	GridMap gridMap;
-	GridMapSpecial gridMapSpecial;
+	void sample_common( const RotamerLibrary* library, const RotamerImageGrid* grid, int& rotamerIndex, vector<double>& dAngles);
+	void sample_Special( const RotamerLibrary* library, const RotamerImageGrid* grid, int& rotamerIndex, vector<double>& dAngles);
+
+	/**
+	 * @brief Libraries indexed by residue type, NULL if not read.
+	 */
+	vector<RotamerLibrary*> libraries;
 
 	//For special amino acids.
 	vector<int> degree_start;
@@ -222,6 +217,15 @@ private:
 	 */
 	bool isSpecial( const string& res_name);
 	map<string, int> typeMap;
+
+	/**
+	 * @brief Residue type of every residue with rotamers.
+	 */
+	map<string, int> residueTypes;
+	/**
+	 * @brief Residue names by residue type.
+	 */
+	vector<string> residueNames;
 };
 
 #endif /* ROTAMER_H_ */
@@ -0,0 +1,235 @@
+/*
+ * RotamerImage.cc
+ *
+ *  Created on: Oct 17, 2026
+ */
+
+#include "RotamerImage.h"
+#include "Utility.h"
+#include <string.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+
+static const char ROTAMER_IMAGE_MAGIC[8] = { 'S', 'L', 'I', 'K', 'R', 'O', 'T', '1'};
+static const uint32_t ROTAMER_IMAGE_BYTE_ORDER = 0x01020304;
+static const uint32_t ROTAMER_IMAGE_VERSION = 2;
+
+/**
+ * @brief Size of the image with the given header.
+ */
+static size_t imageLength( const RotamerImageHeader& header) {
+	size_t n = header.num_rotamers;
+	size_t n_terminal = n * header.size_terminal;
+	size_t doubles = n + 2 * n * RotamerImage::MAX_CHI + n_terminal + n + n_terminal;
+	size_t ints = n + n_terminal;
+	return sizeof( RotamerImageHeader) + header.num_grids * sizeof( RotamerImageGrid) + doubles * sizeof( double)
+			+ (ints + ints % 2) * sizeof( int32_t);
+}
+
+RotamerImage::RotamerImage() {
+	this->fd = -1;
+	this->data = NULL;
+	this->close();
+}
+
+RotamerImage::~RotamerImage() {
+	this->close();
+}
+
+bool RotamerImage::open(const string& filename, const string& source) {
+	//The current image is kept until the new one is validated.
+	struct stat st_source;
+	if( stat( source.c_str(), &st_source) != 0)
+		return false;
+	int fd = ::open( filename.c_str(), O_RDONLY);
+	if( fd < 0)
+		return false;
+	struct stat st;
+	if( fstat( fd, &st) != 0 || st.st_size < (off_t)sizeof( RotamerImageHeader)) {
+		::close( fd);
+		return false;
+	}
+	size_t length = st.st_size;
+	void* mapped = mmap( NULL, length, PROT_READ, MAP_SHARED, fd, 0);
+	if( mapped == MAP_FAILED) {
+		::close( fd);
+		return false;
+	}
+	const RotamerImageHeader* header = (const RotamerImageHeader*)mapped;
+
+	bool ok = memcmp( header->magic, ROTAMER_IMAGE_MAGIC, 8) == 0;
+	ok = ok && header->byte_order == ROTAMER_IMAGE_BYTE_ORDER;
+	ok = ok && header->version == ROTAMER_IMAGE_VERSION;
+	ok = ok && header->source_size == st_source.st_size && header->source_mtime == st_source.st_mtime;
+	ok = ok && header->num_grids >= 0 && header->num_rotamers >= 0 && header->size_terminal >= 0;
+	ok = ok && imageLength( *header) == length;
+	//The grids index the rotamer arrays, so a damaged grid would read outside the image.
+	const RotamerImageGrid* grids = (const RotamerImageGrid*)(header + 1);
+	for( int g = 0; ok && g < header->num_grids; g++)
+		ok = grids[g].first >= 0 && grids[g].count >= 0 && (int64_t)grids[g].first + grids[g].count <= header->num_rotamers;
+	if( !ok) {
+		munmap( mapped, length);
+		::close( fd);
+		return false;
+	}
+	this->close();
+	this->fd = fd;
+	this->length = length;
+	this->data = (const char*)mapped;
+	this->setSections();
+	return true;
+}
+
+void RotamerImage::build(const string& source, RotamerImageHeader header, const vector<RotamerImageGrid>& grids,
+		const vector<double>& probs, const vector<double>& means, const vector<double>& stds, const vector<double>& terminal) {
+	this->close();
+	struct stat st_source;
+	Debug::check( stat( source.c_str(), &st_source) == 0, "RotamerImage: cannot find " + source);
+	memcpy( header.magic, ROTAMER_IMAGE_MAGIC, 8);
+	header.byte_order = ROTAMER_IMAGE_BYTE_ORDER;
+	header.version = ROTAMER_IMAGE_VERSION;
+	header.num_grids = grids.size();
+	header.num_rotamers = probs.size();
+	header.source_size = st_source.st_size;
+	header.source_mtime = st_source.st_mtime;
+	Debug::check( means.size() == probs.size() * MAX_CHI && stds.size() == means.size(), "RotamerImage: chi angles do not match the rotamers");
+	Debug::check( terminal.size() == probs.size() * header.size_terminal, "RotamerImage: terminal densities do not match the rotamers");
+
+	this->length = imageLength( header);
+	this->buffer.assign( this->length / sizeof( uint64_t), 0);
+	char* p = (char*)&this->buffer[0];
+	this->data = p;
+	memcpy( p, &header, sizeof( RotamerImageHeader)); p += sizeof( RotamerImageHeader);
+	if( !grids.empty()) {
+		memcpy( p, &grids[0], grids.size() * sizeof( RotamerImageGrid)); p += grids.size() * sizeof( RotamerImageGrid);
+	}
+	if( !probs.empty()) {
+		memcpy( p, &probs[0], probs.size() * sizeof( double)); p += probs.size() * sizeof( double);
+		memcpy( p, &means[0], means.size() * sizeof( double)); p += means.size() * sizeof( double);
+		memcpy( p, &stds[0], stds.size() * sizeof( double)); p += stds.size() * sizeof( double);
+	}
+	if( !terminal.empty())
+		memcpy( p, &terminal[0], terminal.size() * sizeof( double));
+	this->setSections();
+
+	double* rotamer_alias_probs = (double*)this->rotamer_alias_probs;
+	int32_t* rotamer_aliases = (int32_t*)this->rotamer_aliases;
+	for( int g = 0; g < grids.size(); g++) {
+		int first = grids[g].first;
+		if( grids[g].count > 0)
+			AliasTable::build( &probs[first], grids[g].count, rotamer_alias_probs + first, rotamer_aliases + first);
+	}
+	int T = header.size_terminal;
+	double* terminal_alias_probs = (double*)this->terminal_alias_probs;
+	int32_t* terminal_aliases = (int32_t*)this->terminal_aliases;
+	for( int r = 0; T > 0 && r < probs.size(); r++) {
+		AliasTable::build( &terminal[r * T], T, terminal_alias_probs + r * T, terminal_aliases + r * T);
+	}
+}
+
+bool RotamerImage::write(const string& filename) const {
+	Debug::check( this->data != NULL, "RotamerImage: nothing to write");
+	//Write to a temporary file of this process and rename, so that a process never maps a partial image,
+	//and processes building the same library at once never write to the same file.
+	string pattern = filename + ".XXXXXX";
+	vector<char> tmp( pattern.begin(), pattern.end());
+	tmp.push_back( '\0');
+	int fd = mkstemp( &tmp[0]);
+	if( fd < 0)
+		return false;
+	bool ok = fchmod( fd, 0644) == 0;
+	ok = ok && Utility::writeFully( fd, this->data, this->length);
+	ok = ::close( fd) == 0 && ok;
+	ok = ok && rename( &tmp[0], filename.c_str()) == 0;
+	if( !ok)
+		unlink( &tmp[0]);
+	return ok;
+}
+
+void RotamerImage::setSections() {
+	const char* p = this->data;
+	this->header = (const RotamerImageHeader*)p; p += sizeof( RotamerImageHeader);
+	size_t n = this->header->num_rotamers;
+	size_t n_terminal = n * this->header->size_terminal;
+	this->grids = (const RotamerImageGrid*)p; p += this->header->num_grids * sizeof( RotamerImageGrid);
+	this->probs = (const double*)p; p += n * sizeof( double);
+	this->means = (const double*)p; p += n * MAX_CHI * sizeof( double);
+	this->stds = (const double*)p; p += n * MAX_CHI * sizeof( double);
+	this->terminal = (const double*)p; p += n_terminal * sizeof( double);
+	this->rotamer_alias_probs = (const double*)p; p += n * sizeof( double);
+	this->terminal_alias_probs = (const double*)p; p += n_terminal * sizeof( double);
+	this->rotamer_aliases = (const int32_t*)p; p += n * sizeof( int32_t);
+	this->terminal_aliases = (const int32_t*)p;
+}
+
+void RotamerImage::close() {
+	if( this->fd >= 0) {
+		munmap( (void*)this->data, this->length);
+		::close( this->fd);
+	}
+	this->buffer.clear();
+	this->fd = -1;
+	this->length = 0;
+	this->data = NULL;
+	this->header = NULL;
+	this->grids = NULL;
+	this->probs = NULL;
+	this->means = NULL;
+	this->stds = NULL;
+	this->terminal = NULL;
+	this->rotamer_alias_probs = NULL;
+	this->terminal_alias_probs = NULL;
+	this->rotamer_aliases = NULL;
+	this->terminal_aliases = NULL;
+}
+
+const RotamerImageHeader* RotamerImage::getHeader() const {
+	return this->header;
+}
+
+const RotamerImageGrid* RotamerImage::getGrids() const {
+	return this->grids;
+}
+
+const double* RotamerImage::getProbs() const {
+	return this->probs;
+}
+
+const double* RotamerImage::getMeans() const {
+	return this->means;
+}
+
+const double* RotamerImage::getStds() const {
+	return this->stds;
+}
+
+const double* RotamerImage::getTerminal() const {
+	return this->terminal;
+}
+
+const double* RotamerImage::getRotamerAliasProbs() const {
+	return this->rotamer_alias_probs;
+}
+
+const int32_t* RotamerImage::getRotamerAliases() const {
+	return this->rotamer_aliases;
+}
+
+const double* RotamerImage::getTerminalAliasProbs() const {
+	return this->terminal_alias_probs;
+}
+
+const int32_t* RotamerImage::getTerminalAliases() const {
+	return this->terminal_aliases;
+}
+
+string RotamerImage::getFilename(const string& source) {
+	string base = source;
+	if( base.size() > 4 && base.substr( base.size() - 4) == ".lib")
+		base = base.substr( 0, base.size() - 4);
+	return base + ".bin";
+}
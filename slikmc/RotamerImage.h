@@ -0,0 +1,159 @@
+/*
+ * RotamerImage.h
+ *
+ *  Created on: Oct 17, 2026
+ */
+
+#ifndef ROTAMERIMAGE_H_
+#define ROTAMERIMAGE_H_
+
+#include <vector.h>
+#include <string>
+#include <stdint.h>
+using namespace std;
+
+/*
+ * Compiled rotamer library of one residue type (native byte order, checked by a byte-order mark):
+ *
+ *   RotamerImageHeader
+ *   grids:          RotamerImageGrid for every (phi, psi) grid, in increasing (phi, psi) order
+ *   probs:          double, probability of every rotamer, grid by grid
+ *   means:          double[MAX_CHI], mean chi angles of every rotamer (unused entries are 0)
+ *   stds:           double[MAX_CHI], standard deviations of the chi angles of every rotamer
+ *   terminal:       double[size_terminal], density of the terminal chi angle of every rotamer (non-rotameric residues only)
+ *   rotamer alias:  double threshold of every rotamer, alias table of the rotamers of each grid (see AliasTable)
+ *   terminal alias: double[size_terminal] thresholds of every rotamer, alias table of its terminal chi angle
+ *   rotamer alias:  int32 alias of every rotamer, relative to the first rotamer of its grid
+ *   terminal alias: int32[size_terminal] aliases of every rotamer
+ *   padding to a multiple of 8 bytes
+ *
+ * Every section is a plain array starting at an aligned offset, so it is used in place from the mapped file.
+ */
+
+/**
+ * @brief Fixed-size header at the beginning of a rotamer image.
+ */
+struct RotamerImageHeader {
+	char magic[8];
+	uint32_t byte_order;
+	uint32_t version;
+	/**
+	 * @brief residue name as in the library, '\0'-terminated
+	 */
+	char name[8];
+	/**
+	 * @brief 1 for a non-rotameric residue read from a .densities.lib file
+	 */
+	int32_t special;
+	/**
+	 * @brief number of chi angles, including the terminal chi angle of non-rotameric residues
+	 */
+	int32_t n_chi;
+	int32_t num_grids;
+	int32_t num_rotamers;
+	/**
+	 * @brief terminal chi angle grid of non-rotameric residues: size_terminal steps of step_length from degree_begin
+	 */
+	int32_t size_terminal;
+	int32_t degree_begin;
+	int32_t degree_end;
+	int32_t step_length;
+	/**
+	 * @brief size and modification time of the text library the image was compiled from
+	 */
+	int64_t source_size;
+	int64_t source_mtime;
+};
+
+/**
+ * @brief One (phi, psi) grid of the library and its rotamers first to first + count - 1.
+ */
+struct RotamerImageGrid {
+	int32_t phi;
+	int32_t psi;
+	int32_t first;
+	int32_t count;
+};
+
+/**
+ * @brief A compiled rotamer library, either mapped read-only from a file or built in memory from a parsed text library.
+ * Processes mapping the same image share its pages.
+ *
+ * Parsing a text library of Data/ExtendedOpt1-5 takes seconds; the image is written next to it the first time
+ * the library is read, or for all libraries at once by tools/rotcompile, and is recompiled when the library changes.
+ */
+class RotamerImage {
+public:
+	RotamerImage();
+	~RotamerImage();
+
+	/**
+	 * @brief Map an image.
+	 * @param filename image file
+	 * @param source text library the image is compiled from
+	 * @return false if the image is missing, damaged, of another version or does not match the library;
+	 * the current image is unchanged then
+	 */
+	bool open( const string& filename, const string& source);
+
+	/**
+	 * @brief Build an image in memory and its alias tables.
+	 * @param source text library the arrays are parsed from
+	 * @param header name, special, n_chi, size_terminal and terminal chi angle grid of the residue; the rest is filled in
+	 */
+	void build( const string& source, RotamerImageHeader header, const vector<RotamerImageGrid>& grids,
+			const vector<double>& probs, const vector<double>& means, const vector<double>& stds, const vector<double>& terminal);
+
+	/**
+	 * @brief Write the image atomically.
+	 * @return true if the image is written
+	 */
+	bool write( const string& filename) const;
+
+	void close();
+
+	const RotamerImageHeader* getHeader() const;
+	const RotamerImageGrid* getGrids() const;
+	const double* getProbs() const;
+	const double* getMeans() const;
+	const double* getStds() const;
+	const double* getTerminal() const;
+	const double* getRotamerAliasProbs() const;
+	const int32_t* getRotamerAliases() const;
+	const double* getTerminalAliasProbs() const;
+	const int32_t* getTerminalAliases() const;
+
+	/**
+	 * @brief Image file of a text library: the ".lib" extension is replaced by ".bin".
+	 */
+	static string getFilename( const string& source);
+
+	static const int MAX_CHI = 4;
+
+private:
+	/**
+	 * @brief Set the section pointers of the image at data.
+	 */
+	void setSections();
+
+	int fd;
+	size_t length;
+	const char* data;
+	/**
+	 * @brief Storage of an image built in memory, 8-byte aligned.
+	 */
+	vector<uint64_t> buffer;
+
+	const RotamerImageHeader* header;
+	const RotamerImageGrid* grids;
+	const double* probs;
+	const double* means;
+	const double* stds;
+	const double* terminal;
+	const double* rotamer_alias_probs;
+	const double* terminal_alias_probs;
+	const int32_t* rotamer_aliases;
+	const int32_t* terminal_aliases;
+};
+
+#endif /* ROTAMERIMAGE_H_ */
@@ -19,24 +19,42 @@
 #include <iostream>
 #include <algorithm>
 #include <time.h>
+#include <unistd.h>
+#include <sys/wait.h>
 #include "Utility.h"
+#include "MetricTensor.h"
 #include "math/MatrixTemplate.h"
 #include "math/Gaussian.h"
 #include <Math/Matrix.h>
 using namespace Math;
 
-SLIKMCSampler::SLIKMCSampler(PProtein* protein) {
+static const char* STAGE_NAMES[NUM_ACCEPTANCE_STAGES] = { "Ramachandran", "B-factors", "side-chain", "custom", "proposal"};
+
+SLIKMCSampler::SLIKMCSampler(PProtein* protein, const int block_width, const int* pivots) : telemetry( "slikmc") {
 	this->protein = protein;
-	//every intermediate block overlaps three residues with succeeding block
-	int num_subchains = this->protein->size() - 3;
+	Debug::check( block_width >= 4 && block_width <= protein->size(), "Block width should be at least 4 and no more than the chain size");
+	this->block_width = block_width;
+	for( int i = 0; i < 3; i++) {
+		this->pivots[i] = pivots == NULL ? block_width - 3 + i : pivots[i];
+	}
+	Debug::check( this->pivots[0] > 0 && this->pivots[0] < this->pivots[1] && this->pivots[1] < this->pivots[2] && this->pivots[2] == block_width - 1,
+			"Pivots should be increasing, after the first residue and end at the last residue of a block");
+
+	//every intermediate block overlaps (block_width - 1) residues with succeeding block
+	int num_subchains = this->protein->size() - block_width + 1;
 	for (int i = 0; i < num_subchains; i++)
 	{
 		int start = i;
-		int end = i + 3;
+		int end = i + block_width - 1;
 		PProtein* chain = new PProtein(protein, start, end);
 		this->subchains.push_back(chain);
 	}
 
+	this->scheduling = SCHEDULE_SWEEP;
+	this->adapt_iterations = 0;
+	this->num_updates = 0;
+	this->num_run_blocks = 0;
+
 	this->init_Rotamer = false;
 	this->use_BFactor = false;
 	this->use_Rotamer = false;
@@ -45,6 +63,10 @@ SLIKMCSampler::SLIKMCSampler(PProtein* protein) {
 	this->use_customPrior = false;
 
 	this->rplot = new RamachandranPlot();
+	this->rplot_interpolate = false;
+	for( int i = 0; i < protein->size(); i++) {
+		this->rplot_class.push_back( RamachandranPlot::getResidueClass( protein, i));
+	}
 	this->freeEnd = false;
 
 	this->bfactor = NULL;
@@ -53,6 +75,22 @@ SLIKMCSampler::SLIKMCSampler(PProtein* protein) {
 	//For logging conformations
 	this->logFile = false;
 	this->skipLength = 0;
+	this->logCapacity = 64;
+	this->logBackpressure = BACKPRESSURE_BLOCK;
+	this->logFormat = LOG_PDB;
+
+	this->prior_block = -1;
+
+	this->use_delayedAcceptance = false;
+	this->stage_adapt_iterations = 0;
+	this->stage_fixed = false;
+
+	this->seed = 1;
+	this->checkpointInterval = 0;
+	this->resume = false;
+
+	this->diagnostics_chains = 0;
+	this->diagnostics_start = 0;
 	return;
 }
 
@@ -64,173 +102,156 @@ SLIKMCSampler::~SLIKMCSampler() {
 }
 
 void SLIKMCSampler::sample( const double time, const int s, const int e) {
+	SLIKMCStatistics stats;
+	this->sampleChain( time, s, e, "slikmc_", this->seed, this->checkpointFile, NULL, 0, stats);
+	this->resume = false;
+	this->diagnostics.assign( this->monitor.getNumTorsions(), TorsionSummary());
+	this->monitor.summarize( &this->diagnostics[0]);
+	this->diagnostics_chains = 1;
+	this->diagnostics_start = s;
 
-	Debug::check( s >= 0 && e >= s + 3 && e < this->protein->size(), "Sth wrong with the starting index and ending index");
-	clock_t begin = clock();
-	int size_protein = this->protein->size();
-	int num_subchains = size_protein - 3;
-
-	int stat_distinct = 0;
-	int stat_conformation = 0;
-
-	int s_chain = s;
-	int e_chain = e - 3;
-	int i = 0;
-	while( true) {
-		cout << "Start sampling conformation # " << i << ":" << endl;
-		bool changed = false;
-		for( int j = s_chain; j <= e_chain; j++) {
-			PProtein* subchain = this->subchains[j];
-			subchain->attachResidues(); 								//NOTE:This is necessary!
-			PChainState* state_subchain = subchain->saveChainState(); 	//Save the s
-
-			Vector3 endPriorG = subchain->getAtomAtRes(PID::C_ALPHA, 3)->getPos();;
-			Vector3 endG = subchain->getAtomAtRes(PID::C, 3)->getPos();
-			Vector3 endNextG = subchain->getAtomAtRes(PID::O, 3)->getPos();
-			int index_to_use[3] = { 1, 2, 3};
-			/*
-			 * calculate the importance ratio for the initial block.
-			 */
-			double P = this->getP_log( subchain);
-			IKSolutions iks_initial;
-			int n = PExactIKSolver::FindSolutions( subchain, index_to_use, &endPriorG, &endG, &endNextG, iks_initial);
-			int status = 0; //Record whether the metric tensor part can be calculated. -1: matrix cannot be inverted; 0: okay
-			double Q = this->getQ_log( subchain, n, status);
-			if( !(status == 0)) {
-				cout << "Calculating matrix failed in the first place" << endl;
-				//If calculating metric tensor not successful, then, move on to the next sub-chain.
-				continue;
-			}
-
-			int	num_MH_reject = 0;
-			int num_collision_reject = 0;
-
-			while( (num_MH_reject < MAX_METROPOLIS_REJECT) && (num_collision_reject < MAX_COLLISION_DETECT)) {
-				int n_proposal = 0;
-
-				int num_IK_fail = 0;
-				bool IK_success = false;
-				while( num_IK_fail < this->MAX_IK_SAMPLE) {
-					/* The (phi, psi) pair for the first residue is sampled from Ramachandran plot.
-					 * If the residue is not the first in the whole protein chain, then, both phi, psi are defined.
-					 * Therefore, sample (phi, psi) and rotate the two bonds.
-					 * Otherwise, phi will not have definition, then, we just rotate the first bond a little bit.
-					 */
-
-					if( this->use_RPlot) {
-						PResidue* residue = subchain->getResidue(0);
-						PResidue* residue_next = subchain->getResidue(1);
-						DihedralAngle* da_goal = this->rplot->getRandomDihedralAngle(residue->getName(), residue_next->getName());
-						DihedralAngle* da_curr = subchain->getDihedralAngleAtResidue(0);
-						if( j != 0) {
-							subchain->RotateChain_noGridUpdate("backbone", 0, forward, da_curr->phi - da_goal->phi);
-						}
-						else {
-							//The first residue in the chain
-							double range = 60;
-							double angle = (rand() % 100) / 100.0 * range - range / 2;
-							subchain->RotateChain_noGridUpdate("backbone", 0, forward, angle);
-						}
-						subchain->RotateChain_noGridUpdate("backbone", 1, forward, da_curr->psi - da_goal->psi);
-						delete da_goal;
-						delete da_curr;
-					}
-					else {
-						double phi_change = Random::nextNormal( 0, 10);
-						double psi_change = Random::nextNormal( 0, 10);
+	if( this->logFile) {
+		double t = Telemetry::now();
+		string filename = "../pdbfiles_out/info.txt";
+		ofstream out( filename.c_str());
+		out << "stat_distinct:\t" << stats.stat_distinct << endl;
+		out << "stat_conformation:\t" << stats.stat_conformation << endl;
+		out << "stat_dropped:\t" << stats.stat_dropped << endl;
+		out.flush();
+		out.close();
+		this->telemetry.record( Telemetry::OUTPUT, t);
+		this->telemetry.write( "../pdbfiles_out/telemetry.json", "../pdbfiles_out/telemetry.csv");
+		this->writeDiagnostics( "../pdbfiles_out/diagnostics.csv");
+	}
+}
 
-						subchain->RotateChain_noGridUpdate("backbone", 0, forward, phi_change);
-						subchain->RotateChain_noGridUpdate("backbone", 1, forward, psi_change);
-					}
+SLIKMCStatistics SLIKMCSampler::sampleParallel( const double time, const int s, const int e, int num_chains, const unsigned int seed) {
+	Debug::check( s >= 0 && e >= s + this->block_width - 1 && e < this->protein->size(), "Sth wrong with the starting index and ending index");
+	if( num_chains <= 0) {
+		num_chains = (int)sysconf( _SC_NPROCESSORS_ONLN);
+		if( num_chains <= 0)
+			num_chains = 1;
+	}
+	cout.flush();
+
+	/*
+	 * LoopTK keeps global state (random number generator, IK solver, resources),
+	 * therefore every chain runs in a forked worker process. The worker inherits a private
+	 * copy-on-write image of the protein and its blocks and reports its statistics through a pipe.
+	 */
+	//Chains publish their convergence diagnostics to shared memory, so any chain can stop all of them.
+	ConvergenceBoard board( num_chains, 2 * (e - s + 1));
+	vector<pid_t> workers;
+	vector<int> pipes;
+	for( int k = 0; k < num_chains; k++) {
+		int fd[2];
+		Debug::check( pipe( fd) == 0, "Cannot create pipe for sampling worker");
+		pid_t pid = fork();
+		Debug::check( pid >= 0, "Cannot fork sampling worker");
+		if( pid == 0) {
+			close( fd[0]);
+			stringstream ss;
+			ss << "slikmc_c" << k << "_";
+			stringstream cs;
+			cs << this->checkpointFile << "_c" << k;
+			SLIKMCStatistics stats;
+			this->sampleChain( time, s, e, ss.str(), seed, cs.str(), &board, k, stats);
+			cout.flush();
+			ssize_t written = write( fd[1], &stats, sizeof( SLIKMCStatistics));
+			bool sent = this->telemetry.send( fd[1]);
+			close( fd[1]);
+			_exit( written == sizeof( SLIKMCStatistics) && sent ? 0 : 1);
+		}
+		close( fd[1]);
+		workers.push_back( pid);
+		pipes.push_back( fd[0]);
+	}
 
-					/* Use analytical IK to close the sub-loop using the rest 6 DOFs
-					 */
-					IKSolutions iks;
-					// Here, call a modified IK solver which returns only one solution and the number of possible solutions.
-					n_proposal = PExactIKSolver::FindSolutions( subchain, index_to_use, &endPriorG, &endG, &endNextG, iks);
-					if( n_proposal > 0) {
-						assert( iks.size() == 1);
-						subchain->MultiRotate_noGridUpdate(iks[0]);
-
-						/* optional: free end comformation sampling
-						 * We perturb the two ends therefore, we get variations on the two ends.
-						 */
-						if( this->freeEnd)
-							if( j == 0) {
-								//NOTE: Method 1
-								double range = 60;
-								double angle = (rand() % 100) / 100.0 * range - range / 2;
-								subchain->RotateChain_noGridUpdate( "backbone", 2, backward, angle);
-							}
-							else if( j == num_subchains - 1) {
-								//NOTE: Method 1
-								double range = 60;
-								double angle = (rand() % 100) / 100.0 * range - range / 2;
-								subchain->RotateChain_noGridUpdate( "backbone", 5, forward, angle);
-							}
-						IK_success = true;
-						break;
-					}
-					else {
-						//No IK solution
-						subchain->restoreChainState_noGridUpdate( state_subchain);
-						num_IK_fail += 1;
-					}
-				}
+	SLIKMCStatistics total;
+	vector<SLIKMCStatistics> chain_stats( num_chains);
+	this->telemetry.reset( this->subchains.size());
+	for( int k = 0; k < num_chains; k++) {
+		Telemetry chain_telemetry;
+		ssize_t n = read( pipes[k], &chain_stats[k], sizeof( SLIKMCStatistics));
+		bool received = chain_telemetry.receive( pipes[k]);
+		close( pipes[k]);
+		int status = 0;
+		waitpid( workers[k], &status, 0);
+		if( n != sizeof( SLIKMCStatistics) || !received || !WIFEXITED( status) || WEXITSTATUS( status) != 0) {
+			cerr << "Sampling chain # " << k << " did not finish properly" << endl;
+			chain_stats[k] = SLIKMCStatistics();
+			continue;
+		}
+		total.stat_distinct += chain_stats[k].stat_distinct;
+		total.stat_conformation += chain_stats[k].stat_conformation;
+		total.stat_dropped += chain_stats[k].stat_dropped;
+		this->telemetry.merge( chain_telemetry);
+	}
+	this->resume = false;
+	board.getSummaries( this->diagnostics);
+	this->diagnostics_chains = num_chains;
+	this->diagnostics_start = s;
 
-				if( IK_success == false) {
-//					cout << " No change to subchain # " << j << " due to IK failure." << endl;;
-					break;
-				}
-				/*
-				 * optional: add the side chain handling.
-				 */
-				if( this->use_Rotamer) {
-					vector<DihedralAngle> bbangles; subchain->getDihedralAngles( bbangles);
-					this->scRotater->rotateSidechain( subchain, bbangles);
-				}
+	if( this->logFile) {
+		string filename = "../pdbfiles_out/info.txt";
+		ofstream out( filename.c_str());
+		for( int k = 0; k < num_chains; k++) {
+			out << "chain " << k << " stat_distinct:\t" << chain_stats[k].stat_distinct << endl;
+			out << "chain " << k << " stat_conformation:\t" << chain_stats[k].stat_conformation << endl;
+			out << "chain " << k << " stat_dropped:\t" << chain_stats[k].stat_dropped << endl;
+		}
+		out << "stat_distinct:\t" << total.stat_distinct << endl;
+		out << "stat_conformation:\t" << total.stat_conformation << endl;
+		out << "stat_dropped:\t" << total.stat_dropped << endl;
+		out.flush();
+		out.close();
+		this->writeSampleIndex( "../pdbfiles_out/samples.txt", chain_stats);
+		this->telemetry.write( "../pdbfiles_out/telemetry.json", "../pdbfiles_out/telemetry.csv");
+		this->writeDiagnostics( "../pdbfiles_out/diagnostics.csv");
+	}
+	return total;
+}
 
-				/*
-				 * calculate the importance ratio for the proposal block.
-				 */
-				double P_proposal = this->getP_log( subchain);
-				int status = 0;
-				double Q_proposal = this->getQ_log( subchain, n_proposal, status);
-				bool accept = false;
-				if( status != -1)
-					accept = this->MHStep( P, Q, P_proposal, Q_proposal);
-				else {
-					cout << "Reject since matrix is singular; Press any key to continue." << endl;
-				}
+void SLIKMCSampler::sampleChain( const double time, const int s, const int e, const string& prefix, const unsigned int seed, const string& checkpoint_file, ConvergenceBoard* board, const int chain, SLIKMCStatistics& stats) {
 
-				if( accept == true) {
-					//Must update before calling collision checking!
-					subchain->updateAtomsGrid();
+	Debug::check( s >= 0 && e >= s + this->block_width - 1 && e < this->protein->size(), "Sth wrong with the starting index and ending index");
+	this->telemetry.reset( this->subchains.size());
 
-					bool collision = false;
-					if( this->use_colChecking) {
-						collision = subchain->InAnyCollision();
-					}
+	stats = SLIKMCStatistics();
 
-					if( collision == false) {
-						changed = true;
-						cout << "Succeed: get an accepted conformation" << endl;
-						break;
-					}
-					else {
-						cout << "Failed: Collision detected" << endl;
-						num_collision_reject += 1;
-						subchain->restoreChainState_noGridUpdate( state_subchain);
-					}
-				}
-				else {
-					cout << "Failed: Rejected by Metropolis-Hasting step" << endl;
-					num_MH_reject += 1;
-					subchain->restoreChainState_noGridUpdate( state_subchain);
-				}
-			}
-			//Now we have a closed sub-chain loop, destroy the record for last state.
-			delete state_subchain;
+	//blocks starting from residue s_chain to residue e_chain cover the sub-loop
+	int s_chain = s;
+	int e_chain = e - this->block_width + 1;
+	int i = 0;
+	this->initSchedule( s_chain, e_chain);
+	this->monitor.reset( s, e);
+
+	Random::seed( seed, chain);
+	Checkpoint* checkpoint = NULL;
+	if( this->checkpointInterval > 0) {
+		checkpoint = new Checkpoint( checkpoint_file);
+		if( this->resume && checkpoint->exists()) {
+			Debug::check( checkpoint->load(), "Cannot read checkpoint " + checkpoint_file);
+			Debug::check( this->loadCheckpoint( *checkpoint, s, e, seed, i, stats), "Checkpoint " + checkpoint_file + " does not match the chain or the sampling settings");
+			cout << "Resume sampling from conformation # " << i << endl;
+		}
+	}
+	this->initPriorCache();
+	//Conformations are snapshotted in the sampling loop and written by a background thread.
+	SampleWriter* writer = NULL;
+	TrajectoryWriter* trajectory = NULL;
+	if( this->logFile && this->logFormat == LOG_TRAJECTORY)
+		trajectory = new TrajectoryWriter( this->getTrajectoryFile( prefix, i, checkpoint != NULL), this->protein, s, e);
+	else if( this->logFile)
+		writer = new SampleWriter( this->logCapacity, this->logBackpressure);
+	long dropped = stats.stat_dropped;
+	while( true) {
+		cout << "Start sampling conformation # " << i << ":" << endl;
+		bool changed = false;
+		for( int k = s_chain; k <= e_chain; k++) {
+			int j = this->nextBlock( k, s_chain, e_chain);
+			if( this->updateBlock( j))
+				changed = true;
 		}
 
 		/*
@@ -238,36 +259,373 @@ void SLIKMCSampler::sample( const double time, const int s, const int e) {
 		 * Move on to sample the next conformation based on the current one
 		 */
 		if( changed == true) {
-			stat_distinct += 1;
+			stats.stat_distinct += 1;
 		}
-		stat_conformation += 1;
+		stats.stat_conformation += 1;
+		this->monitor.add( this->protein);
 		if( this->logFile) {
 			if( (i + 1) % this->skipLength == 0) {
 				int index = (int)(i / this->skipLength);
 				stringstream ss;
 				ss << index;
-				PDBIO::writeToFile( this->protein, "../pdbfiles_out/slikmc_" + ss.str() + ".pdb");
+				double t = Telemetry::now();
+				if( trajectory != NULL)
+					trajectory->append( this->protein);
+				else
+					writer->write( this->protein, "../pdbfiles_out/" + prefix + ss.str() + ".pdb");
+				this->telemetry.record( Telemetry::OUTPUT, t);
 				cout << "***Record # " << index << endl;
 			}
 		}
 
 		cout << "done." << endl;
 		i = i + 1;
-		clock_t curr = clock();
-		if(( curr - begin) / 1000.0 > time) {
+		this->telemetry.finishIteration();
+		if( checkpoint != NULL && i % this->checkpointInterval == 0) {
+			/*
+			 * Conformations logged so far must be complete on disk before the checkpoint refers to them:
+			 * wait for the writer queue, or close the trajectory part and continue in a new one.
+			 */
+			double t = Telemetry::now();
+			if( writer != NULL) {
+				writer->flush();
+				stats.stat_dropped = dropped + writer->getDropped();
+			}
+			if( trajectory != NULL) {
+				trajectory->close();
+				delete trajectory;
+				trajectory = new TrajectoryWriter( this->getTrajectoryFile( prefix, i, true), this->protein, s, e);
+			}
+			this->saveCheckpoint( *checkpoint, s, e, seed, i, stats);
+			if( !checkpoint->commit())
+				cerr << "Cannot write checkpoint " << checkpoint_file << endl;
+			this->telemetry.record( Telemetry::OUTPUT, t);
+		}
+		if( this->isConverged( board, chain)) {
+			cout << "Converged!" << endl;
+			break;
+		}
+		if( this->telemetry.getWallTime() > time) {
 			cout << "Times up!" << endl;
 			break;
 		}
 	}
 
-	if( this->logFile) {
-		string filename = "../pdbfiles_out/info.txt";
-		ofstream out( filename.c_str());
-		out << "stat_distinct:\t" << stat_distinct << endl;
-		out << "stat_conformation:\t" << stat_conformation << endl;
-		out.flush();
-		out.close();
+	if( writer != NULL) {
+		double t = Telemetry::now();
+		writer->flush();
+		stats.stat_dropped = dropped + writer->getDropped();
+		delete writer;
+		this->telemetry.record( Telemetry::OUTPUT, t);
+	}
+	if( trajectory != NULL) {
+		double t = Telemetry::now();
+		trajectory->close();
+		delete trajectory;
+		this->telemetry.record( Telemetry::OUTPUT, t);
+	}
+	if( checkpoint != NULL)
+		delete checkpoint;
+}
+
+string SLIKMCSampler::getTrajectoryFile(const string& prefix, const int i, const bool parts) {
+	if( !parts)
+		return "../pdbfiles_out/" + prefix + "traj.bin";
+	stringstream ss;
+	ss << "../pdbfiles_out/" << prefix << "traj_" << i << ".bin";
+	return ss.str();
+}
+
+void SLIKMCSampler::writeSampleIndex(const string& filename, const vector<SLIKMCStatistics>& chain_stats) {
+	ofstream out( filename.c_str());
+	out << "sample\tchain\tfile\tframe" << endl;
+	long n = 0;
+	for( int k = 0; k < chain_stats.size(); k++) {
+		stringstream ss;
+		ss << "slikmc_c" << k << "_";
+		if( this->logFormat == LOG_TRAJECTORY) {
+			//With checkpoints, a part starts after every checkpoint; a part started by the last iteration holds no frames.
+			int step = this->checkpointInterval > 0 ? this->checkpointInterval : chain_stats[k].stat_conformation;
+			for( int i = 0; i < chain_stats[k].stat_conformation; i += step) {
+				string file = this->getTrajectoryFile( ss.str(), i, this->checkpointInterval > 0);
+				if( access( file.c_str(), R_OK) != 0)
+					continue;
+				TrajectoryReader reader( file);
+				for( long f = 0; f < reader.size(); f++)
+					out << n++ << "\t" << k << "\t" << file << "\t" << f << endl;
+			}
+		}
+		else {
+			//Samples dropped by the writer queue have no file.
+			for( int index = 0; index < chain_stats[k].stat_conformation / this->skipLength; index++) {
+				stringstream file;
+				file << "../pdbfiles_out/" << ss.str() << index << ".pdb";
+				if( access( file.str().c_str(), R_OK) == 0)
+					out << n++ << "\t" << k << "\t" << file.str() << "\t" << 0 << endl;
+			}
+		}
+	}
+	out.close();
+}
+
+void SLIKMCSampler::getCheckpointSettings(const int s, const int e, const unsigned int seed, vector<int>& settings) {
+	int values[] = { this->use_BFactor, this->use_Rotamer, this->freeEnd, this->use_colChecking, this->use_RPlot,
+			this->rplot->getGridNum(), this->rplot_interpolate, this->use_customPrior, (int)this->priors.size(), this->logFile, this->skipLength, this->logFormat,
+			this->block_width, this->pivots[0], this->pivots[1], this->pivots[2], this->scheduling, this->adapt_iterations,
+			this->checkpointInterval, this->protein->size(), s, e, (int)seed, this->use_delayedAcceptance, this->stage_adapt_iterations};
+	settings.assign( values, values + sizeof( values) / sizeof( int));
+	settings.insert( settings.end(), this->stage_order.begin(), this->stage_order.end());
+}
+
+void SLIKMCSampler::saveCheckpoint(Checkpoint& checkpoint, const int s, const int e, const unsigned int seed, const int i, const SLIKMCStatistics& stats) {
+	vector<int> settings;
+	this->getCheckpointSettings( s, e, seed, settings);
+	checkpoint.clear();
+	checkpoint.putVector( settings);
+	checkpoint.put( i);
+	checkpoint.put( stats);
+	checkpoint.put( this->num_updates);
+	checkpoint.putVector( this->block_acceptance);
+	checkpoint.putVector( this->block_weights);
+	checkpoint.putVector( this->stage_current);
+	checkpoint.put( this->stage_fixed);
+	checkpoint.putVector( this->stage_seconds);
+	checkpoint.putVector( this->stage_evaluations);
+	checkpoint.putVector( this->stage_passes);
+	PRandomState random;
+	PRandom::local().getState( random);
+	checkpoint.put( random);
+	this->telemetry.save( checkpoint);
+	this->monitor.save( checkpoint);
+	checkpoint.putPositions( this->protein);
+}
+
+bool SLIKMCSampler::loadCheckpoint(Checkpoint& checkpoint, const int s, const int e, const unsigned int seed, int& i, SLIKMCStatistics& stats) {
+	vector<int> settings, saved;
+	this->getCheckpointSettings( s, e, seed, settings);
+	bool ok = checkpoint.getVector( saved) && saved == settings;
+	ok = ok && checkpoint.get( i);
+	ok = ok && checkpoint.get( stats);
+	ok = ok && checkpoint.get( this->num_updates);
+	ok = ok && checkpoint.getVector( this->block_acceptance);
+	ok = ok && checkpoint.getVector( this->block_weights);
+	ok = ok && checkpoint.getVector( this->stage_current) && this->stage_current.size() == NUM_ACCEPTANCE_STAGES;
+	ok = ok && checkpoint.get( this->stage_fixed);
+	ok = ok && checkpoint.getVector( this->stage_seconds);
+	ok = ok && checkpoint.getVector( this->stage_evaluations);
+	ok = ok && checkpoint.getVector( this->stage_passes);
+	PRandomState random;
+	ok = ok && checkpoint.get( random);
+	if( ok)
+		PRandom::local().setState( random);
+	ok = ok && this->telemetry.restore( checkpoint);
+	ok = ok && this->monitor.restore( checkpoint);
+	ok = ok && checkpoint.getPositions( this->protein);
+	return ok;
+}
+
+bool SLIKMCSampler::isConverged(ConvergenceBoard* board, const int chain) {
+	if( board != NULL)
+		return board->publish( chain, this->monitor, this->criteria);
+	if( !this->criteria.enabled())
+		return false;
+	vector<TorsionSummary> summaries( this->monitor.getNumTorsions());
+	this->monitor.summarize( &summaries[0]);
+	return ConvergenceMonitor::isConverged( &summaries[0], 1, summaries.size(), this->criteria);
+}
+
+void SLIKMCSampler::writeDiagnostics(const string& filename) {
+	ofstream out( filename.c_str());
+	ConvergenceMonitor::writeCSV( out, &this->diagnostics[0], this->diagnostics_chains, this->diagnostics.size() / this->diagnostics_chains, this->diagnostics_start);
+	out.close();
+}
+
+bool SLIKMCSampler::updateBlock(const int j) {
+	PProtein* subchain = this->subchains[j];
+	subchain->attachResidues(); 								//NOTE:This is necessary!
+	double t = Telemetry::now();
+	subchain->saveChainState( &this->block_state); 				//Record the atoms moved by the proposals
+	this->telemetry.record( Telemetry::RESTORE, t);
+
+	int last = this->block_width - 1;
+	Vector3 endPriorG = subchain->getAtomAtRes(PID::C_ALPHA, last)->getPos();
+	Vector3 endG = subchain->getAtomAtRes(PID::C, last)->getPos();
+	Vector3 endNextG = subchain->getAtomAtRes(PID::O, last)->getPos();
+	int index_to_use[3] = { this->pivots[0], this->pivots[1], this->pivots[2]};
+	/*
+	 * calculate the importance ratio for the initial block.
+	 */
+	double P = this->getCachedP_log( subchain);
+	this->prepareCustomPriors( j);
+	IKSolutions iks_initial;
+	t = Telemetry::now();
+	int n = PExactIKSolver::FindSolutions( subchain, index_to_use, &endPriorG, &endG, &endNextG, iks_initial);
+	this->telemetry.record( Telemetry::IK_CLOSURE, t);
+	int status = 0; //Record whether the metric tensor part can be calculated. -1: matrix cannot be inverted; 0: okay
+	double Q = this->getQ_log( subchain, n, status);
+	if( !(status == 0)) {
+		cout << "Calculating matrix failed in the first place" << endl;
+		this->telemetry.record( j, Telemetry::SKIPPED);
+		this->block_state.stopRecording();
+		this->updateSchedule( j, false);
+		//If calculating metric tensor not successful, then, move on to the next sub-chain.
+		return false;
+	}
+
+	bool accepted = false;
+	int	num_MH_reject = 0;
+	int num_collision_reject = 0;
+
+	while( (num_MH_reject < MAX_METROPOLIS_REJECT) && (num_collision_reject < MAX_COLLISION_DETECT)) {
+		int n_proposal = 0;
+
+		int num_IK_fail = 0;
+		bool IK_success = false;
+		while( num_IK_fail < this->MAX_IK_SAMPLE) {
+			/* The (phi, psi) pair for the first residue is sampled from Ramachandran plot.
+			 * If the residue is not the first in the whole protein chain, then, both phi, psi are defined.
+			 * Therefore, sample (phi, psi) and rotate the two bonds.
+			 * Otherwise, phi will not have definition, then, we just rotate the first bond a little bit.
+			 */
+
+			if( this->use_RPlot) {
+				DihedralAngle* da_goal = this->rplot->getRandomDihedralAngle( this->rplot_class[subchain->getTopLevelIndices().first]);
+				DihedralAngle da_curr;
+				subchain->getDihedralAngleAtResidue( 0, da_curr);
+				if( j != 0) {
+					subchain->RotateChain_noGridUpdate("backbone", 0, forward, da_curr.phi - da_goal->phi);
+				}
+				else {
+					//The first residue in the chain
+					double range = 60;
+					double angle = Random::nextInt( 100) / 100.0 * range - range / 2;
+					subchain->RotateChain_noGridUpdate("backbone", 0, forward, angle);
+				}
+				subchain->RotateChain_noGridUpdate("backbone", 1, forward, da_curr.psi - da_goal->psi);
+				delete da_goal;
+			}
+			else {
+				double phi_change = Random::nextNormal( 0, 10);
+				double psi_change = Random::nextNormal( 0, 10);
+
+				subchain->RotateChain_noGridUpdate("backbone", 0, forward, phi_change);
+				subchain->RotateChain_noGridUpdate("backbone", 1, forward, psi_change);
+			}
+
+			/* Use analytical IK to close the sub-loop using the rest 6 DOFs
+			 */
+			IKSolutions iks;
+			// Here, call a modified IK solver which returns only one solution and the number of possible solutions.
+			t = Telemetry::now();
+			n_proposal = PExactIKSolver::FindSolutions( subchain, index_to_use, &endPriorG, &endG, &endNextG, iks);
+			if( n_proposal > 0) {
+				assert( iks.size() == 1);
+				subchain->MultiRotate_noGridUpdate(iks[0]);
+				this->telemetry.record( Telemetry::IK_CLOSURE, t);
+
+				/* optional: free end comformation sampling
+				 * We perturb the two ends therefore, we get variations on the two ends.
+				 */
+				if( this->freeEnd) {
+					if( j == 0) {
+						//NOTE: Method 1
+						double range = 60;
+						double angle = Random::nextInt( 100) / 100.0 * range - range / 2;
+						subchain->RotateChain_noGridUpdate( "backbone", 2, backward, angle);
+					}
+					else if( j == this->subchains.size() - 1) {
+						//NOTE: Method 1
+						double range = 60;
+						double angle = Random::nextInt( 100) / 100.0 * range - range / 2;
+						subchain->RotateChain_noGridUpdate( "backbone", 2 * last - 1, forward, angle);
+					}
+				}
+				IK_success = true;
+				break;
+			}
+			else {
+				//No IK solution
+				this->telemetry.record( Telemetry::IK_CLOSURE, t);
+				t = Telemetry::now();
+				subchain->restoreChainState_noGridUpdate( &this->block_state);
+				this->telemetry.record( Telemetry::RESTORE, t);
+				num_IK_fail += 1;
+			}
+		}
+
+		if( IK_success == false) {
+//					cout << " No change to subchain # " << j << " due to IK failure." << endl;;
+			this->telemetry.record( j, Telemetry::IK_FAILURE);
+			break;
+		}
+		/*
+		 * optional: add the side chain handling.
+		 */
+		if( this->use_Rotamer) {
+			vector<DihedralAngle> bbangles; subchain->getDihedralAngles( bbangles);
+			this->scRotater->rotateSidechain( subchain, bbangles);
+		}
+
+		/*
+		 * calculate the importance ratio for the proposal block.
+		 */
+		int status = 0;
+		bool accept = false;
+		if( this->use_delayedAcceptance)
+			accept = this->delayedMHStep( j, Q, n_proposal, status);
+		else {
+			double P_proposal = this->getP_log( subchain);
+			double Q_proposal = this->getQ_log( subchain, n_proposal, status);
+			if( status != -1)
+				accept = this->MHStep( P, Q, P_proposal, Q_proposal);
+		}
+		if( status == -1)
+			cout << "Reject since matrix is singular; Press any key to continue." << endl;
+
+		if( accept == true) {
+			//Must update before calling collision checking!
+			t = Telemetry::now();
+			subchain->updateAtomsGrid();
+
+			bool collision = false;
+			if( this->use_colChecking) {
+				collision = subchain->InAnyCollision();
+			}
+			this->telemetry.record( Telemetry::COLLISION, t);
+
+			if( collision == false) {
+				this->commitPriorCache( subchain);
+				this->telemetry.record( j, Telemetry::ACCEPTED);
+				accepted = true;
+				cout << "Succeed: get an accepted conformation" << endl;
+				break;
+			}
+			else {
+				cout << "Failed: Collision detected" << endl;
+				this->telemetry.record( j, Telemetry::REJECTED_COLLISION);
+				num_collision_reject += 1;
+				t = Telemetry::now();
+				subchain->restoreChainState_noGridUpdate( &this->block_state);
+				this->telemetry.record( Telemetry::RESTORE, t);
+			}
+		}
+		else {
+			if( status != -1) {
+				cout << "Failed: Rejected by Metropolis-Hasting step" << endl;
+				this->telemetry.record( j, Telemetry::REJECTED_MH);
+			}
+			else
+				this->telemetry.record( j, Telemetry::REJECTED_SINGULAR);
+			num_MH_reject += 1;
+			t = Telemetry::now();
+			subchain->restoreChainState_noGridUpdate( &this->block_state);
+			this->telemetry.record( Telemetry::RESTORE, t);
+		}
 	}
+	//Now we have a closed sub-chain loop, stop recording the moves of the block.
+	this->block_state.stopRecording();
+	this->updateSchedule( j, accepted);
+	return accepted;
 }
 
 bool SLIKMCSampler::MHStep(double P, double Q, double P_proposal, double Q_proposal) {
@@ -277,7 +635,7 @@ bool SLIKMCSampler::MHStep(double P, double Q, double P_proposal, double Q_propo
 		return true;
 	else {
 		double ratio = exp(ratio_log);
-		double temp = (double)rand() / (double)RAND_MAX;
+		double temp = Random::nextDouble( 1);
 		if( temp < ratio)
 			return true;
 		else
@@ -285,41 +643,238 @@ bool SLIKMCSampler::MHStep(double P, double Q, double P_proposal, double Q_propo
 	}
 }
 
-double SLIKMCSampler::getP_log(PProtein* chain) {
-	double log_prob_rplot = 0;
-	if( this->use_RPlot) {
-		int start = 0;
-		int end = chain->size() - 1;
-		for( int i = start; i <= end; i++) {
-			double temp = this->rplot->getResidueAngleProbability( chain, i);
-			log_prob_rplot += log(temp);
+bool SLIKMCSampler::delayedMHStep(const int j, const double Q, const int num_solutions, int& status) {
+	PProtein* subchain = this->subchains[j];
+	this->pending_residue_log.assign( NUM_RESIDUE_STAGES * subchain->size(), 0);
+	//Until the order is fixed, the stages after a rejection are still evaluated to measure them, but no longer decide.
+	bool accept = true;
+	for( int k = 0; k < NUM_ACCEPTANCE_STAGES; k++) {
+		int stage = this->stage_current[k];
+		if( !this->isStageEnabled( stage, j))
+			continue;
+		if( !accept && this->stage_fixed)
+			break;
+		double t = Telemetry::now();
+		int stage_status = 0;
+		double ratio_log = 0;
+		if( stage == STAGE_PROPOSAL)
+			ratio_log = Q - this->getQ_log( subchain, num_solutions, stage_status);
+		else {
+			ratio_log = this->getStageP_log( subchain, stage) - this->getCachedStageP_log( subchain, stage);
+			this->telemetry.record( Telemetry::PRIOR, t);
 		}
+		if( !this->stage_fixed) {
+			this->stage_seconds[stage] += Telemetry::now() - t;
+			this->stage_evaluations[stage] += 1;
+			if( stage_status != -1)
+				this->stage_passes[stage] += ratio_log >= 0 ? 1.0 : exp( ratio_log);
+		}
+		if( !accept)
+			continue;
+		if( stage_status == -1) {
+			status = -1;
+			accept = false;
+		}
+		else //One factor of the ratio, tested on its own.
+			accept = this->MHStep( 0, 0, ratio_log, 0);
 	}
+	return accept;
+}
 
-	double log_prob_bfactor = 0;
-	if( this->use_BFactor)
-		log_prob_bfactor = this->bfactor->evalAtomPositions( chain, chain->getTopLevelIndices().first, chain->getTopLevelIndices().second);
+bool SLIKMCSampler::isStageEnabled(const int stage, const int j) {
+	switch( stage) {
+	case STAGE_RAMACHANDRAN:
+		return this->use_RPlot;
+	case STAGE_BFACTOR:
+		return this->use_BFactor;
+	case STAGE_SIDECHAIN:
+		return this->use_Rotamer;
+	case STAGE_CUSTOM:
+		return !this->block_priors[j].empty();
+	default:
+		return true;
+	}
+}
 
-	double log_prob_sidechain = 0;
-	if( this->use_Rotamer) {
-		log_prob_sidechain = this->scRotater->evalSidechain( chain);
+void SLIKMCSampler::fixStageOrder() {
+	//Sorting sequential tests by time / (1 - pass rate) minimizes the expected time per proposal.
+	vector< pair<double, int> > keys;
+	for( int k = 0; k < NUM_ACCEPTANCE_STAGES; k++) {
+		int stage = this->stage_current[k];
+		double key = 0;
+		if( this->stage_evaluations[stage] > 0) {
+			double time = this->stage_seconds[stage] / this->stage_evaluations[stage];
+			double pass = this->stage_passes[stage] / this->stage_evaluations[stage];
+			key = time / max( 1.0 - pass, 1e-6);
+		}
+		keys.push_back( make_pair( key, k));
+	}
+	sort( keys.begin(), keys.end());
+	vector<int> order;
+	cout << "Delayed acceptance order:";
+	for( int k = 0; k < NUM_ACCEPTANCE_STAGES; k++) {
+		order.push_back( this->stage_current[keys[k].second]);
+		if( this->stage_evaluations[order.back()] > 0)
+			cout << " " << STAGE_NAMES[order.back()];
 	}
+	cout << endl;
+	this->stage_current = order;
+	this->stage_fixed = true;
+}
 
+double SLIKMCSampler::getP_log(PProtein* chain) {
+	double t = Telemetry::now();
+	this->pending_residue_log.assign( NUM_RESIDUE_STAGES * chain->size(), 0);
+	double log_prob = 0;
+	for( int stage = 0; stage < STAGE_PROPOSAL; stage++) {
+		log_prob += this->getStageP_log( chain, stage);
+	}
+	this->telemetry.record( Telemetry::PRIOR, t);
+	return log_prob;
+}
+
+double SLIKMCSampler::getStageP_log(PProtein* chain, const int stage) {
+	if( stage == STAGE_CUSTOM)
+		return this->getCustomP_log();
+	int start_top = chain->getTopLevelIndices().first;
+	double log_prob = 0;
+	for( int i = 0; i < chain->size(); i++) {
+		double term = this->getResidueP_log( stage, start_top + i);
+		this->pending_residue_log[NUM_RESIDUE_STAGES * i + stage] = term;
+		log_prob += term;
+	}
+	return log_prob;
+}
+
+double SLIKMCSampler::getResidueP_log(const int stage, const int index) {
+	if( stage == STAGE_RAMACHANDRAN) {
+		if( !this->use_RPlot)
+			return 0;
+		DihedralAngle da;
+		this->protein->getDihedralAngleAtResidue( index, da);
+		return this->rplot->getLogDensity( this->rplot_class[index], da.phi, da.psi, this->rplot_interpolate);
+	}
+	if( stage == STAGE_BFACTOR)
+		return this->use_BFactor ? this->bfactor->evalResidue( this->protein->getResidue( index), index) : 0;
+	return this->use_Rotamer ? this->scRotater->evalResidue( this->protein, index) : 0;
+}
+
+double SLIKMCSampler::getCustomP_log() {
 	double log_custom = 0;
-	if( this->use_customPrior) {
-		for( int i = 0; i < this->priors.size(); i++) {
-			log_custom += this->priors[i]->evaluate( chain->getTopLevelChain());
+	for( int k = 0; k < this->cache_prior_log.size(); k++) {
+		log_custom += this->cache_prior_log[k];
+	}
+	if( this->prior_block < 0)
+		return log_custom;
+
+	//Priors not depending on the block keep their cached values.
+	int first = this->subchains[this->prior_block]->getTopLevelIndices().first;
+	int last = this->subchains[this->prior_block]->getTopLevelIndices().second;
+	const vector<int>& active = this->block_priors[this->prior_block];
+	for( int i = 0; i < active.size(); i++) {
+		int k = active[i];
+		Prior* prior = this->priors[k];
+		double delta = 0;
+		if( !prior->isLocal())
+			delta = prior->evaluate( this->protein) - this->reference_prior_log[k];
+		else if( !prior->evaluateDelta( this->protein, first, last, delta))
+			delta = prior->evaluateRange( this->protein, first, last) - this->reference_prior_log[k];
+		this->pending_prior_delta[k] = delta;
+		log_custom += delta;
+	}
+	return log_custom;
+}
+
+void SLIKMCSampler::prepareCustomPriors(const int j) {
+	this->prior_block = j;
+	int first = this->subchains[j]->getTopLevelIndices().first;
+	int last = this->subchains[j]->getTopLevelIndices().second;
+	const vector<int>& active = this->block_priors[j];
+	for( int i = 0; i < active.size(); i++) {
+		int k = active[i];
+		if( this->priors[k]->isLocal())
+			this->reference_prior_log[k] = this->priors[k]->evaluateRange( this->protein, first, last);
+		else
+			this->reference_prior_log[k] = this->cache_prior_log[k];
+		this->pending_prior_delta[k] = 0;
+	}
+}
+
+void SLIKMCSampler::initPriorCache() {
+	//Settings may change between two runs, therefore, evaluate all terms again.
+	int size = this->protein->size();
+	this->cache_residue_log.resize( NUM_RESIDUE_STAGES * size);
+	for( int i = 0; i < size; i++) {
+		for( int stage = 0; stage < NUM_RESIDUE_STAGES; stage++)
+			this->cache_residue_log[NUM_RESIDUE_STAGES * i + stage] = this->getResidueP_log( stage, i);
+	}
+
+	int num_priors = this->use_customPrior ? this->priors.size() : 0;
+	this->cache_prior_log.assign( num_priors, 0);
+	this->reference_prior_log.assign( num_priors, 0);
+	this->pending_prior_delta.assign( num_priors, 0);
+	for( int k = 0; k < num_priors; k++) {
+		this->cache_prior_log[k] = this->priors[k]->evaluate( this->protein);
+	}
+	this->block_priors.assign( this->subchains.size(), vector<int>());
+	for( int j = 0; j < this->subchains.size(); j++) {
+		int first = this->subchains[j]->getTopLevelIndices().first;
+		int last = this->subchains[j]->getTopLevelIndices().second;
+		for( int k = 0; k < num_priors; k++) {
+			if( this->priors[k]->dependsOn( first, last))
+				this->block_priors[j].push_back( k);
+		}
+	}
+	this->prior_block = -1;
+}
+
+double SLIKMCSampler::getCachedP_log(PProtein* chain) {
+	double log_prob = 0;
+	for( int stage = 0; stage < STAGE_PROPOSAL; stage++) {
+		log_prob += this->getCachedStageP_log( chain, stage);
+	}
+	return log_prob;
+}
+
+double SLIKMCSampler::getCachedStageP_log(PProtein* chain, const int stage) {
+	double log_prob = 0;
+	if( stage == STAGE_CUSTOM) {
+		for( int k = 0; k < this->cache_prior_log.size(); k++) {
+			log_prob += this->cache_prior_log[k];
+		}
+		return log_prob;
+	}
+	int start_top = chain->getTopLevelIndices().first;
+	for( int i = 0; i < chain->size(); i++) {
+		log_prob += this->cache_residue_log[NUM_RESIDUE_STAGES * (start_top + i) + stage];
+	}
+	return log_prob;
+}
+
+void SLIKMCSampler::commitPriorCache(PProtein* chain) {
+	Debug::check( this->pending_residue_log.size() == NUM_RESIDUE_STAGES * chain->size(), "Pending prior terms do not belong to the block");
+	int start_top = chain->getTopLevelIndices().first;
+	for( int i = 0; i < this->pending_residue_log.size(); i++) {
+		this->cache_residue_log[NUM_RESIDUE_STAGES * start_top + i] = this->pending_residue_log[i];
+	}
+	if( this->prior_block >= 0) {
+		const vector<int>& active = this->block_priors[this->prior_block];
+		for( int i = 0; i < active.size(); i++) {
+			this->cache_prior_log[active[i]] += this->pending_prior_delta[active[i]];
 		}
 	}
-	return log_prob_rplot + log_prob_bfactor + log_prob_sidechain + log_custom;
 }
 
 double SLIKMCSampler::getQ_log(PProtein* chain, const int num_solutions, int& status) {
 
 	//NOTE: Currently, just return the probability for the first pair of dihedral angles.
 	double log_prob_firstres = 0;
-	if( this->use_RPlot)
-		log_prob_firstres = log(this->rplot->getResidueAngleProbability(chain, 0));
+	if( this->use_RPlot) {
+		//Q is the density the first residue is drawn from, therefore never interpolated.
+		DihedralAngle da;
+		chain->getDihedralAngleAtResidue( 0, da);
+		log_prob_firstres = this->rplot->getLogDensity( this->rplot_class[chain->getTopLevelIndices().first], da.phi, da.psi);
+	}
 	//NOTE: The metric tensor part! The result is log.
 	double log_Q = log_prob_firstres - 0.5 * this->getMetricTensor_log( chain, status) - log( num_solutions);
 	return log_Q;
@@ -375,6 +930,36 @@ void SLIKMCSampler::disableLog() {
 	this->logFile = false;
 }
 
+void SLIKMCSampler::setLogFormat(const LogFormat format) {
+	this->logFormat = format;
+}
+
+void SLIKMCSampler::setLogQueue(const int capacity, const WriterBackpressure backpressure) {
+	Debug::check( capacity > 0, "Capacity of the output queue should be positive");
+	this->logCapacity = capacity;
+	this->logBackpressure = backpressure;
+}
+
+void SLIKMCSampler::setSeed(const unsigned int seed) {
+	this->seed = seed;
+}
+
+void SLIKMCSampler::enableCheckpoint(const string& filename, const int interval) {
+	Debug::check( interval > 0, "Checkpoint interval should be positive");
+	this->checkpointFile = filename;
+	this->checkpointInterval = interval;
+}
+
+void SLIKMCSampler::disableCheckpoint() {
+	this->checkpointInterval = 0;
+	this->resume = false;
+}
+
+void SLIKMCSampler::resumeFromCheckpoint() {
+	Debug::check( this->checkpointInterval > 0, "Enable checkpoints before resuming from a checkpoint");
+	this->resume = true;
+}
+
 void SLIKMCSampler::enableCollisionChecking() {
 	this->use_colChecking = true;
 }
@@ -383,7 +968,17 @@ void SLIKMCSampler::disableCollisionChecking() {
 	this->use_colChecking = false;
 }
 
-void SLIKMCSampler::enableRamachandran() {
+void SLIKMCSampler::enableRamachandran(const int gridnum, const bool interpolate) {
+	Debug::check( gridnum == 36 || gridnum == 120, "The Ramachandran plot is available with 36 or 120 grids per angle");
+	if( gridnum != this->rplot->getGridNum()) {
+		delete this->rplot;
+		if( gridnum == 36)
+			this->rplot = new RamachandranPlot();
+		else
+			this->rplot = new RamachandranPlot( 120, "../Data/RamachandranPlot_120/pro.txt", "../Data/RamachandranPlot_120/pre_pro.txt",
+					"../Data/RamachandranPlot_120/gly.txt", "../Data/RamachandranPlot_120/gen.txt");
+	}
+	this->rplot_interpolate = interpolate;
 	this->use_RPlot = true;
 }
 
@@ -406,6 +1001,27 @@ void SLIKMCSampler::dispSettings() {
 	cout << "  Sidechain:\t" << sidechain << endl;
 	cout << "  Free end: \t" << freeEnd << endl;
 	cout << "  Custom priors: \t" << custom << endl;
+
+	string scheduling[3] = { "sweep", "random scan", "acceptance weighted"};
+	cout << "  Block width: \t" << this->block_width << endl;
+	cout << "  IK pivots: \t" << this->pivots[0] << " " << this->pivots[1] << " " << this->pivots[2] << endl;
+	cout << "  Scheduling: \t" << scheduling[this->scheduling] << endl;
+	if( this->checkpointInterval > 0)
+		cout << "  Checkpoint: \t" << this->checkpointFile << " every " << this->checkpointInterval << " iterations" << endl;
+	else
+		cout << "  Checkpoint: \tdisabled" << endl;
+	if( this->criteria.enabled())
+		cout << "  Stop criteria: \tESS >= " << this->criteria.min_ess << ", R-hat < " << this->criteria.max_rhat << endl;
+	if( !this->use_delayedAcceptance)
+		cout << "  Delayed acceptance: \tdisabled" << endl;
+	else if( this->stage_order.empty())
+		cout << "  Delayed acceptance: \torder measured over " << this->stage_adapt_iterations << " iterations" << endl;
+	else {
+		cout << "  Delayed acceptance: \t";
+		for( int k = 0; k < this->stage_order.size(); k++)
+			cout << STAGE_NAMES[this->stage_order[k]] << (k + 1 < this->stage_order.size() ? " > " : "");
+		cout << endl;
+	}
 }
 
 void SLIKMCSampler::enableCustomPriors() {
@@ -421,77 +1037,103 @@ void SLIKMCSampler::addCustomPrior(Prior& prior) {
 	return;
 }
 
-double SLIKMCSampler::getMetricTensor_log( PProtein* protein, int& status) {
-	//NOTE: Their code starts at 1.
-	//Therefore, the matrix should be 6 + 1 (x, y, z, rx, ry, rz)by size * 2 + 1with the first row and first column junk values.
-	int size = protein->size();
-	double** Jac_ca =  Utility::new_Double2D( 6 + 1, size * 2 + 1);
-	double** Jac_c = Utility::new_Double2D( 6 + 1, size * 2 + 1);
-
-	//NOTE: By default, ComputeJacobian function calculates the Jacobian for the last backbone atom.
-	PTools::ComputeJacobian( protein, Jac_c);
-	Vector3 ca_pos = protein->getAtomPos(PID::BACKBONE, size * 3 - 2);
-	PTools::ComputeJacobian( protein, Jac_ca, ca_pos);
-
-	assert( (Jac_ca[1][8] < EPSILON) && (Jac_ca[2][8] < EPSILON) && (Jac_ca[3][8] < EPSILON));
-
-	//Next, throw out all garbage lines and all the angular Jacobian entries
-	double** dc_dx = Utility::new_Double2D( 6 + 1, 2 + 1);
-	double** dc_dy = Utility::new_Double2D( 6 + 1, 6 + 1);
-
-	for( int i = 1; i <= 3; i++)
-	{
-		for( int j = 1; j <= 2; j++)
-		{
-			dc_dx[i][j] = Jac_ca[i][j];
-		}
+void SLIKMCSampler::setBlockScheduling(const BlockScheduling scheduling, const int adapt_iterations) {
+	this->scheduling = scheduling;
+	this->adapt_iterations = adapt_iterations;
+}
 
-		for( int j = 1; j <= 6; j++)
-		{
-			dc_dy[i][j] = Jac_ca[i][j + 2];
-		}
+void SLIKMCSampler::enableDelayedAcceptance(const vector<AcceptanceStage>& order, const int adapt_iterations) {
+	Debug::check( order.empty() || order.size() == NUM_ACCEPTANCE_STAGES, "The stage order should list every stage once");
+	vector<bool> listed( NUM_ACCEPTANCE_STAGES, false);
+	for( int k = 0; k < order.size(); k++) {
+		Debug::check( order[k] >= 0 && order[k] < NUM_ACCEPTANCE_STAGES && !listed[order[k]], "The stage order should list every stage once");
+		listed[order[k]] = true;
 	}
+	Debug::check( adapt_iterations >= 0, "The number of adapting iterations should not be negative");
+	this->use_delayedAcceptance = true;
+	this->stage_order.assign( order.begin(), order.end());
+	this->stage_adapt_iterations = adapt_iterations;
+}
 
-	for( int i = 4; i <= 6; i++)
-	{
-		for( int j = 1; j <= 2; j++)
-		{
-			dc_dx[i][j] = Jac_c[i - 3][j];
-		}
+void SLIKMCSampler::disableDelayedAcceptance() {
+	this->use_delayedAcceptance = false;
+}
 
-		for( int j = 1; j <= 6; j++)
-		{
-			dc_dy[i][j] = Jac_c[i - 3][j + 2];
+void SLIKMCSampler::initSchedule(const int s, const int e) {
+	this->block_acceptance.assign( this->subchains.size(), 0.5);
+	this->block_weights.assign( this->subchains.size(), 1.0);
+	this->num_updates = 0;
+	this->num_run_blocks = e - s + 1;
+
+	this->stage_current = this->stage_order;
+	for( int stage = 0; this->stage_order.empty() && stage < NUM_ACCEPTANCE_STAGES; stage++)
+		this->stage_current.push_back( stage);
+	this->stage_fixed = !this->stage_order.empty();
+	this->stage_seconds.assign( NUM_ACCEPTANCE_STAGES, 0);
+	this->stage_evaluations.assign( NUM_ACCEPTANCE_STAGES, 0);
+	this->stage_passes.assign( NUM_ACCEPTANCE_STAGES, 0);
+}
+
+int SLIKMCSampler::nextBlock(const int k, const int s, const int e) {
+	int num_blocks = e - s + 1;
+	if( this->scheduling == SCHEDULE_RANDOM_SCAN)
+		return s + Random::nextInt( num_blocks);
+	if( this->scheduling == SCHEDULE_ACCEPTANCE_WEIGHTED) {
+		double total = 0;
+		for( int j = s; j <= e; j++)
+			total += this->block_weights[j];
+		double u = Random::nextDouble( total);
+		for( int j = s; j < e; j++) {
+			u -= this->block_weights[j];
+			if( u < 0)
+				return j;
 		}
+		return e;
 	}
+	return k;
+}
 
-	double** dc_dy_inverse = Utility::new_Double2D( 6 + 1, 6 + 1);
-	PNumRoutines::nr_inverse( dc_dy, 6, dc_dy_inverse, status);
-	if( status == -1)
-		return 1;
-
-	double** df_dx = Utility::new_Double2D( 6 + 1, 2 + 1);
-	Utility::matrix_multiply_trash( 6, 6, 2, dc_dy_inverse, dc_dx, df_dx, -1);
-
-	double** dh_dx = Utility::new_Double2D( 2 + 1, 2 + 1);
-	Utility::matrix_square_transposeA( 2, 2, df_dx, dh_dx);
+void SLIKMCSampler::updateSchedule(const int j, const bool accepted) {
+	this->num_updates += 1;
+	//Like the block weights, the stage order adapts only during the first iterations and is fixed afterwards.
+	if( this->use_delayedAcceptance && !this->stage_fixed && this->num_updates >= this->stage_adapt_iterations * this->num_run_blocks)
+		this->fixStageOrder();
+	if( this->scheduling != SCHEDULE_ACCEPTANCE_WEIGHTED)
+		return;
+	//Adapt only during the first iterations, afterwards the weights stay fixed and every update leaves the target density invariant.
+	if( this->num_updates > this->adapt_iterations * this->num_run_blocks)
+		return;
+	const double rate = 0.1;
+	this->block_acceptance[j] += rate * ((accepted ? 1.0 : 0.0) - this->block_acceptance[j]);
+	//Poorly accepted blocks get up to 10 times more updates than always accepted ones.
+	this->block_weights[j] = 1.0 - 0.9 * this->block_acceptance[j];
+}
 
-	//Add the identity
-	dh_dx[1][1] += 1;
-	dh_dx[2][2] += 1;
+void SLIKMCSampler::setStopCriteria(const double min_ess, const double max_rhat) {
+	this->criteria.min_ess = min_ess;
+	this->criteria.max_rhat = max_rhat;
+}
 
-	//Get the determinant
-	double det = dh_dx[1][1] * dh_dx[2][2] - dh_dx[1][2] * dh_dx[2][1];
+void SLIKMCSampler::getDiagnostics(vector<double>& ess, vector<double>& rhat) const {
+	ess.clear();
+	rhat.clear();
+	if( this->diagnostics_chains == 0)
+		return;
+	int num_torsions = this->diagnostics.size() / this->diagnostics_chains;
+	for( int k = 0; k < num_torsions; k++) {
+		ess.push_back( ConvergenceMonitor::getESS( &this->diagnostics[0], this->diagnostics_chains, num_torsions, k));
+		rhat.push_back( ConvergenceMonitor::getRhat( &this->diagnostics[0], this->diagnostics_chains, num_torsions, k));
+	}
+}
 
-	double tensor = log(det);
+const Telemetry& SLIKMCSampler::getTelemetry() const {
+	return this->telemetry;
+}
 
-	Utility::delete_Double2D( Jac_c, 6 + 1);
-	Utility::delete_Double2D( Jac_ca, 6 + 1);
-	Utility::delete_Double2D( dc_dx, 6 + 1);
-	Utility::delete_Double2D( dc_dy, 6 + 1);
-	Utility::delete_Double2D( dc_dy_inverse, 6 + 1);
-	Utility::delete_Double2D( df_dx, 6 + 1);
-	Utility::delete_Double2D( dh_dx, 2 + 1);
+double SLIKMCSampler::getMetricTensor_log( PProtein* protein, int& status) {
+	double t = Telemetry::now();
+	double tensor = MetricTensor::evalBlock_log( protein, this->pivots, status);
+	this->telemetry.record( Telemetry::METRIC_TENSOR, t);
 	return tensor;
 }
 
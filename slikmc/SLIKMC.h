@@ -57,6 +57,59 @@ For comments or bug issue, please contact the software maintainer <B>Yajia Zhang
 #include "BFactor.h"
 #include "SideChainRotater.h"
 #include "Prior.h"
+#include "Telemetry.h"
+#include "SampleWriter.h"
+#include "Trajectory.h"
+#include "Checkpoint.h"
+#include "Diagnostics.h"
+
+/**
+ * @brief Sampling statistics of one Markov chain (or merged statistics of several chains).
+ */
+struct SLIKMCStatistics {
+	SLIKMCStatistics() : stat_distinct(0), stat_conformation(0), stat_dropped(0) {}
+	/**
+	 * @brief number of sweeps in which at least one block was changed
+	 */
+	int stat_distinct;
+	/**
+	 * @brief number of sweeps performed
+	 */
+	int stat_conformation;
+	/**
+	 * @brief number of logged conformations dropped because the output queue was full
+	 */
+	int stat_dropped;
+};
+
+/**
+ * @brief Output format of logged conformations.
+ */
+enum LogFormat {
+	LOG_PDB = 0,		///< one PDB file per conformation (default)
+	LOG_TRAJECTORY		///< one binary trajectory file per chain holding the sampled loop residues, see TrajectoryWriter
+};
+
+/**
+ * @brief Order in which the blocks are updated in one iteration.
+ */
+enum BlockScheduling {
+	SCHEDULE_SWEEP = 0,				///< systematic sweep from the first to the last block (default)
+	SCHEDULE_RANDOM_SCAN,			///< every update picks a block uniformly at random
+	SCHEDULE_ACCEPTANCE_WEIGHTED	///< every update picks a block with probability growing with its rejection rate
+};
+
+/**
+ * @brief Factors of the Metropolis-Hastings ratio tested one after another by delayed acceptance, see SLIKMCSampler::enableDelayedAcceptance().
+ */
+enum AcceptanceStage {
+	STAGE_RAMACHANDRAN = 0,	///< Ramachandran plot prior of the block residues
+	STAGE_BFACTOR,			///< B-factor prior of the block residues
+	STAGE_SIDECHAIN,		///< side-chain prior of the block residues
+	STAGE_CUSTOM,			///< custom priors depending on the block
+	STAGE_PROPOSAL,			///< ratio of the proposal densities, including the metric tensor
+	NUM_ACCEPTANCE_STAGES
+};
 
 /**
  * @brief Sub-Loop Inverse Kinematic Markov Chain (SLIKMC) sampler. Support chain/subchain close-loop sampling, free-end sampling. Side-chain sampling is also supported.
@@ -65,8 +118,12 @@ class SLIKMCSampler {
 public:
 	/**
 	 * @brief Construct a SLIKMC sampler for specific chain
+	 * @param chain the chain to be sampled
+	 * @param block_width number of residues in one block (at least 4); consecutive blocks overlap by block_width - 1 residues
+	 * @param pivots indices of the three IK pivot residues in a block, the last one must be block_width - 1.
+	 * By default, the last three residues {block_width - 3, block_width - 2, block_width - 1}.
 	 */
-	SLIKMCSampler( PProtein* chain);
+	SLIKMCSampler( PProtein* chain, const int block_width = 4, const int* pivots = NULL);
 	/**
 	 * @brief Destructor
 	 */
@@ -74,12 +131,26 @@ public:
 
 	/**
 	 * @brief Sample conformations of sub-loop from residue s to residue e.
-	 * @param time time duration for sampling
+	 * @param time wall-clock time duration for sampling in seconds
 	 * @param s index of starting residue
 	 * @param e index of ending residue
 	 */
 	void sample( const double time, const int s, const int e);
 
+	/**
+	 * @brief Sample conformations of sub-loop from residue s to residue e with several independent Markov chains at once.
+	 * Every chain runs in its own worker process, so it owns a private copy of the protein, its blocks and the random number state.
+	 * Samples of chain k are saved as slikmc_c<k>_<n>.pdb; statistics of all chains are merged into info.txt, and samples.txt
+	 * numbers the samples of all chains in one sequence.
+	 * @param time wall-clock time duration for sampling in seconds (the same budget applies to every chain)
+	 * @param s index of starting residue
+	 * @param e index of ending residue
+	 * @param num_chains number of chains; 0 means one chain per online processor
+	 * @param seed random seed; chain k draws from the independent stream k of the seed
+	 * @return merged statistics of all chains
+	 */
+	SLIKMCStatistics sampleParallel( const double time, const int s, const int e, int num_chains = 0, const unsigned int seed = 1);
+
 	/**
 	 * @brief Enable using B-factors as priors.
 	 * @param chain a chain conformation with desired atom positions and B-factors
@@ -122,6 +193,45 @@ public:
 	 */
 	void disableLog();
 
+	/**
+	 * @brief Configure the queue of the background writer used for saving conformations.
+	 * @param capacity maximum number of conformations waiting to be written
+	 * @param backpressure when the queue is full, either wait for the writer (default) or drop the conformation
+	 */
+	void setLogQueue( const int capacity, const WriterBackpressure backpressure = BACKPRESSURE_BLOCK);
+
+	/**
+	 * @brief Choose the output format of logged conformations. With LOG_TRAJECTORY, the conformations of a chain are appended to
+	 * slikmc_traj.bin (slikmc_c<k>_traj.bin for parallel chains); use TrajectoryReader to read them or convert them to PDB.
+	 */
+	void setLogFormat( const LogFormat format);
+
+	/**
+	 * @brief Set the random seed of sample(), 1 by default; sampleParallel() takes its own seed. Runs with the same seed and settings generate the same conformations.
+	 */
+	void setSeed( const unsigned int seed);
+
+	/**
+	 * @brief Enable periodic checkpoints of the Markov chain, so an interrupted run can be resumed with resumeFromCheckpoint().
+	 * A checkpoint holds the conformation, iteration and sampling statistics, block scheduler, telemetry and the sampling settings.
+	 * sampleParallel() writes one checkpoint per chain, <filename>_c<k>.
+	 * The state of the random number generator is part of the checkpoint, therefore a resumed run generates the same conformations as an uninterrupted run.
+	 * @param filename name of the checkpoint file
+	 * @param interval number of iterations between two checkpoints
+	 */
+	void enableCheckpoint( const string& filename, const int interval = 100);
+
+	/**
+	 * @brief Disable checkpoints.
+	 */
+	void disableCheckpoint();
+
+	/**
+	 * @brief Let the next sample() or sampleParallel() call continue from the latest checkpoint if it exists.
+	 * The sampler must be constructed and configured in the same way as the interrupted run.
+	 */
+	void resumeFromCheckpoint();
+
 	/**
 	 * @brief Enable steric clash checking for samples.
 	 */
@@ -134,8 +244,10 @@ public:
 
 	/**
 	 * @brief Enable using Ramachandran plot as prior.
+	 * @param gridnum resolution of the plot, 36 (Data/RamachandranPlot) or 120 (Data/RamachandranPlot_120) grids per angle
+	 * @param interpolate interpolate the prior bilinearly between grids; the proposal always draws from the grids
 	 */
-	void enableRamachandran();
+	void enableRamachandran( const int gridnum = 36, const bool interpolate = false);
 
 	/**
 	 * @brief Disable using Ramachandran plot as prior.
@@ -162,7 +274,129 @@ public:
 	 */
 	void addCustomPrior( Prior& prior);
 
+	/**
+	 * @brief Choose the order in which blocks are updated. One iteration always performs as many block updates as there are blocks in the sub-loop.
+	 * @param scheduling sweep, random scan or acceptance-weighted random scan
+	 * @param adapt_iterations for acceptance-weighted scheduling, number of iterations during which the block weights adapt;
+	 * afterwards the weights are frozen, so the chain is a fixed random-scan sampler.
+	 */
+	void setBlockScheduling( const BlockScheduling scheduling, const int adapt_iterations = 100);
+
+	/**
+	 * @brief Enable delayed acceptance. The Metropolis-Hastings ratio of a proposal is split into the factors of AcceptanceStage and
+	 * every factor is tested by its own Metropolis-Hastings step; the proposal is rejected at the first failed stage, so the factors after
+	 * it are never evaluated. Every stage leaves the target density invariant, therefore the chain stays unbiased, at the price of
+	 * a somewhat lower acceptance rate than a single test of the whole ratio. Stages of disabled priors are skipped.
+	 * @param order order of the stages, every stage once; if empty, the time and pass rate of every stage are measured during
+	 * the first adapt_iterations iterations and the order is then fixed, cheapest and most often failing stages first.
+	 * A measured order depends on timings, so give the order to generate the same conformations from the same seed.
+	 * @param adapt_iterations number of iterations measured before the order is fixed
+	 */
+	void enableDelayedAcceptance( const vector<AcceptanceStage>& order = vector<AcceptanceStage>(), const int adapt_iterations = 10);
+
+	/**
+	 * @brief Disable delayed acceptance: the whole ratio is tested by one Metropolis-Hastings step (default).
+	 */
+	void disableDelayedAcceptance();
+
+	/**
+	 * @brief Stop sampling as soon as the chains have converged, before the time budget is used up.
+	 * The criteria are checked after every iteration on the (phi, psi) angles of the sampled residues; a criterion set to 0 is not checked.
+	 * @param min_ess minimum effective sample size of every torsion, summed over chains
+	 * @param max_rhat every torsion must have a split-R-hat below this value, e.g. 1.01
+	 */
+	void setStopCriteria( const double min_ess, const double max_rhat = 0);
+
+	/**
+	 * @brief Get the convergence diagnostics of the last sample() or sampleParallel() call.
+	 * Torsion 2 * i is the phi angle and torsion 2 * i + 1 the psi angle of residue s + i.
+	 * When logging is enabled they are also written to diagnostics.csv next to info.txt.
+	 * @param ess stores the effective sample size of every torsion, summed over chains
+	 * @param rhat stores the split-R-hat of every torsion
+	 */
+	void getDiagnostics( vector<double>& ess, vector<double>& rhat) const;
+
+	/**
+	 * @brief Get per-stage timings and per-block outcomes of the last sample() or sampleParallel() call.
+	 * When logging is enabled they are also written to telemetry.json and telemetry.csv next to info.txt.
+	 */
+	const Telemetry& getTelemetry() const;
+
 private:
+	/**
+	 * @brief Run one Markov chain on the sub-loop from residue s to residue e.
+	 * @param time wall-clock time duration for sampling in seconds
+	 * @param s index of starting residue
+	 * @param e index of ending residue
+	 * @param prefix file name prefix of logged conformations
+	 * @param seed random seed
+	 * @param checkpoint_file name of the checkpoint file of the chain
+	 * @param board convergence diagnostics shared by parallel chains, or NULL for a single chain
+	 * @param chain index of the chain, which is its random stream and its slot on the board
+	 * @param stats stores the sampling statistics of the chain
+	 */
+	void sampleChain( const double time, const int s, const int e, const string& prefix, const unsigned int seed, const string& checkpoint_file,
+			ConvergenceBoard* board, const int chain, SLIKMCStatistics& stats);
+
+	/**
+	 * @brief Check the stop criteria after an iteration, on all chains of the board if it is given.
+	 */
+	bool isConverged( ConvergenceBoard* board, const int chain);
+
+	/**
+	 * @brief Write the diagnostics of the last run as CSV.
+	 */
+	void writeDiagnostics( const string& filename);
+
+	/**
+	 * @brief Name of the trajectory file; with checkpoints, a new part starting at iteration i is written after every checkpoint.
+	 */
+	string getTrajectoryFile( const string& prefix, const int i, const bool parts);
+
+	/**
+	 * @brief Write the index of the samples of all parallel chains, one line per sample: the merged sample number, the chain,
+	 * the file and the frame in the file.
+	 */
+	void writeSampleIndex( const string& filename, const vector<SLIKMCStatistics>& chain_stats);
+
+	/**
+	 * @brief Settings a checkpoint must agree with to be resumed.
+	 */
+	void getCheckpointSettings( const int s, const int e, const unsigned int seed, vector<int>& settings);
+
+	/**
+	 * @brief Store the state of the chain after i iterations in a checkpoint record.
+	 */
+	void saveCheckpoint( Checkpoint& checkpoint, const int s, const int e, const unsigned int seed, const int i, const SLIKMCStatistics& stats);
+
+	/**
+	 * @brief Restore the state of the chain from a checkpoint record.
+	 * @return false if the record does not match the chain or the current settings
+	 */
+	bool loadCheckpoint( Checkpoint& checkpoint, const int s, const int e, const unsigned int seed, int& i, SLIKMCStatistics& stats);
+
+	/**
+	 * @brief Propose and accept/reject a new conformation of one block.
+	 * @param j index of the block
+	 * @return true if the proposal was accepted
+	 */
+	bool updateBlock( const int j);
+
+	/**
+	 * @brief Reset the block scheduler for blocks s to e.
+	 */
+	void initSchedule( const int s, const int e);
+
+	/**
+	 * @brief Pick the block for the k-th update of an iteration over blocks s to e.
+	 */
+	int nextBlock( const int k, const int s, const int e);
+
+	/**
+	 * @brief Update the acceptance statistics of block j used by acceptance-weighted scheduling.
+	 */
+	void updateSchedule( const int j, const bool accepted);
+
 	/**
 	 * @brief Metropolis-Hastings step to decide whether to accept a proposal block.
 	 * @param P Probability density of initial block
@@ -173,12 +407,85 @@ private:
 	 */
 	bool MHStep( double P, double Q, double P_proposal, double Q_proposal);
 
+	/**
+	 * @brief Delayed-acceptance test of the proposal of block j, stage by stage, see enableDelayedAcceptance().
+	 * @param Q Proposal density of initial block to proposal block
+	 * @param num_solutions number of IK solutions of the proposal block
+	 * @param status set to -1 if the proposal is rejected since its metric tensor cannot be calculated
+	 * @return true if the proposal passes every stage
+	 */
+	bool delayedMHStep( const int j, const double Q, const int num_solutions, int& status);
+
+	/**
+	 * @brief Check if a stage has a factor to test for proposals of block j under the current settings.
+	 */
+	bool isStageEnabled( const int stage, const int j);
+
+	/**
+	 * @brief Fix the stage order by increasing expected time to reject a proposal, time / (1 - pass rate) of every stage,
+	 * as measured during adaptation.
+	 */
+	void fixStageOrder();
+
 	/**
 	 * @brief Evaluate probability density of one block or sub-chain.
+	 * The per-residue terms and the changes of the custom priors are kept as pending terms, see commitPriorCache().
 	 * @return probability density in logarithm
 	 */
 	double getP_log( PProtein* chain);
 
+	/**
+	 * @brief Evaluate the factor of one prior stage (STAGE_RAMACHANDRAN to STAGE_CUSTOM) for one block;
+	 * its terms are kept as pending terms like in getP_log().
+	 * @return probability density in logarithm
+	 */
+	double getStageP_log( PProtein* chain, const int stage);
+
+	/**
+	 * @brief Factor of one prior stage for one block from the cached terms.
+	 * @return probability density in logarithm
+	 */
+	double getCachedStageP_log( PProtein* chain, const int stage);
+
+	/**
+	 * @brief Evaluate one per-residue prior term (Ramachandran plot, B-factors or side-chain) of one residue.
+	 * @param stage STAGE_RAMACHANDRAN, STAGE_BFACTOR or STAGE_SIDECHAIN
+	 * @param index index of the residue in the top level chain
+	 * @return probability density in logarithm
+	 */
+	double getResidueP_log( const int stage, const int index);
+
+	/**
+	 * @brief Evaluate the custom priors for a proposal of the block prepared by prepareCustomPriors().
+	 * Only the priors depending on the block are evaluated; their changes are kept as pending terms.
+	 * @return probability density of all custom priors in logarithm
+	 */
+	double getCustomP_log();
+
+	/**
+	 * @brief Prepare the evaluation of the custom priors for proposals of block j:
+	 * evaluate the local priors depending on the block on its current conformation.
+	 */
+	void prepareCustomPriors( const int j);
+
+	/**
+	 * @brief Evaluate and cache the prior terms of every residue and every custom prior of the current conformation,
+	 * and find the custom priors depending on every block.
+	 */
+	void initPriorCache();
+
+	/**
+	 * @brief Probability density of one block from the cached terms; equals getP_log() of the current conformation.
+	 * @return probability density in logarithm
+	 */
+	double getCachedP_log( PProtein* chain);
+
+	/**
+	 * @brief Replace the cached terms of a block with the pending terms of the last getP_log() call on it.
+	 * Call it once the proposal block is accepted.
+	 */
+	void commitPriorCache( PProtein* chain);
+
 	/**
 	 * @brief Evaluate proposal density given one block or sub-chain. Initial block and proposal block are assumed to be independent.
 	 * @param num_solutions number of IK solution for the block or sub-chain
@@ -201,10 +508,37 @@ private:
 	PProtein* protein;
 
 	/**
-	 * @brief Collection of 4-residue size blocks
+	 * @brief Collection of blocks, block j starts at residue j
 	 */
 	vector<PProtein*> subchains;
 
+	/**
+	 * @brief Number of residues in one block
+	 */
+	int block_width;
+
+	/**
+	 * @brief IK pivot residues in a block
+	 */
+	int pivots[3];
+
+	BlockScheduling scheduling;
+	int adapt_iterations;
+
+	/**
+	 * @brief Smoothed acceptance rate and selection weight of every block, the number of updates performed, and the
+	 * number of blocks updated in one iteration of the current run.
+	 */
+	vector<double> block_acceptance;
+	vector<double> block_weights;
+	int num_updates;
+	int num_run_blocks;
+
+	/**
+	 * @brief Undo log of the block being updated, reused by every update.
+	 */
+	PChainState block_state;
+
 	/**
 	 * @brief Maximum number of dihedral angles we try for the first residue in the subchain in case that IK cannot find a solution.
 	 */
@@ -222,6 +556,11 @@ private:
 
 	BFactor* bfactor;
 	RamachandranPlot* rplot;
+	/**
+	 * @brief Ramachandran class of every residue in the top level chain.
+	 */
+	vector<int> rplot_class;
+	bool rplot_interpolate;
 
 	SidechainRotater* scRotater;
 
@@ -235,8 +574,72 @@ private:
 	bool init_Rotamer;
 	bool logFile;
 	int skipLength;
+	int logCapacity;
+	WriterBackpressure logBackpressure;
+	LogFormat logFormat;
 
 	vector<Prior*> priors;
+
+	/**
+	 * @brief Cached prior terms (in logarithm) of every residue in the top level chain, NUM_RESIDUE_STAGES per residue.
+	 * A block move changes only the dihedral angles, atoms and side-chains inside the block,
+	 * so only the terms of the block have to be evaluated for the proposal.
+	 */
+	vector<double> cache_residue_log;
+	static const int NUM_RESIDUE_STAGES = STAGE_SIDECHAIN + 1;
+	/**
+	 * @brief Cached value (in logarithm) of every custom prior.
+	 */
+	vector<double> cache_prior_log;
+	/**
+	 * @brief Custom priors depending on the residues of every block, see Prior::dependsOn().
+	 */
+	vector< vector<int> > block_priors;
+
+	/**
+	 * @brief Pending terms of the last evaluated proposal block.
+	 */
+	vector<double> pending_residue_log;
+	/**
+	 * @brief Block prepared by prepareCustomPriors(), the values of its custom priors before the move
+	 * and their pending changes.
+	 */
+	int prior_block;
+	vector<double> reference_prior_log;
+	vector<double> pending_prior_delta;
+
+	/**
+	 * @brief Delayed acceptance settings: the given stage order (empty to measure it) and the number of iterations measured.
+	 */
+	bool use_delayedAcceptance;
+	vector<int> stage_order;
+	int stage_adapt_iterations;
+	/**
+	 * @brief Stage order of the current run and whether it is fixed. Until it is, the time, number of evaluations
+	 * and sum of the pass probabilities of every stage are measured.
+	 */
+	vector<int> stage_current;
+	bool stage_fixed;
+	vector<double> stage_seconds;
+	vector<double> stage_evaluations;
+	vector<double> stage_passes;
+
+	Telemetry telemetry;
+
+	unsigned int seed;
+	string checkpointFile;
+	int checkpointInterval;
+	bool resume;
+
+	ConvergenceMonitor monitor;
+	StopCriteria criteria;
+
+	/**
+	 * @brief Diagnostics of the last run, diagnostics_chains summaries per torsion starting at residue diagnostics_start.
+	 */
+	vector<TorsionSummary> diagnostics;
+	int diagnostics_chains;
+	int diagnostics_start;
 };
 
 const double EPSILON = 0.0000001;
@@ -0,0 +1,193 @@
+/*
+ * SampleWriter.cc
+ *
+ *  Created on: Oct 17, 2026
+ */
+
+#include "SampleWriter.h"
+#include "PExtension.h"
+#include "Utility.h"
+#include <fstream>
+
+SampleWriter::SampleWriter( const int capacity, const WriterBackpressure backpressure) {
+	Debug::check( capacity > 0, "SampleWriter: capacity should be positive");
+	this->capacity = capacity;
+	this->backpressure = backpressure;
+	this->queue.assign( capacity, NULL);
+	this->head = 0;
+	this->size = 0;
+	this->busy = false;
+	this->stop = false;
+	this->dropped = 0;
+	this->written = 0;
+	this->topology = NULL;
+
+	pthread_mutex_init( &this->mutex, NULL);
+	pthread_cond_init( &this->not_empty, NULL);
+	pthread_cond_init( &this->not_full, NULL);
+	pthread_cond_init( &this->idle, NULL);
+	Debug::check( pthread_create( &this->thread, NULL, SampleWriter::run, this) == 0, "SampleWriter: cannot start writer thread");
+}
+
+SampleWriter::~SampleWriter() {
+	pthread_mutex_lock( &this->mutex);
+	this->stop = true;
+	pthread_cond_signal( &this->not_empty);
+	pthread_mutex_unlock( &this->mutex);
+	pthread_join( this->thread, NULL);
+
+	//The writer thread empties the queue before it stops.
+	for( int i = 0; i < this->free_frames.size(); i++)
+		delete this->free_frames[i];
+	delete this->topology;
+
+	pthread_cond_destroy( &this->idle);
+	pthread_cond_destroy( &this->not_full);
+	pthread_cond_destroy( &this->not_empty);
+	pthread_mutex_destroy( &this->mutex);
+}
+
+bool SampleWriter::matchesTopology(PChain* chain, const int num_atoms) const {
+	const Topology* topology = this->topology;
+	if( topology == NULL || topology->atom_names.size() != num_atoms)
+		return false;
+	int k = 0;
+	for( unsigned i = 0; i < chain->size(); i++) {
+		PResidue* residue = chain->getResidue(i);
+		HASH_MAP_STR(PAtom*)* atoms = residue->getAtomMap();
+		for( HASH_MAP_STR(PAtom*)::const_iterator it = atoms->begin(); it != atoms->end(); ++it, k++) {
+			if( topology->atom_names[k] != it->first || topology->res_names[k] != residue->getName()
+					|| topology->res_ids[k] != residue->getPdbId())
+				return false;
+		}
+	}
+	return true;
+}
+
+SampleWriter::Topology* SampleWriter::newTopology(PChain* chain) const {
+	Topology* topology = new Topology();
+	topology->users = 0;
+	for( unsigned i = 0; i < chain->size(); i++) {
+		PResidue* residue = chain->getResidue(i);
+		HASH_MAP_STR(PAtom*)* atoms = residue->getAtomMap();
+		for( HASH_MAP_STR(PAtom*)::const_iterator it = atoms->begin(); it != atoms->end(); ++it) {
+			topology->atom_names.push_back( it->first);
+			topology->res_names.push_back( residue->getName());
+			topology->res_ids.push_back( residue->getPdbId());
+			topology->occupancy.push_back( it->second->getOccupancy());
+			topology->temp_factor.push_back( it->second->getTempFactor());
+			topology->elem_names.push_back( it->second->getName());
+		}
+	}
+	return topology;
+}
+
+bool SampleWriter::write(PChain* chain, const string& filename) {
+	pthread_mutex_lock( &this->mutex);
+	while( this->size == this->capacity) {
+		if( this->backpressure == BACKPRESSURE_DROP) {
+			this->dropped += 1;
+			pthread_mutex_unlock( &this->mutex);
+			return false;
+		}
+		pthread_cond_wait( &this->not_full, &this->mutex);
+	}
+	Frame* frame = NULL;
+	if( !this->free_frames.empty()) {
+		frame = this->free_frames.back();
+		this->free_frames.pop_back();
+	}
+	pthread_mutex_unlock( &this->mutex);
+
+	//Only the sampling thread inserts frames, so the reserved slot stays free while the snapshot is taken.
+	if( frame == NULL)
+		frame = new Frame();
+	frame->filename = filename;
+	frame->positions.clear();
+	for( unsigned i = 0; i < chain->size(); i++) {
+		HASH_MAP_STR(PAtom*)* atoms = chain->getResidue(i)->getAtomMap();
+		for( HASH_MAP_STR(PAtom*)::const_iterator it = atoms->begin(); it != atoms->end(); ++it) {
+			frame->positions.push_back( it->second->getPos());
+		}
+	}
+	//The atom layout only changes if side-chains are enabled or disabled, so the last topology almost always matches.
+	Topology* topology = this->matchesTopology( chain, frame->positions.size()) ? NULL : this->newTopology( chain);
+
+	pthread_mutex_lock( &this->mutex);
+	if( topology != NULL) {
+		if( this->topology != NULL && this->topology->users == 0)
+			delete this->topology;
+		this->topology = topology;
+	}
+	frame->topology = this->topology;
+	frame->topology->users += 1;
+	this->queue[(this->head + this->size) % this->capacity] = frame;
+	this->size += 1;
+	pthread_cond_signal( &this->not_empty);
+	pthread_mutex_unlock( &this->mutex);
+	return true;
+}
+
+void SampleWriter::flush() {
+	pthread_mutex_lock( &this->mutex);
+	while( this->size > 0 || this->busy)
+		pthread_cond_wait( &this->idle, &this->mutex);
+	pthread_mutex_unlock( &this->mutex);
+}
+
+long SampleWriter::getDropped() {
+	pthread_mutex_lock( &this->mutex);
+	long n = this->dropped;
+	pthread_mutex_unlock( &this->mutex);
+	return n;
+}
+
+long SampleWriter::getWritten() {
+	pthread_mutex_lock( &this->mutex);
+	long n = this->written;
+	pthread_mutex_unlock( &this->mutex);
+	return n;
+}
+
+void* SampleWriter::run(void* arg) {
+	SampleWriter* writer = (SampleWriter*)arg;
+	pthread_mutex_lock( &writer->mutex);
+	while( true) {
+		while( writer->size == 0 && !writer->stop)
+			pthread_cond_wait( &writer->not_empty, &writer->mutex);
+		if( writer->size == 0 && writer->stop)
+			break;
+
+		Frame* frame = writer->queue[writer->head];
+		writer->head = (writer->head + 1) % writer->capacity;
+		writer->size -= 1;
+		writer->busy = true;
+		pthread_cond_signal( &writer->not_full);
+		pthread_mutex_unlock( &writer->mutex);
+
+		writer->writeFrame( frame);
+
+		pthread_mutex_lock( &writer->mutex);
+		frame->topology->users -= 1;
+		if( frame->topology->users == 0 && frame->topology != writer->topology)
+			delete frame->topology;
+		writer->free_frames.push_back( frame);
+		writer->written += 1;
+		writer->busy = false;
+		if( writer->size == 0)
+			pthread_cond_broadcast( &writer->idle);
+	}
+	pthread_cond_broadcast( &writer->idle);
+	pthread_mutex_unlock( &writer->mutex);
+	return NULL;
+}
+
+void SampleWriter::writeFrame(const Frame* frame) {
+	const Topology* topology = frame->topology;
+	ofstream out( frame->filename.c_str());
+	for( int i = 0; i < frame->positions.size(); i++) {
+		out << PDBIO::formatAtomLine( i + 1, topology->atom_names[i], topology->res_names[i], topology->res_ids[i],
+				frame->positions[i], topology->occupancy[i], topology->temp_factor[i], topology->elem_names[i]) << endl;
+	}
+	out.close();
+}
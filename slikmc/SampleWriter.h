@@ -0,0 +1,124 @@
+/*
+ * SampleWriter.h
+ *
+ *  Created on: Oct 17, 2026
+ */
+
+#ifndef SAMPLEWRITER_H_
+#define SAMPLEWRITER_H_
+
+#include <PChain.h>
+#include <vector.h>
+#include <string>
+#include <pthread.h>
+using namespace std;
+
+/**
+ * @brief What the sampler does when the queue of a SampleWriter is full.
+ */
+enum WriterBackpressure {
+	BACKPRESSURE_BLOCK = 0,	///< wait until the writer thread frees a slot
+	BACKPRESSURE_DROP		///< drop the sample and count it
+};
+
+/**
+ * @brief Background writer for sampled conformations.
+ * write() only copies the atom positions of the chain into a queue, a writer thread formats them as PDB and does the file I/O.
+ * The output files are the same as written by PDBIO::writeToFile().
+ */
+class SampleWriter {
+public:
+	/**
+	 * @brief Start the writer thread.
+	 * @param capacity maximum number of samples waiting in the queue
+	 * @param backpressure block or drop when the queue is full
+	 */
+	SampleWriter( const int capacity = 64, const WriterBackpressure backpressure = BACKPRESSURE_BLOCK);
+
+	/**
+	 * @brief Write all queued samples and stop the writer thread.
+	 */
+	virtual ~SampleWriter();
+
+	/**
+	 * @brief Snapshot the chain and queue it for writing.
+	 * @param chain the chain to be written
+	 * @param filename output PDB filename
+	 * @return false if the sample was dropped
+	 */
+	bool write( PChain* chain, const string& filename);
+
+	/**
+	 * @brief Wait until all queued samples are written.
+	 */
+	void flush();
+
+	/**
+	 * @brief Number of samples dropped because the queue was full.
+	 */
+	long getDropped();
+
+	/**
+	 * @brief Number of samples written to disk.
+	 */
+	long getWritten();
+
+private:
+	/**
+	 * @brief Atom names, residue data and auxiliary PDB fields of a chain; shared by all samples of the same layout.
+	 * users counts the queued frames that refer to it.
+	 */
+	struct Topology {
+		int users;
+		vector<string> atom_names;
+		vector<string> res_names;
+		vector<int> res_ids;
+		vector<Real> occupancy;
+		vector<Real> temp_factor;
+		vector<string> elem_names;
+	};
+
+	/**
+	 * @brief One queued sample.
+	 */
+	struct Frame {
+		string filename;
+		Topology* topology;
+		vector<Vector3> positions;
+	};
+
+	static void* run( void* writer);
+	void writeFrame( const Frame* frame);
+	bool matchesTopology( PChain* chain, const int num_atoms) const;
+	Topology* newTopology( PChain* chain) const;
+
+	int capacity;
+	WriterBackpressure backpressure;
+
+	pthread_t thread;
+	pthread_mutex_t mutex;
+	pthread_cond_t not_empty;
+	pthread_cond_t not_full;
+	pthread_cond_t idle;
+
+	/**
+	 * @brief Queued frames as a ring buffer with head and size, and recycled frames.
+	 */
+	vector<Frame*> queue;
+	int head;
+	int size;
+	vector<Frame*> free_frames;
+
+	bool busy;
+	bool stop;
+	long dropped;
+	long written;
+
+	/**
+	 * @brief Topology of the last sample; replaced by the sampling thread under the mutex, and freed by the writer thread
+	 * once no queued frame refers to it.
+	 */
+	Topology* topology;
+};
+
+#endif /* SAMPLEWRITER_H_ */
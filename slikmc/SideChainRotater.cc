@@ -11,6 +11,9 @@
 SidechainRotater::SidechainRotater( PProtein* protein) {
 	this->rotamer = new Rotamer( protein);
 	this->rotamer->initSidechainDatabase( protein);
+	for( int i = 0; i < protein->size(); i++) {
+		this->types.push_back( this->rotamer->getResidueType( protein->getResidue(i)->getName()));
+	}
 	return;
 }
 
@@ -35,8 +38,8 @@ void SidechainRotater::rotateSidechain( PChain* chain, const vector<DihedralAngl
 	}
 
 	for( int i = start; i <= end; i++) {
-		string name = chain->getResidue(i)->getName();
-		if( name == "GLY" || name == "ALA") {
+		int type = this->types[start_top + i];
+		if( type < 0) {
 			//No rotamer for GLY and ALA
 			continue;
 		}
@@ -46,7 +49,7 @@ void SidechainRotater::rotateSidechain( PChain* chain, const vector<DihedralAngl
 		double psi = angles_backbone[i].psi;
 		vector<double> rotamer;
 		int index = 0;
-		this->rotamer->sample( name, phi, psi, index, rotamer);
+		this->rotamer->sample( type, phi, psi, index, rotamer);
 
 		residue->applyRotamer( index, rotamer);
 	}
@@ -69,6 +72,16 @@ double SidechainRotater::evalSidechain(PChain* chain) {
 	return this->rotamer->evalSidechain_log( chain, start, end);
 }
 
+double SidechainRotater::evalResidue(PChain* chain, const int index) {
+	//Same as evalSidechain, the terminal residues of the top level chain are not evaluated.
+	if( index == 0 || index == chain->size() - 1) {
+		return 0;
+	}
+	DihedralAngle da;
+	chain->getDihedralAngleAtResidue( index, da);
+	return this->rotamer->evalResidue_log( chain->getResidue( index), this->types[index], da);
+}
+
 void SidechainRotater::getSidechainAngles(PProtein* protein, vector<vector<double> >& angles) {
 
 	for( int i = 0; i < protein->size(); i++) {
@@ -41,6 +41,14 @@ public:
 	 */
 	double evalSidechain( PChain* chain);
 
+	/**
+	 * @brief Evaluate the side-chain conformation of a single residue.
+	 * @param chain the top level chain containing the residue
+	 * @param index index of the residue in the chain
+	 * @return probability in logarithm, 0 for the terminal residues
+	 */
+	double evalResidue( PChain* chain, const int index);
+
 	/**
 	 * @brief Get all side-chain angles for a given chain.
 	 * @param chain the given chain
@@ -49,6 +57,10 @@ public:
 	static void getSidechainAngles(PProtein* chain, vector< vector<double> >& angles);
 private:
 	Rotamer* rotamer;
+	/**
+	 * @brief Residue type of every residue of the top level chain (see Rotamer::getResidueType())
+	 */
+	vector<int> types;
 };
 
 #endif /* SIDECHAINROTATER_H_ */
@@ -0,0 +1,190 @@
+/*
+ * Telemetry.cc
+ *
+ *  Created on: Oct 17, 2026
+ */
+
+#include "Telemetry.h"
+#include "Utility.h"
+#include "Checkpoint.h"
+#include <fstream>
+#include <time.h>
+#include <unistd.h>
+
+Telemetry::Telemetry( const string& name, const int num_blocks) {
+	this->name = name;
+	this->reset( num_blocks);
+}
+
+void Telemetry::reset(const int num_blocks) {
+	this->start = Telemetry::now();
+	this->wall_time = 0;
+	this->iterations = 0;
+	for( int i = 0; i < NUM_STAGES; i++) {
+		this->stage_calls[i] = 0;
+		this->stage_seconds[i] = 0;
+	}
+	this->outcomes.assign( num_blocks * NUM_OUTCOMES, 0);
+}
+
+double Telemetry::now() {
+	struct timespec ts;
+	clock_gettime( CLOCK_MONOTONIC, &ts);
+	return ts.tv_sec + ts.tv_nsec * 1e-9;
+}
+
+double Telemetry::elapsed() const {
+	return Telemetry::now() - this->start;
+}
+
+void Telemetry::record(const Stage stage, const double begin) {
+	this->stage_calls[stage] += 1;
+	this->stage_seconds[stage] += Telemetry::now() - begin;
+}
+
+void Telemetry::record(const int block, const Outcome outcome) {
+	Debug::check( block >= 0 && (block + 1) * NUM_OUTCOMES <= (int)this->outcomes.size(), "Telemetry: block index out of range");
+	this->outcomes[block * NUM_OUTCOMES + outcome] += 1;
+}
+
+void Telemetry::finishIteration() {
+	this->iterations += 1;
+	this->wall_time = this->elapsed();
+}
+
+void Telemetry::merge(const Telemetry& other) {
+	if( this->outcomes.size() < other.outcomes.size())
+		this->outcomes.resize( other.outcomes.size(), 0);
+	for( int i = 0; i < other.outcomes.size(); i++) {
+		this->outcomes[i] += other.outcomes[i];
+	}
+	for( int i = 0; i < NUM_STAGES; i++) {
+		this->stage_calls[i] += other.stage_calls[i];
+		this->stage_seconds[i] += other.stage_seconds[i];
+	}
+	this->iterations += other.iterations;
+	this->wall_time = max( this->wall_time, other.wall_time);
+}
+
+long Telemetry::getCalls(const Stage stage) const {
+	return this->stage_calls[stage];
+}
+
+double Telemetry::getSeconds(const Stage stage) const {
+	return this->stage_seconds[stage];
+}
+
+long Telemetry::getCount(const int block, const Outcome outcome) const {
+	return this->outcomes[block * NUM_OUTCOMES + outcome];
+}
+
+long Telemetry::getIterations() const {
+	return this->iterations;
+}
+
+double Telemetry::getWallTime() const {
+	return this->wall_time;
+}
+
+const char* Telemetry::getStageName(const Stage stage) {
+	static const char* names[NUM_STAGES] = { "ik_closure", "prior", "metric_tensor", "collision", "restore", "output"};
+	return names[stage];
+}
+
+const char* Telemetry::getOutcomeName(const Outcome outcome) {
+	static const char* names[NUM_OUTCOMES] = { "accepted", "rejected_mh", "rejected_collision", "rejected_singular", "ik_failure", "skipped"};
+	return names[outcome];
+}
+
+void Telemetry::writeJSON(ostream& out) const {
+	int num_blocks = this->outcomes.size() / NUM_OUTCOMES;
+	out << "{" << endl;
+	out << "  \"sampler\": \"" << this->name << "\"," << endl;
+	out << "  \"wall_time\": " << this->wall_time << "," << endl;
+	out << "  \"iterations\": " << this->iterations << "," << endl;
+	out << "  \"stages\": {" << endl;
+	for( int i = 0; i < NUM_STAGES; i++) {
+		out << "    \"" << getStageName( (Stage)i) << "\": {\"calls\": " << this->stage_calls[i]
+		    << ", \"seconds\": " << this->stage_seconds[i] << "}" << (i + 1 < NUM_STAGES ? "," : "") << endl;
+	}
+	out << "  }," << endl;
+	out << "  \"blocks\": [" << endl;
+	for( int b = 0; b < num_blocks; b++) {
+		out << "    {\"block\": " << b;
+		for( int o = 0; o < NUM_OUTCOMES; o++) {
+			out << ", \"" << getOutcomeName( (Outcome)o) << "\": " << this->getCount( b, (Outcome)o);
+		}
+		out << "}" << (b + 1 < num_blocks ? "," : "") << endl;
+	}
+	out << "  ]" << endl;
+	out << "}" << endl;
+}
+
+void Telemetry::writeCSV(ostream& out) const {
+	int num_blocks = this->outcomes.size() / NUM_OUTCOMES;
+	out << "record,block,name,count,seconds" << endl;
+	out << "run,," << this->name << "," << this->iterations << "," << this->wall_time << endl;
+	for( int i = 0; i < NUM_STAGES; i++) {
+		out << "stage,," << getStageName( (Stage)i) << "," << this->stage_calls[i] << "," << this->stage_seconds[i] << endl;
+	}
+	for( int b = 0; b < num_blocks; b++) {
+		for( int o = 0; o < NUM_OUTCOMES; o++) {
+			out << "outcome," << b << "," << getOutcomeName( (Outcome)o) << "," << this->getCount( b, (Outcome)o) << "," << endl;
+		}
+	}
+}
+
+void Telemetry::write(const string& filename_json, const string& filename_csv) const {
+	ofstream out_json( filename_json.c_str());
+	this->writeJSON( out_json);
+	out_json.close();
+
+	ofstream out_csv( filename_csv.c_str());
+	this->writeCSV( out_csv);
+	out_csv.close();
+}
+
+bool Telemetry::send(const int fd) const {
+	int size = this->outcomes.size();
+	bool ok = Utility::writeFully( fd, &size, sizeof( int));
+	ok = ok && Utility::writeFully( fd, &this->wall_time, sizeof( double));
+	ok = ok && Utility::writeFully( fd, &this->iterations, sizeof( long));
+	ok = ok && Utility::writeFully( fd, this->stage_calls, sizeof( this->stage_calls));
+	ok = ok && Utility::writeFully( fd, this->stage_seconds, sizeof( this->stage_seconds));
+	if( ok && size > 0)
+		ok = Utility::writeFully( fd, &this->outcomes[0], size * sizeof( long));
+	return ok;
+}
+
+bool Telemetry::receive(const int fd) {
+	int size = 0;
+	bool ok = Utility::readFully( fd, &size, sizeof( int)) && size >= 0;
+	ok = ok && Utility::readFully( fd, &this->wall_time, sizeof( double));
+	ok = ok && Utility::readFully( fd, &this->iterations, sizeof( long));
+	ok = ok && Utility::readFully( fd, this->stage_calls, sizeof( this->stage_calls));
+	ok = ok && Utility::readFully( fd, this->stage_seconds, sizeof( this->stage_seconds));
+	if( ok) {
+		this->outcomes.assign( size, 0);
+		if( size > 0)
+			ok = Utility::readFully( fd, &this->outcomes[0], size * sizeof( long));
+	}
+	return ok;
+}
+
+void Telemetry::save(Checkpoint& checkpoint) const {
+	checkpoint.put( this->wall_time);
+	checkpoint.put( this->iterations);
+	checkpoint.put( this->stage_calls, sizeof( this->stage_calls));
+	checkpoint.put( this->stage_seconds, sizeof( this->stage_seconds));
+	checkpoint.putVector( this->outcomes);
+}
+
+bool Telemetry::restore(Checkpoint& checkpoint) {
+	bool ok = checkpoint.get( this->wall_time);
+	ok = ok && checkpoint.get( this->iterations);
+	ok = ok && checkpoint.get( this->stage_calls, sizeof( this->stage_calls));
+	ok = ok && checkpoint.get( this->stage_seconds, sizeof( this->stage_seconds));
+	ok = ok && checkpoint.getVector( this->outcomes);
+	this->start = Telemetry::now() - this->wall_time;
+	return ok;
+}
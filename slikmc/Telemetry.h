@@ -0,0 +1,154 @@
+/*
+ * Telemetry.h
+ *
+ *  Created on: Oct 17, 2026
+ */
+
+#ifndef TELEMETRY_H_
+#define TELEMETRY_H_
+
+#include <vector.h>
+#include <string>
+#include <iostream>
+using namespace std;
+
+class Checkpoint;
+
+/**
+ * @brief Per-stage timing and per-block outcome counters of a sampling run.
+ * Stage times are wall-clock seconds from a monotonic clock. The collected data can be exported as JSON or CSV.
+ */
+class Telemetry {
+public:
+	/**
+	 * @brief Timed stages of a sampler.
+	 */
+	enum Stage {
+		IK_CLOSURE = 0,		///< analytical IK closure of a block
+		PRIOR,				///< evaluation of the priors
+		METRIC_TENSOR,		///< metric tensor of the closed-loop manifold
+		COLLISION,			///< grid update and steric clash checking
+		RESTORE,			///< saving and restoring chain states
+		OUTPUT,				///< writing conformations and statistics
+		NUM_STAGES
+	};
+
+	/**
+	 * @brief Outcome of one block update.
+	 */
+	enum Outcome {
+		ACCEPTED = 0,		///< proposal accepted
+		REJECTED_MH,		///< rejected by the Metropolis-Hastings step
+		REJECTED_COLLISION,	///< rejected due to steric clash
+		REJECTED_SINGULAR,	///< rejected since the metric tensor of the proposal cannot be calculated
+		IK_FAILURE,			///< no IK solution after the maximum number of trials
+		SKIPPED,			///< block skipped since the metric tensor of the initial block cannot be calculated
+		NUM_OUTCOMES
+	};
+
+	/**
+	 * @brief Constructor
+	 * @param name name of the sampler, written to the exported data
+	 * @param num_blocks number of blocks tracked for outcomes
+	 */
+	Telemetry( const string& name = "", const int num_blocks = 0);
+
+	/**
+	 * @brief Clear all counters and restart the wall clock.
+	 * @param num_blocks number of blocks tracked for outcomes
+	 */
+	void reset( const int num_blocks);
+
+	/**
+	 * @brief Current time of the monotonic wall clock.
+	 * @return time in seconds
+	 */
+	static double now();
+
+	/**
+	 * @brief Wall-clock time since the last reset().
+	 * @return time in seconds
+	 */
+	double elapsed() const;
+
+	/**
+	 * @brief Record one call of a stage started at time begin (see now()).
+	 */
+	void record( const Stage stage, const double begin);
+
+	/**
+	 * @brief Record the outcome of one update of a block.
+	 */
+	void record( const int block, const Outcome outcome);
+
+	/**
+	 * @brief Record one finished iteration (sweep) and update the total wall-clock time.
+	 */
+	void finishIteration();
+
+	/**
+	 * @brief Merge the counters of another run, e.g. from another Markov chain. Wall-clock time is the maximum of both.
+	 */
+	void merge( const Telemetry& other);
+
+	long getCalls( const Stage stage) const;
+	double getSeconds( const Stage stage) const;
+	long getCount( const int block, const Outcome outcome) const;
+	long getIterations() const;
+	double getWallTime() const;
+
+	/**
+	 * @brief Export as a JSON object.
+	 */
+	void writeJSON( ostream& out) const;
+
+	/**
+	 * @brief Export as CSV in long format with columns record,block,name,count,seconds.
+	 */
+	void writeCSV( ostream& out) const;
+
+	/**
+	 * @brief Export as JSON and CSV files.
+	 */
+	void write( const string& filename_json, const string& filename_csv) const;
+
+	/**
+	 * @brief Send the counters through a file descriptor (used by forked sampling workers).
+	 * @return true if all data are written
+	 */
+	bool send( const int fd) const;
+
+	/**
+	 * @brief Receive counters sent by send().
+	 * @return true if all data are read
+	 */
+	bool receive( const int fd);
+
+	/**
+	 * @brief Append the counters to a checkpoint.
+	 */
+	void save( Checkpoint& checkpoint) const;
+
+	/**
+	 * @brief Read the counters saved by save() and continue the wall clock from the saved wall-clock time.
+	 * @return true if all data are read
+	 */
+	bool restore( Checkpoint& checkpoint);
+
+	static const char* getStageName( const Stage stage);
+	static const char* getOutcomeName( const Outcome outcome);
+
+private:
+	string name;
+	double start;
+	double wall_time;
+	long iterations;
+	long stage_calls[NUM_STAGES];
+	double stage_seconds[NUM_STAGES];
+	/**
+	 * @brief Outcome counts, indexed by block * NUM_OUTCOMES + outcome.
+	 */
+	vector<long> outcomes;
+};
+
+#endif /* TELEMETRY_H_ */
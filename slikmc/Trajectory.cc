@@ -0,0 +1,295 @@
+/*
+ * Trajectory.cc
+ *
+ *  Created on: Oct 17, 2026
+ */
+
+#include "Trajectory.h"
+#include "PExtension.h"
+#include "Utility.h"
+#include <string.h>
+#include <math.h>
+#include <sstream>
+#include <fstream>
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+
+static const char TRAJECTORY_MAGIC[8] = { 'S', 'L', 'I', 'K', 'T', 'R', 'J', '1'};
+static const uint32_t TRAJECTORY_BYTE_ORDER = 0x01020304;
+static const uint32_t TRAJECTORY_VERSION = 1;
+static const uint32_t FRAME_KEY = 0;
+static const uint32_t FRAME_DELTA = 1;
+
+/**
+ * @brief Pad the file with zeros to a multiple of 8 bytes so that mapped frames and the index are aligned.
+ */
+static void padFile( FILE* file) {
+	static const char zeros[8] = { 0, 0, 0, 0, 0, 0, 0, 0};
+	long position = ftell( file);
+	if( position % 8 != 0)
+		fwrite( zeros, 1, 8 - position % 8, file);
+}
+
+static void writeString( FILE* file, const string& s) {
+	fwrite( s.c_str(), 1, s.size() + 1, file);
+}
+
+TrajectoryWriter::TrajectoryWriter( const string& filename, PChain* chain, const int s, const int e,
+		const bool delta, const int keyframe_interval, const float quantum) {
+	Debug::check( s >= 0 && s <= e && e < chain->size(), "Trajectory: wrong loop residues");
+	Debug::check( keyframe_interval > 0 && quantum > 0, "Trajectory: wrong encoding parameters");
+	this->file = fopen( filename.c_str(), "wb");
+	Debug::check( this->file != NULL, "Trajectory: cannot open " + filename);
+	this->delta = delta;
+	this->keyframe_index = 0;
+
+	memset( &this->header, 0, sizeof( TrajectoryHeader));
+	memcpy( this->header.magic, TRAJECTORY_MAGIC, 8);
+	this->header.byte_order = TRAJECTORY_BYTE_ORDER;
+	this->header.version = TRAJECTORY_VERSION;
+	this->header.num_residues = chain->size();
+	this->header.loop_first_residue = s;
+	this->header.loop_last_residue = e;
+	this->header.keyframe_interval = keyframe_interval;
+	this->header.quantum = quantum;
+	//Header is rewritten with the frame count and index offset in close().
+	fwrite( &this->header, sizeof( TrajectoryHeader), 1, this->file);
+
+	//Topology
+	vector<float> reference;
+	int num_atoms = 0;
+	for( int i = 0; i < chain->size(); i++) {
+		PResidue* residue = chain->getResidue(i);
+		if( i == s)
+			this->header.loop_first_atom = num_atoms;
+		vector<PAtom*>* atoms = residue->getAtoms();
+		for( int j = 0; j < atoms->size(); j++) {
+			PAtom* atom = (*atoms)[j];
+			int32_t ints[2] = { i, residue->getPdbId()};
+			float floats[2] = { (float)atom->getOccupancy(), (float)atom->getTempFactor()};
+			fwrite( ints, sizeof( int32_t), 2, this->file);
+			fwrite( floats, sizeof( float), 2, this->file);
+			writeString( this->file, atom->getID());
+			writeString( this->file, residue->getName());
+			writeString( this->file, atom->getName());
+			Vector3 pos = atom->getPos();
+			reference.push_back( pos.x);
+			reference.push_back( pos.y);
+			reference.push_back( pos.z);
+			num_atoms++;
+		}
+		if( i == e)
+			this->header.loop_num_atoms = num_atoms - this->header.loop_first_atom;
+	}
+	this->header.num_atoms = num_atoms;
+
+	padFile( this->file);
+	this->header.reference_offset = ftell( this->file);
+	fwrite( &reference[0], sizeof( float), reference.size(), this->file);
+	padFile( this->file);
+}
+
+TrajectoryWriter::~TrajectoryWriter() {
+	if( this->file != NULL)
+		this->close();
+}
+
+void TrajectoryWriter::append(PChain* chain) {
+	Debug::check( this->file != NULL, "Trajectory: file already closed");
+	int n = this->header.loop_num_atoms;
+	this->coords.resize( 3 * n);
+	int k = 0;
+	for( int i = this->header.loop_first_residue; i <= this->header.loop_last_residue; i++) {
+		vector<PAtom*>* atoms = chain->getResidue(i)->getAtoms();
+		for( int j = 0; j < atoms->size(); j++) {
+			Debug::check( k < n, "Trajectory: chain topology changed");
+			Vector3 pos = (*atoms)[j]->getPos();
+			this->coords[3 * k] = pos.x;
+			this->coords[3 * k + 1] = pos.y;
+			this->coords[3 * k + 2] = pos.z;
+			k++;
+		}
+	}
+	Debug::check( k == n, "Trajectory: chain topology changed");
+
+	uint32_t frame = this->offsets.size();
+	this->offsets.push_back( ftell( this->file));
+
+	//Delta frames are used while the last keyframe is recent and every delta fits into 16 bits.
+	bool use_delta = this->delta && !this->keyframe.empty() && frame - this->keyframe_index < this->header.keyframe_interval;
+	if( use_delta) {
+		this->deltas.resize( 3 * n);
+		for( int i = 0; i < 3 * n && use_delta; i++) {
+			double q = floor( (this->coords[i] - this->keyframe[i]) / this->header.quantum + 0.5);
+			if( q < -32768 || q > 32767)
+				use_delta = false;
+			else
+				this->deltas[i] = (int16_t)q;
+		}
+	}
+
+	if( use_delta) {
+		uint32_t head[2] = { FRAME_DELTA, this->keyframe_index};
+		fwrite( head, sizeof( uint32_t), 2, this->file);
+		fwrite( &this->deltas[0], sizeof( int16_t), 3 * n, this->file);
+	}
+	else {
+		fwrite( &FRAME_KEY, sizeof( uint32_t), 1, this->file);
+		fwrite( &this->coords[0], sizeof( float), 3 * n, this->file);
+		this->keyframe = this->coords;
+		this->keyframe_index = frame;
+	}
+	padFile( this->file);
+}
+
+void TrajectoryWriter::close() {
+	if( this->file == NULL)
+		return;
+	this->header.num_frames = this->offsets.size();
+	this->header.index_offset = ftell( this->file);
+	if( !this->offsets.empty())
+		fwrite( &this->offsets[0], sizeof( uint64_t), this->offsets.size(), this->file);
+	fseek( this->file, 0, SEEK_SET);
+	fwrite( &this->header, sizeof( TrajectoryHeader), 1, this->file);
+	fclose( this->file);
+	this->file = NULL;
+}
+
+void TrajectoryWriter::convertFromPDB(const vector<string>& pdb_files, const string& filename, int s, int e, const bool delta) {
+	Debug::check( !pdb_files.empty(), "Trajectory: no PDB files to convert");
+	PProtein* first = PDBIO::readFromFile( pdb_files[0]);
+	if( s < 0) s = 0;
+	if( e < 0) e = first->size() - 1;
+	TrajectoryWriter writer( filename, first, s, e, delta);
+	writer.append( first);
+	delete first;
+	for( int i = 1; i < pdb_files.size(); i++) {
+		PProtein* protein = PDBIO::readFromFile( pdb_files[i]);
+		writer.append( protein);
+		delete protein;
+	}
+	writer.close();
+}
+
+TrajectoryReader::TrajectoryReader(const string& filename) {
+	this->fd = open( filename.c_str(), O_RDONLY);
+	Debug::check( this->fd >= 0, "Trajectory: cannot open " + filename);
+	struct stat st;
+	fstat( this->fd, &st);
+	this->length = st.st_size;
+	Debug::check( this->length >= sizeof( TrajectoryHeader), "Trajectory: file too short");
+	void* mapped = mmap( NULL, this->length, PROT_READ, MAP_SHARED, this->fd, 0);
+	Debug::check( mapped != MAP_FAILED, "Trajectory: cannot map " + filename);
+	this->data = (const char*)mapped;
+
+	this->header = (const TrajectoryHeader*)this->data;
+	Debug::check( memcmp( this->header->magic, TRAJECTORY_MAGIC, 8) == 0, "Trajectory: not a trajectory file");
+	Debug::check( this->header->byte_order == TRAJECTORY_BYTE_ORDER, "Trajectory: written with a different byte order");
+	Debug::check( this->header->version == TRAJECTORY_VERSION, "Trajectory: unsupported version");
+	//The frame count and offsets are only written by close(); a writer that never got there leaves them zero.
+	Debug::check( this->header->index_offset != 0 && this->header->index_offset >= this->header->reference_offset, "Trajectory: file was not closed");
+	Debug::check( this->header->index_offset + this->header->num_frames * sizeof( uint64_t) <= this->length, "Trajectory: file is truncated");
+
+	const char* p = this->data + sizeof( TrajectoryHeader);
+	this->atoms.resize( this->header->num_atoms);
+	for( int i = 0; i < this->header->num_atoms; i++) {
+		AtomRecord& atom = this->atoms[i];
+		int32_t ints[2];
+		float floats[2];
+		memcpy( ints, p, sizeof( ints)); p += sizeof( ints);
+		memcpy( floats, p, sizeof( floats)); p += sizeof( floats);
+		atom.residue = ints[0];
+		atom.pdb_id = ints[1];
+		atom.occupancy = floats[0];
+		atom.temp_factor = floats[1];
+		atom.id = p; p += atom.id.size() + 1;
+		atom.res_name = p; p += atom.res_name.size() + 1;
+		atom.elem_name = p; p += atom.elem_name.size() + 1;
+	}
+	this->reference = (const float*)(this->data + this->header->reference_offset);
+	this->index = (const uint64_t*)(this->data + this->header->index_offset);
+}
+
+TrajectoryReader::~TrajectoryReader() {
+	munmap( (void*)this->data, this->length);
+	close( this->fd);
+}
+
+long TrajectoryReader::size() const {
+	return this->header->num_frames;
+}
+
+int TrajectoryReader::getLoopStart() const {
+	return this->header->loop_first_residue;
+}
+
+int TrajectoryReader::getLoopEnd() const {
+	return this->header->loop_last_residue;
+}
+
+void TrajectoryReader::getFrame(const long k, vector<Vector3>& positions) const {
+	Debug::check( k >= 0 && k < this->size(), "Trajectory: frame index out of range");
+	int n = this->header->loop_num_atoms;
+	positions.resize( n);
+	const uint32_t* frame = (const uint32_t*)(this->data + this->index[k]);
+	if( frame[0] == FRAME_KEY) {
+		const float* coords = (const float*)(frame + 1);
+		for( int i = 0; i < n; i++)
+			positions[i].set( coords[3 * i], coords[3 * i + 1], coords[3 * i + 2]);
+	}
+	else {
+		const uint32_t* key = (const uint32_t*)(this->data + this->index[frame[1]]);
+		Debug::check( key[0] == FRAME_KEY, "Trajectory: delta frame does not refer to a keyframe");
+		const float* coords = (const float*)(key + 1);
+		const int16_t* deltas = (const int16_t*)(frame + 2);
+		float q = this->header->quantum;
+		for( int i = 0; i < n; i++)
+			positions[i].set( coords[3 * i] + q * deltas[3 * i], coords[3 * i + 1] + q * deltas[3 * i + 1], coords[3 * i + 2] + q * deltas[3 * i + 2]);
+	}
+}
+
+void TrajectoryReader::loadFrame(const long k, PChain* protein) const {
+	Debug::check( protein->size() == this->header->num_residues, "Trajectory: chain does not match the trajectory");
+	vector<Vector3> positions;
+	this->getFrame( k, positions);
+	int a = 0;
+	for( int i = this->header->loop_first_residue; i <= this->header->loop_last_residue; i++) {
+		vector<PAtom*>* atoms = protein->getResidue(i)->getAtoms();
+		for( int j = 0; j < atoms->size(); j++) {
+			Debug::check( a < positions.size() && (*atoms)[j]->getID() == this->atoms[this->header->loop_first_atom + a].id,
+					"Trajectory: chain does not match the trajectory");
+			(*atoms)[j]->changePosition_nonGridUpdate( positions[a]);
+			a++;
+		}
+	}
+	Debug::check( a == positions.size(), "Trajectory: chain does not match the trajectory");
+	protein->updateAtomsGrid();
+}
+
+void TrajectoryReader::writePDB(const long k, const string& filename) const {
+	vector<Vector3> positions;
+	this->getFrame( k, positions);
+	int first = this->header->loop_first_atom;
+	ofstream out( filename.c_str());
+	for( int i = 0; i < this->atoms.size(); i++) {
+		const AtomRecord& atom = this->atoms[i];
+		Vector3 pos;
+		if( i >= first && i < first + (int)positions.size())
+			pos = positions[i - first];
+		else
+			pos.set( this->reference[3 * i], this->reference[3 * i + 1], this->reference[3 * i + 2]);
+		out << PDBIO::formatAtomLine( i + 1, atom.id, atom.res_name, atom.pdb_id, pos, atom.occupancy, atom.temp_factor, atom.elem_name) << endl;
+	}
+	out.close();
+}
+
+void TrajectoryReader::convertToPDB(const string& filename, const string& prefix) {
+	TrajectoryReader reader( filename);
+	for( long k = 0; k < reader.size(); k++) {
+		stringstream ss;
+		ss << prefix << k << ".pdb";
+		reader.writePDB( k, ss.str());
+	}
+}
@@ -0,0 +1,176 @@
+/*
+ * Trajectory.h
+ *
+ *  Created on: Oct 17, 2026
+ */
+
+#ifndef TRAJECTORY_H_
+#define TRAJECTORY_H_
+
+#include <PProtein.h>
+#include <vector.h>
+#include <string>
+#include <stdio.h>
+#include <stdint.h>
+using namespace std;
+
+/*
+ * Binary trajectory file layout (native byte order, checked by a byte-order mark):
+ *
+ *   TrajectoryHeader
+ *   topology: for every atom of the chain
+ *       int32 residue index, int32 PDB residue id, float occupancy, float temperature factor,
+ *       atom id, residue name, element name as '\0'-terminated strings
+ *   reference coordinates: float x, y, z for every atom of the chain
+ *   frames: only the atoms of the loop residues
+ *       keyframe:    uint32 FRAME_KEY,   float x, y, z per loop atom
+ *       delta frame: uint32 FRAME_DELTA, uint32 keyframe index, int16 dx, dy, dz per loop atom,
+ *                    quantized by TrajectoryHeader::quantum against the keyframe
+ *   index: uint64 file offset of every frame
+ *
+ * A delta frame only refers to a keyframe, never to another delta frame, so any frame is decoded with at most two reads.
+ */
+
+/**
+ * @brief Fixed-size header at the beginning of a trajectory file.
+ */
+struct TrajectoryHeader {
+	char magic[8];
+	uint32_t byte_order;
+	uint32_t version;
+	uint32_t num_atoms;
+	uint32_t num_residues;
+	uint32_t loop_first_atom;
+	uint32_t loop_num_atoms;
+	uint32_t loop_first_residue;
+	uint32_t loop_last_residue;
+	uint32_t keyframe_interval;
+	float quantum;
+	uint64_t num_frames;
+	uint64_t index_offset;
+	uint64_t reference_offset;
+};
+
+/**
+ * @brief Appends conformations of a chain to a binary trajectory file. Topology and reference coordinates are stored once,
+ * every frame only holds the coordinates of the loop residues.
+ */
+class TrajectoryWriter {
+public:
+	/**
+	 * @brief Create a trajectory file.
+	 * @param filename output filename
+	 * @param chain the chain; its current conformation is stored as reference
+	 * @param s index of the first loop residue
+	 * @param e index of the last loop residue
+	 * @param delta enable delta encoding of frames against the last keyframe
+	 * @param keyframe_interval maximum number of frames between two keyframes
+	 * @param quantum resolution of delta encoded coordinates in angstrom
+	 */
+	TrajectoryWriter( const string& filename, PChain* chain, const int s, const int e,
+			const bool delta = true, const int keyframe_interval = 100, const float quantum = 0.001f);
+
+	/**
+	 * @brief Close the file if still open.
+	 */
+	virtual ~TrajectoryWriter();
+
+	/**
+	 * @brief Append the current conformation of the chain as a frame.
+	 * @param chain a chain with the same topology as the one given to the constructor
+	 */
+	void append( PChain* chain);
+
+	/**
+	 * @brief Write the frame index and the final header, and close the file.
+	 */
+	void close();
+
+	/**
+	 * @brief Convert PDB files into one trajectory, the first file provides the topology.
+	 * @param pdb_files input PDB files, one frame each
+	 * @param filename output trajectory filename
+	 * @param s index of the first loop residue, e index of the last loop residue; -1 for the whole chain
+	 */
+	static void convertFromPDB( const vector<string>& pdb_files, const string& filename, int s = -1, int e = -1, const bool delta = true);
+
+private:
+	FILE* file;
+	TrajectoryHeader header;
+	bool delta;
+	vector<uint64_t> offsets;
+	vector<float> keyframe;
+	uint32_t keyframe_index;
+	vector<float> coords;
+	vector<int16_t> deltas;
+};
+
+/**
+ * @brief Random-access reader of binary trajectory files. The file is memory-mapped, so frame K is decoded in O(1).
+ */
+class TrajectoryReader {
+public:
+	/**
+	 * @brief Map a trajectory file.
+	 */
+	TrajectoryReader( const string& filename);
+
+	/**
+	 * @brief Unmap the file.
+	 */
+	virtual ~TrajectoryReader();
+
+	/**
+	 * @brief Number of frames.
+	 */
+	long size() const;
+
+	/**
+	 * @brief Index of the first and last loop residue.
+	 */
+	int getLoopStart() const;
+	int getLoopEnd() const;
+
+	/**
+	 * @brief Decode the coordinates of the loop atoms of frame k.
+	 * @param positions stores the positions, in the order of PResidue::getAtoms() over the loop residues
+	 */
+	void getFrame( const long k, vector<Vector3>& positions) const;
+
+	/**
+	 * @brief Set the loop atoms of a chain to frame k and update the collision grid.
+	 * @param protein a chain with the topology of the trajectory, e.g. read from the same PDB file
+	 */
+	void loadFrame( const long k, PChain* protein) const;
+
+	/**
+	 * @brief Write frame k as a PDB file; atoms outside the loop keep their reference coordinates.
+	 */
+	void writePDB( const long k, const string& filename) const;
+
+	/**
+	 * @brief Convert every frame into PDB files named prefix + k + ".pdb".
+	 */
+	static void convertToPDB( const string& filename, const string& prefix);
+
+private:
+	struct AtomRecord {
+		int residue;
+		int pdb_id;
+		float occupancy;
+		float temp_factor;
+		string id;
+		string res_name;
+		string elem_name;
+	};
+
+	int fd;
+	size_t length;
+	const char* data;
+	const TrajectoryHeader* header;
+	const uint64_t* index;
+	const float* reference;
+	vector<AtomRecord> atoms;
+};
+
+#endif /* TRAJECTORY_H_ */
@@ -6,6 +6,7 @@
  */
 
 #include "Utility.h"
+#include "PRandom.h"
 #include <iostream>
 #include <fstream>
 #include <sstream>
@@ -13,6 +14,7 @@
 #include <assert.h>
 #include <stdlib.h>
 #include <limits.h>
+#include <unistd.h>
 using namespace std;
 
 //void Utility::print_Double2D(int m, int n, double** values, int start, string name) {
@@ -225,6 +227,28 @@ double Utility::dist(const vector<double>& a, const vector<double>& b, const int
 	return sqrt( sum);
 }
 
+bool Utility::writeFully(const int fd, const void* data, size_t n) {
+	const char* p = (const char*)data;
+	while( n > 0) {
+		ssize_t k = ::write( fd, p, n);
+		if( k <= 0) return false;
+		p += k;
+		n -= k;
+	}
+	return true;
+}
+
+bool Utility::readFully(const int fd, void* data, size_t n) {
+	char* p = (char*)data;
+	while( n > 0) {
+		ssize_t k = ::read( fd, p, n);
+		if( k <= 0) return false;
+		p += k;
+		n -= k;
+	}
+	return true;
+}
+
 void Debug::check(const bool assertion, string comment) {
 	if( assertion == false) {
 		cout << comment << endl;
@@ -234,17 +258,17 @@ void Debug::check(const bool assertion, string comment) {
 
 int Random::nextInt(const int range) {
 	assert( range > 0);
-	return rand() % range;
+	return PRandom::local().nextInt( range);
 }
 
 int Random::nextInt(const int r1, const int r2) {
 	assert( r1 < r2);
-	return rand() % ( r2 - r1 + 1) + r1;
+	return PRandom::local().nextInt( r2 - r1 + 1) + r1;
 }
 
 double Random::nextDouble(const double range) {
 	assert( range > 0);
-	return ( rand() / ((double)INT_MAX)) * range;
+	return PRandom::local().nextDouble() * range;
 }
 
 double Random::nextDouble(const double r1, const double r2) {
@@ -256,18 +280,24 @@ double Random::nextDouble(const double r1, const double r2) {
 	return nextDouble( r2 - r1) + r1;
 }
 
-//BoxCMuller transform
 double Random::nextNormal() {
-	double U = Random::nextDouble(1);
-	double V = Random::nextDouble(1);
-
-	double z1 = sqrt( -2 * log(U)) * cos( 2 * PI * V);
-	double z2 = sqrt( -2 * log(U)) * sin( 2 * PI * V);
-	return U > 0.5? z1: z2;
+	return PRandom::local().nextNormal();
 }
 
 double Random::nextNormal(const double mean, const double std) {
-	return std * Random::nextNormal() + mean;
+	return PRandom::local().nextNormal( mean, std);
+}
+
+void Random::fillUniform(double* values, const int n) {
+	PRandom::local().fillUniform( values, n);
+}
+
+void Random::fillNormal(double* values, const int n, const double mean, const double std) {
+	PRandom::local().fillNormal( values, n, mean, std);
+}
+
+void Random::seed(const unsigned long seed, const unsigned int stream) {
+	PRandom::local().seed( seed, stream);
 }
 
 //Assume the dataset is in increasing order;
@@ -297,3 +327,64 @@ int BinarySearch::search( const vector<double>& data, const double& d, const int
 		return BinarySearch::search( data, d, index, e);
 	}
 }
+
+AliasTable::AliasTable() {
+}
+
+void AliasTable::build(const vector<double>& weights) {
+	Debug::check( weights.size() > 0, "AliasTable: empty distribution");
+	this->build( &weights[0], weights.size());
+}
+
+void AliasTable::build(const double* weights, const int n) {
+	Debug::check( n > 0, "AliasTable: empty distribution");
+	this->prob.resize( n);
+	this->alias.resize( n);
+	AliasTable::build( weights, n, &this->prob[0], &this->alias[0]);
+}
+
+void AliasTable::build(const double* weights, const int n, double* prob, int* alias) {
+	Debug::check( n > 0, "AliasTable: empty distribution");
+	double sum = 0;
+	for( int i = 0; i < n; i++) {
+		Debug::check( weights[i] >= 0, "AliasTable: negative weight");
+		sum += weights[i];
+	}
+	Debug::check( sum > 0, "AliasTable: all weights are zero");
+
+	vector<int> small, large;
+	vector<double> scaled( n);
+	for( int i = 0; i < n; i++) {
+		scaled[i] = weights[i] * n / sum;
+		alias[i] = i;
+		if( scaled[i] < 1)
+			small.push_back( i);
+		else
+			large.push_back( i);
+	}
+	//Fill every bucket of a small weight with the excess of a large one.
+	while( !small.empty() && !large.empty()) {
+		int s = small.back(); small.pop_back();
+		int l = large.back();
+		prob[s] = scaled[s];
+		alias[s] = l;
+		scaled[l] -= 1 - scaled[s];
+		if( scaled[l] < 1) {
+			large.pop_back();
+			small.push_back( l);
+		}
+	}
+	//What is left is 1 up to rounding errors.
+	for( int i = 0; i < large.size(); i++)
+		prob[large[i]] = 1;
+	for( int i = 0; i < small.size(); i++)
+		prob[small[i]] = 1;
+}
+
+int AliasTable::size() const {
+	return this->prob.size();
+}
+
+int AliasTable::sample() const {
+	return this->sample( PRandom::local().nextDouble());
+}
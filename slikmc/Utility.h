@@ -50,6 +50,18 @@ public:
 
 	static double dist( const vector<double>& a, const vector<double>& b, const int minsize);
 
+	/**
+	 * @brief Write exactly n bytes to a file descriptor; pipes and files may take large buffers in pieces.
+	 * @return true if all bytes are written
+	 */
+	static bool writeFully( const int fd, const void* data, size_t n);
+
+	/**
+	 * @brief Read exactly n bytes from a file descriptor.
+	 * @return true if all bytes are read
+	 */
+	static bool readFully( const int fd, void* data, size_t n);
+
 };
 
 /**
@@ -100,7 +112,8 @@ public:
 };
 
 /**
- * @brief An auxiliary class. The class is used for generating random values
+ * @brief An auxiliary class. The class is used for generating random values.
+ * All values are drawn from the generator of the calling thread, see PRandom::local().
  */
 class Random
 {
@@ -148,6 +161,23 @@ public:
 	 * @return a double value
 	 */
 	static double nextNormal( const double mean, const double std);
+
+	/**
+	 * @brief Fill an array with random doubles from 0 to 1 (exclusive).
+	 */
+	static void fillUniform( double* values, const int n);
+
+	/**
+	 * @brief Fill an array with random values from normal distribution N( mean, std * std)
+	 */
+	static void fillNormal( double* values, const int n, const double mean = 0, const double std = 1);
+
+	/**
+	 * @brief Restart the generator of the calling thread.
+	 * @param seed random seed
+	 * @param stream index of an independent stream of the seed, e.g. the index of a Markov chain
+	 */
+	static void seed( const unsigned long seed, const unsigned int stream = 0);
 };
 
 
@@ -168,4 +198,59 @@ private:
 	static int search( const vector<double>& dataset, const double& v, const int s, const int e);
 };
 
+/**
+ * @brief Walker's alias table of a discrete distribution, built with Vose's method in O(n).
+ *
+ * Every bucket i keeps the probability threshold prob[i] and the index alias[i] that takes the rest of the bucket,
+ * so a draw costs one uniform number and one comparison whatever the size of the distribution.
+ */
+class AliasTable {
+public:
+	AliasTable();
+
+	/**
+	 * @brief Build the table from n non-negative weights; the weights need not be normalized.
+	 */
+	void build( const double* weights, const int n);
+
+	void build( const vector<double>& weights);
+
+	/**
+	 * @brief Number of outcomes, 0 if the table is not built.
+	 */
+	int size() const;
+
+	/**
+	 * @brief Draw index i with probability weights[i] / sum(weights).
+	 */
+	int sample() const;
+
+	/**
+	 * @brief Draw an index given a uniform number u in [0, 1).
+	 */
+	inline int sample( const double u) const {
+		return AliasTable::sample( &this->prob[0], &this->alias[0], this->prob.size(), u);
+	}
+
+	/**
+	 * @brief Build a table of n weights into external arrays prob and alias of n entries.
+	 */
+	static void build( const double* weights, const int n, double* prob, int* alias);
+
+	/**
+	 * @brief Draw from a table of n entries stored in external arrays, given a uniform number u in [0, 1).
+	 */
+	static inline int sample( const double* prob, const int* alias, const int n, const double u) {
+		double x = u * n;
+		int i = (int)x;
+		if( i >= n)
+			i = n - 1;
+		return x - i < prob[i] ? i : alias[i];
+	}
+
+private:
+	vector<double> prob;
+	vector<int> alias;
+};
+
 #endif /* UTILITY_H_ */
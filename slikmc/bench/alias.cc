@@ -0,0 +1,105 @@
+/*
+ * alias.cc
+ *
+ *  Created on: Oct 17, 2026
+ *
+ *  Microbenchmark of alias-table draws against binary search over the cumulative distribution,
+ *  on the four Ramachandran grids (1296 cells) and on a rotamer-sized distribution (81 rotamers).
+ *  Build with "make bench" and run from the slikmc directory: ./bench/alias [draws]
+ */
+
+#include "Utility.h"
+#include "PRandom.h"
+#include <iostream>
+#include <fstream>
+#include <sstream>
+#include <stdlib.h>
+#include <math.h>
+#include <time.h>
+using namespace std;
+
+static double now() {
+	struct timespec ts;
+	clock_gettime( CLOCK_MONOTONIC, &ts);
+	return ts.tv_sec + ts.tv_nsec * 1e-9;
+}
+
+static bool readGrid( const string& filename, const int size, vector<double>& weights) {
+	ifstream in( filename.c_str());
+	if( !in.is_open())
+		return false;
+	string line;
+	getline( in, line);
+	stringstream ss( line);
+	weights.assign( size, 0);
+	for( int i = 0; i < size; i++)
+		ss >> weights[i];
+	return true;
+}
+
+/**
+ * @brief Time both samplers on one distribution and compare the drawn frequencies with the weights.
+ * @return largest absolute difference between a drawn frequency and its probability
+ */
+static double run( const string& name, const vector<double>& weights, const int draws) {
+	int n = weights.size();
+	vector<double> acc( 1, 0);
+	for( int i = 0; i < n; i++)
+		acc.push_back( acc.back() + weights[i]);
+	AliasTable table;
+	table.build( weights);
+	PRandom random( 7);
+
+	//Same draw as the samplers used before the alias tables.
+	long sink = 0;
+	double begin = now();
+	for( int k = 0; k < draws; k++) {
+		double p = random.nextDouble() * acc.back() - 0.000000001; if( p < 0) p = 0.000000001;
+		sink += BinarySearch::search( acc, p) - 1;
+	}
+	double t_search = now() - begin;
+
+	vector<long> counts( n, 0);
+	begin = now();
+	for( int k = 0; k < draws; k++) {
+		int i = table.sample( random.nextDouble());
+		counts[i] += 1;
+	}
+	double t_alias = now() - begin;
+
+	double max_error = 0;
+	for( int i = 0; i < n; i++)
+		max_error = max( max_error, fabs( counts[i] / (double)draws - weights[i] / acc.back()));
+
+	cout << name << "\t" << n << " outcomes" << endl;
+	cout << "  binary search:\t" << t_search / draws * 1e9 << " ns/draw" << endl;
+	cout << "  alias table:\t" << t_alias / draws * 1e9 << " ns/draw" << endl;
+	cout << "  speedup:\t" << t_search / t_alias << endl;
+	cout << "  max frequency error:\t" << max_error << "\t(checksum " << sink << ")" << endl;
+	return max_error;
+}
+
+int main(int argc, char *argv[]) {
+	int draws = argc > 1 ? atoi( argv[1]) : 10000000;
+	const char* names[4] = { "pro", "pre_pro", "gly", "gen"};
+
+	double max_error = 0;
+	for( int t = 0; t < 4; t++) {
+		vector<double> weights;
+		string filename = string( "../Data/RamachandranPlot/") + names[t] + ".txt";
+		if( !readGrid( filename, 36 * 36, weights)) {
+			cerr << "Cannot read " << filename << endl;
+			return 1;
+		}
+		max_error = max( max_error, run( names[t], weights, draws));
+	}
+
+	//A skewed distribution of the size of a four-chi rotamer grid.
+	vector<double> rotamers;
+	for( int i = 0; i < 81; i++)
+		rotamers.push_back( exp( -0.1 * i));
+	max_error = max( max_error, run( "rotamer", rotamers, draws));
+
+	//Frequencies of 1e7 draws are within a few 1e-4 of the probabilities.
+	return max_error < 2e-3 ? 0 : 1;
+}
@@ -0,0 +1,101 @@
+/*
+ * bfactor.cc
+ *
+ *  Created on: Oct 17, 2026
+ *
+ *  Microbenchmark of the B-factor prior on a full chain, as evaluated by MHSampler, against the reference
+ *  implementation. The B-factors are taken from the PDB file and the evaluated chain is a copy with a few
+ *  backbone torsions rotated. Residues without B-factors have no finite density, so the chain is evaluated over the
+ *  longest run of residues that have them.
+ *  Build with "make bench" and run from the slikmc directory: ./bench/bfactor [pdb file] [repetitions]
+ */
+
+#include "PBasic.h"
+#include "PExtension.h"
+#include "BFactor.h"
+#include "Utility.h"
+#include <iostream>
+#include <stdlib.h>
+#include <math.h>
+#include <time.h>
+using namespace std;
+
+static double now() {
+	struct timespec ts;
+	clock_gettime( CLOCK_MONOTONIC, &ts);
+	return ts.tv_sec + ts.tv_nsec * 1e-9;
+}
+
+int main(int argc, char *argv[]) {
+	LoopTK::Initialize( SUPPRESS_WARNINGS);
+	string filename = argc > 1 ? argv[1] : "../pdbfiles/1B8C.pdb";
+	int repetitions = argc > 2 ? atoi( argv[2]) : 2000;
+
+	PProtein* protein = PDBIO::readFromFile( filename);
+	BFactor bfactor( protein);
+	PProtein* chain = protein->Clone();
+	for( int dof = 2; dof < chain->NumBackboneDOFs(); dof += chain->NumBackboneDOFs() / 4)
+		chain->RotateBackbone( dof, forward, 3);
+	int e = chain->size() - 1;
+
+	//Both implementations must agree on every residue and on the evaluated run, up to the single precision distances
+	//of the reference implementation. Atoms missing from the PDB file
+	//are added without a B-factor, and their residues have no finite density in either implementation.
+	double max_error = 0;
+	int missing = 0, s = 0, t = -1, first = 0;
+	for( int i = 0; i <= e; i++) {
+		PProtein residue( chain, i, i);
+		double r = bfactor.evalAtomPositionsReference( &residue, i, i);
+		double f = bfactor.evalResidue( chain->getResidue(i), i);
+		if( !isfinite( r)) {
+			missing += 1;
+			first = i + 1;
+			max_error = max( max_error, isfinite( f) ? 1.0 : 0.0);
+			continue;
+		}
+		max_error = max( max_error, fabs( r - f) / max( 1.0, fabs( r)));
+		if( i - first > t - s) {
+			s = first;
+			t = i;
+		}
+	}
+	if( t < 0) {
+		cout << "no residue has B-factors" << endl;
+		return 1;
+	}
+	PProtein run( chain, s, t);
+	double ref = bfactor.evalAtomPositionsReference( &run, s, t);
+	double fast = bfactor.evalAtomPositions( &run, s, t);
+	max_error = max( max_error, isfinite( ref) && isfinite( fast) ? fabs( ref - fast) / max( 1.0, fabs( ref)) : 1.0);
+
+	double sink = 0;
+	double begin = now();
+	for( int r = 0; r < repetitions; r++)
+		sink += bfactor.evalAtomPositionsReference( &run, s, t);
+	double t_ref = now() - begin;
+
+	begin = now();
+	for( int r = 0; r < repetitions; r++)
+		sink += bfactor.evalAtomPositions( &run, s, t);
+	double t_fast = now() - begin;
+
+	//The kernel alone, on coordinates that are already in a buffer.
+	vector<double> x, y, z;
+	BFactor::getBackbonePositions( &run, x, y, z);
+	begin = now();
+	for( int r = 0; r < repetitions; r++)
+		sink += bfactor.evalBackbone( &x[0], &y[0], &z[0], s, t);
+	double t_kernel = now() - begin;
+
+	cout << "residues:\t" << chain->size() << "\twithout B-factors:\t" << missing << "\tevaluated:\t" << s << "-" << t
+			<< "\tcalls:\t" << repetitions << endl;
+	cout << "reference:\t" << t_ref / repetitions * 1e6 << " us/call" << endl;
+	cout << "structure of arrays:\t" << t_fast / repetitions * 1e6 << " us/call" << endl;
+	cout << "kernel only:\t" << t_kernel / repetitions * 1e6 << " us/call" << endl;
+	cout << "speedup:\t" << t_ref / t_fast << endl;
+	cout << "max relative error:\t" << max_error << endl;
+	cout << "(checksum " << sink << ")" << endl;
+
+	delete protein;
+	return max_error < 1e-6 ? 0 : 1;
+}
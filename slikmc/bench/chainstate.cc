@@ -0,0 +1,101 @@
+/*
+ * chainstate.cc
+ *
+ *  Created on: Oct 17, 2026
+ *
+ *  Microbenchmark of saving and restoring the atoms of a block around a rejected move, as SLIKMCSampler does for
+ *  every proposal: a snapshot of all atoms of the block (allocated per move) against the reusable undo log.
+ *  Every backbone DOF of the 4-residue blocks of the chain is rotated in turn, then the block is restored; the rotation
+ *  itself is not timed.
+ *  Build with "make bench" and run from the slikmc directory: ./bench/chainstate [pdb file] [repetitions]
+ */
+
+#include "PBasic.h"
+#include "PExtension.h"
+#include "PChainState.h"
+#include <iostream>
+#include <stdlib.h>
+#include <time.h>
+using namespace std;
+
+static double now() {
+	struct timespec ts;
+	clock_gettime( CLOCK_MONOTONIC, &ts);
+	return ts.tv_sec + ts.tv_nsec * 1e-9;
+}
+
+static void getPositions( PChain* chain, vector<Vector3>& positions) {
+	positions.clear();
+	for( int i = 0; i < chain->size(); i++) {
+		vector<PAtom*>* atoms = chain->getResidue(i)->getAtoms();
+		for( int j = 0; j < atoms->size(); j++)
+			positions.push_back( (*atoms)[j]->getPos());
+	}
+}
+
+/**
+ * @brief Rotate the DOF of a block that the k-th move of the benchmark changes.
+ */
+static void move( PProtein* block, const int k) {
+	int dof = k % block->NumBackboneDOFs();
+	block->RotateChain_noGridUpdate( "backbone", dof, forward, 5 + k % 7);
+}
+
+int main(int argc, char *argv[]) {
+	LoopTK::Initialize( SUPPRESS_WARNINGS);
+	string filename = argc > 1 ? argv[1] : "../pdbfiles/1B8C.pdb";
+	int repetitions = argc > 2 ? atoi( argv[2]) : 20000;
+
+	PProtein* protein = PDBIO::readFromFile( filename);
+	vector<PProtein*> blocks;
+	for( int j = 0; j + 3 < protein->size(); j++)
+		blocks.push_back( new PProtein( protein, j, j + 3));
+	vector<Vector3> original, restored;
+	getPositions( protein, original);
+
+	double t_snapshot = 0;
+	for( int k = 0; k < repetitions; k++) {
+		PProtein* block = blocks[k % blocks.size()];
+		block->attachResidues();
+		double begin = now();
+		PChainState* state = block->saveChainState();
+		t_snapshot += now() - begin;
+		move( block, k);
+		begin = now();
+		block->restoreChainState_noGridUpdate( state);
+		delete state;
+		t_snapshot += now() - begin;
+	}
+	getPositions( protein, restored);
+	bool ok = restored == original;
+
+	PChainState log;
+	double t_undo = 0;
+	double t_move = 0;
+	long recorded = 0;
+	for( int k = 0; k < repetitions; k++) {
+		PProtein* block = blocks[k % blocks.size()];
+		block->attachResidues();
+		double begin = now();
+		block->saveChainState( &log);
+		t_undo += now() - begin;
+		//Recording during the move is part of the cost of the undo log.
+		begin = now();
+		move( block, k);
+		t_move += now() - begin;
+		recorded += log.getNumRecorded();
+		begin = now();
+		block->restoreChainState_noGridUpdate( &log);
+		log.stopRecording();
+		t_undo += now() - begin;
+	}
+	getPositions( protein, restored);
+	ok = ok && restored == original;
+
+	cout << "blocks:\t" << blocks.size() << " of 4 residues, " << repetitions << " moves" << endl;
+	cout << "  snapshot:\t" << t_snapshot / repetitions * 1e9 << " ns/move" << endl;
+	cout << "  undo log:\t" << t_undo / repetitions * 1e9 << " ns/move, " << recorded / (double)repetitions << " atoms recorded" << endl;
+	cout << "  move with recording:\t" << t_move / repetitions * 1e9 << " ns/move" << endl;
+	cout << "  positions restored:\t" << (ok ? "exactly" : "NOT exactly") << endl;
+	return ok ? 0 : 1;
+}
@@ -0,0 +1,182 @@
+/*
+ * grid.cc
+ *
+ *  Created on: Oct 17, 2026
+ *
+ *  Microbenchmark of the collision queries of PGrid: the previous grid, a hash_map from float cell coordinates to a
+ *  hash_set of atoms with a new AtomSet per query (rebuilt here), against the grid of packed integer cell keys with
+ *  inline per-cell atoms. The previous grid is also timed with the distance checked before the bond path, to tell the
+ *  two changes apart. Every atom of the chain is checked for a collision, as InAnyCollision() does, on the chain as
+ *  read and after backbone rotations that make it collide with itself.
+ *  Build with "make bench" and run from the slikmc directory: ./bench/grid [pdb file] [repetitions]
+ */
+
+#include "PBasic.h"
+#include "PExtension.h"
+#include "PConstants.h"
+#include <iostream>
+#include <memory>
+#include <stdlib.h>
+#include <math.h>
+#include <time.h>
+using namespace std;
+
+static double now() {
+	struct timespec ts;
+	clock_gettime( CLOCK_MONOTONIC, &ts);
+	return ts.tv_sec + ts.tv_nsec * 1e-9;
+}
+
+/**
+ * @brief Hash of the previous grid: the product of the cell coordinates.
+ */
+struct productHash {
+	size_t operator()( const Vector3 &v) const {
+		hash<int> intHash;
+		int x = int(v.x) + 101, y = int(v.y) + 201, z = int(v.z) + 301;
+		return intHash( x * y * z);
+	}
+};
+
+typedef hash_map<Vector3, AtomSet, productHash, vectorEq> ReferenceMap;
+
+/**
+ * @brief The previous grid and its queries, with the cell side of PGrid.
+ */
+class ReferenceGrid {
+public:
+	ReferenceGrid( PChain* chain, Real side_length, bool distance_first) {
+		this->side_length = side_length;
+		this->distance_first = distance_first;
+		this->delta = 1;
+		for( int i = 0; i < chain->size(); i++) {
+			vector<PAtom*>* atoms = chain->getResidue(i)->getAtoms();
+			for( int j = 0; j < atoms->size(); j++)
+				this->grid[ this->scaleToGrid( (*atoms)[j]->getPos())].insert( (*atoms)[j]);
+		}
+	}
+
+	AtomSet* findColliding( const PAtom* atom, bool getOnlyOne) const {
+		AtomSet *s = new AtomSet();
+		Vector3 centerPos = this->scaleToGrid( atom->getPos());
+		for( int xDelta = -this->delta; xDelta <= this->delta; xDelta++)
+			for( int yDelta = -this->delta; yDelta <= this->delta; yDelta++)
+				for( int zDelta = -this->delta; zDelta <= this->delta; zDelta++) {
+					Vector3 curPos( centerPos.x + xDelta, centerPos.y + yDelta, centerPos.z + zDelta);
+					ReferenceMap::const_iterator found = this->grid.find( curPos);
+					if( found == this->grid.end())
+						continue;
+					for( AtomSet::const_iterator it = found->second.begin(); it != found->second.end(); ++it)
+						if( (*it)->isActive() && inCollision( atom, *it, this->distance_first)) {
+							s->insert( *it);
+							if( getOnlyOne)
+								return s;
+						}
+				}
+		return s;
+	}
+
+private:
+	Vector3 scaleToGrid( const Vector3 &pos) const {
+		return Vector3( int( floor( pos.x / this->side_length)), int( floor( pos.y / this->side_length)),
+				int( floor( pos.z / this->side_length)));
+	}
+
+	/**
+	 * @brief The van der Waals metric; previously the bond path was searched before the distance was checked.
+	 */
+	static bool inCollision( const PAtom* a1, const PAtom* a2, bool distance_first) {
+		if( !a1->isActive() || !a2->isActive() || a1 == a2)
+			return false;
+		Real radiusSum = a1->getVanDerWaalsRadius() + a2->getVanDerWaalsRadius();
+		if( distance_first && COLLISION_THRESHOLD * radiusSum < a1->getPos().distance( a2->getPos()))
+			return false;
+		if( PAtom::shortestBondPath( a1, a2, PGrid::BOND_THRESHOLD + 1) <= PGrid::BOND_THRESHOLD)
+			return false;
+		return COLLISION_THRESHOLD * radiusSum >= a1->getPos().distance( a2->getPos());
+	}
+
+	ReferenceMap grid;
+	Real side_length;
+	bool distance_first;
+	int delta;
+};
+
+static void getAtoms( PChain* chain, vector<PAtom*>& atoms) {
+	atoms.clear();
+	for( int i = 0; i < chain->size(); i++) {
+		vector<PAtom*>* residue_atoms = chain->getResidue(i)->getAtoms();
+		atoms.insert( atoms.end(), residue_atoms->begin(), residue_atoms->end());
+	}
+}
+
+/**
+ * @brief Time the grids on every atom of the chain, and check that they find the same collisions.
+ */
+static bool compare( PProtein* protein, const int repetitions, double t[3], int& num_colliding) {
+	const PGrid* grid = dynamic_cast<const PGrid*>( protein->getSpaceManager());
+	ReferenceGrid reference( protein, grid->getSideLength(), false);
+	ReferenceGrid distance_first( protein, grid->getSideLength(), true);
+	vector<PAtom*> atoms;
+	getAtoms( protein, atoms);
+
+	bool ok = true;
+	num_colliding = 0;
+	for( int i = 0; i < atoms.size(); i++) {
+		auto_ptr<AtomSet> expected( reference.findColliding( atoms[i], false));
+		auto_ptr<AtomSet> found( atoms[i]->getAllCollidingEither());
+		ok = ok && *expected == *found && (atoms[i]->FindAnyCollision() != NULL) == !expected->empty();
+		num_colliding += !expected->empty();
+	}
+
+	//The grids take turns, so that all see the same load of the machine.
+	t[0] = t[1] = t[2] = 0;
+	int collisions[3] = { 0, 0, 0};
+	for( int k = 0; k < repetitions; k++) {
+		for( int g = 0; g < 2; g++) {
+			double begin = now();
+			for( int i = 0; i < atoms.size(); i++) {
+				AtomSet* s = (g == 0 ? reference : distance_first).findColliding( atoms[i], true);
+				collisions[g] += !s->empty();
+				delete s;
+			}
+			t[g] += now() - begin;
+		}
+		double begin = now();
+		for( int i = 0; i < atoms.size(); i++)
+			collisions[2] += atoms[i]->FindAnyCollision() != NULL;
+		t[2] += now() - begin;
+	}
+	for( int g = 0; g < 3; g++)
+		t[g] /= repetitions * atoms.size();
+	return ok && collisions[0] == collisions[2] && collisions[1] == collisions[2];
+}
+
+int main(int argc, char *argv[]) {
+	LoopTK::Initialize( SUPPRESS_WARNINGS);
+	string filename = argc > 1 ? argv[1] : "../pdbfiles/1B8C.pdb";
+	int repetitions = argc > 2 ? atoi( argv[2]) : 100;
+
+	PProtein* protein = PDBIO::readFromFile( filename);
+	vector<PAtom*> atoms;
+	getAtoms( protein, atoms);
+	cout << "chain:\t" << protein->size() << " residues, " << atoms.size() << " atoms, " << repetitions << " queries of every atom" << endl;
+
+	for( int pass = 0; pass < 2; pass++) {
+		//Fold the second half of the chain back onto the first.
+		for( int i = 0; pass == 1 && i < 4 && !protein->InAnyCollision(); i++)
+			protein->RotateChain( "backbone", protein->NumBackboneDOFs() / 2 + i, forward, 90);
+		double t[3];
+		int num_colliding;
+		bool ok = compare( protein, repetitions, t, num_colliding);
+		cout << (pass == 0 ? "as read:\t" : "rotated:\t") << num_colliding << " colliding atoms" << endl;
+		cout << "  float keys, AtomSet per query:\t" << t[0] * 1e9 << " ns/atom" << endl;
+		cout << "  same, distance before bond path:\t" << t[1] * 1e9 << " ns/atom" << endl;
+		cout << "  integer keys, no allocation:\t" << t[2] * 1e9 << " ns/atom" << endl;
+		cout << "  speedup:\t" << t[0] / t[2] << " (" << t[1] / t[2] << " from the grid)" << endl;
+		cout << "  collisions:\t" << (ok ? "identical" : "NOT identical") << endl;
+		if( !ok)
+			return 1;
+	}
+	return 0;
+}
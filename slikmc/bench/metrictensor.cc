@@ -0,0 +1,74 @@
+/*
+ * metrictensor.cc
+ *
+ *  Created on: Oct 17, 2026
+ *
+ *  Microbenchmark of the fixed-size metric tensor kernel against the reference implementation.
+ *  Build with "make bench" and run from the slikmc directory: ./bench/metrictensor [pdb file] [repetitions]
+ */
+
+#include "PBasic.h"
+#include "PExtension.h"
+#include "MetricTensor.h"
+#include "Utility.h"
+#include <iostream>
+#include <stdlib.h>
+#include <math.h>
+#include <time.h>
+using namespace std;
+
+static double now() {
+	struct timespec ts;
+	clock_gettime( CLOCK_MONOTONIC, &ts);
+	return ts.tv_sec + ts.tv_nsec * 1e-9;
+}
+
+int main(int argc, char *argv[]) {
+	LoopTK::Initialize( SUPPRESS_WARNINGS);
+	string filename = argc > 1 ? argv[1] : "../pdbfiles/1B8C.pdb";
+	int repetitions = argc > 2 ? atoi( argv[2]) : 200;
+
+	PProtein* protein = PDBIO::readFromFile( filename);
+	vector<PProtein*> blocks;
+	for( int i = 0; i + 3 < protein->size(); i++) {
+		blocks.push_back( new PProtein( protein, i, i + 3));
+	}
+
+	//Both implementations must agree on every block.
+	double max_error = 0;
+	for( int i = 0; i < blocks.size(); i++) {
+		int status_ref = 0, status_fast = 0;
+		double ref = MetricTensor::evalBlockReference_log( blocks[i], status_ref);
+		double fast = MetricTensor::evalBlock_log( blocks[i], status_fast);
+		Debug::check( status_ref == status_fast, "Kernels disagree on singularity");
+		if( status_ref == 0)
+			max_error = max( max_error, fabs( ref - fast) / max( 1.0, fabs( ref)));
+	}
+
+	double sink = 0;
+	int status = 0;
+	double begin = now();
+	for( int r = 0; r < repetitions; r++)
+		for( int i = 0; i < blocks.size(); i++)
+			sink += MetricTensor::evalBlockReference_log( blocks[i], status);
+	double t_ref = now() - begin;
+
+	begin = now();
+	for( int r = 0; r < repetitions; r++)
+		for( int i = 0; i < blocks.size(); i++)
+			sink += MetricTensor::evalBlock_log( blocks[i], status);
+	double t_fast = now() - begin;
+
+	int calls = repetitions * blocks.size();
+	cout << "blocks:\t" << blocks.size() << "\tcalls:\t" << calls << endl;
+	cout << "reference:\t" << t_ref / calls * 1e6 << " us/call" << endl;
+	cout << "fixed-size:\t" << t_fast / calls * 1e6 << " us/call" << endl;
+	cout << "speedup:\t" << t_ref / t_fast << endl;
+	cout << "max relative error:\t" << max_error << endl;
+	cout << "(checksum " << sink << ")" << endl;
+
+	for( int i = 0; i < blocks.size(); i++)
+		delete blocks[i];
+	delete protein;
+	return max_error < 1e-8 ? 0 : 1;
+}
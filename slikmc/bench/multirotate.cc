@@ -0,0 +1,113 @@
+/*
+ * multirotate.cc
+ *
+ *  Created on: Oct 17, 2026
+ *
+ *  Microbenchmark of a multi-DOF block update such as an IK solution: the moves rotated one after the other
+ *  against PChain::MultiRotate_noGridUpdate, which composes them and transforms every atom once.
+ *  All 8 backbone DOFs of the 4-residue blocks of the chain are changed at once, one block after the other.
+ *  Build with "make bench" and run from the slikmc directory: ./bench/multirotate [pdb file] [repetitions]
+ */
+
+#include "PBasic.h"
+#include "PExtension.h"
+#include <iostream>
+#include <stdlib.h>
+#include <math.h>
+#include <time.h>
+using namespace std;
+
+static double now() {
+	struct timespec ts;
+	clock_gettime( CLOCK_MONOTONIC, &ts);
+	return ts.tv_sec + ts.tv_nsec * 1e-9;
+}
+
+static void getPositions( PChain* chain, vector<Vector3>& positions) {
+	positions.clear();
+	for( int i = 0; i < chain->size(); i++) {
+		vector<PAtom*>* atoms = chain->getResidue(i)->getAtoms();
+		for( int j = 0; j < atoms->size(); j++)
+			positions.push_back( (*atoms)[j]->getPos());
+	}
+}
+
+/**
+ * @brief Moves of the k-th block update, the same for both versions.
+ */
+static void getMoves( PProtein* block, const int k, vector<ChainMove>& moves) {
+	moves.clear();
+	for( int i = 0; i < block->NumBackboneDOFs(); i++) {
+		ChainMove move;
+		move.blockType = "backbone";
+		move.DOF_index = i;
+		move.dir = forward;
+		move.degrees = ((k + 3 * i) % 11) - 5;
+		moves.push_back( move);
+	}
+}
+
+int main(int argc, char *argv[]) {
+	LoopTK::Initialize( SUPPRESS_WARNINGS);
+	string filename = argc > 1 ? argv[1] : "../pdbfiles/1B8C.pdb";
+	int repetitions = argc > 2 ? atoi( argv[2]) : 20000;
+
+	//Two copies of the chain, moved by either version.
+	PProtein* proteins[2];
+	vector<PProtein*> blocks[2];
+	for( int c = 0; c < 2; c++) {
+		proteins[c] = PDBIO::readFromFile( filename);
+		for( int j = 0; j + 3 < proteins[c]->size(); j++)
+			blocks[c].push_back( new PProtein( proteins[c], j, j + 3));
+	}
+	vector<ChainMove> moves;
+
+	//One update of every block by either version. Rounding differs in single precision, and repeated rotations
+	//amplify any difference, so the versions are compared after a single pass.
+	vector<Vector3> sequential, composed;
+	for( int j = 0; j < blocks[0].size(); j++) {
+		getMoves( blocks[0][j], j, moves);
+		blocks[0][j]->attachResidues();
+		vector<PBond*>& dofs = blocks[0][j]->GetDOFs( "backbone");
+		for( int i = 0; i < moves.size(); i++)
+			dofs[ moves[i].DOF_index]->Rotate_noGridUpdate( moves[i].dir, moves[i].degrees, blocks[0][j]);
+		blocks[1][j]->attachResidues();
+		blocks[1][j]->MultiRotate_noGridUpdate( moves);
+	}
+	getPositions( proteins[0], sequential);
+	getPositions( proteins[1], composed);
+	double max_error = 0;
+	for( int i = 0; i < sequential.size(); i++)
+		max_error = max( max_error, (double)sequential[i].distance( composed[i]));
+
+	//The blocks overlap, so they are attached one at a time as SLIKMCSampler does. Every block is updated a few
+	//times in a row, as a block is by the proposals of one iteration.
+	double t_sequential = 0;
+	for( int k = 0; k < repetitions; k++) {
+		PProtein* block = blocks[0][(k / 4) % blocks[0].size()];
+		block->attachResidues();
+		getMoves( block, k, moves);
+		double begin = now();
+		vector<PBond*>& dofs = block->GetDOFs( "backbone");
+		for( int i = 0; i < moves.size(); i++)
+			dofs[ moves[i].DOF_index]->Rotate_noGridUpdate( moves[i].dir, moves[i].degrees, block);
+		t_sequential += now() - begin;
+	}
+
+	double t_composed = 0;
+	for( int k = 0; k < repetitions; k++) {
+		PProtein* block = blocks[1][(k / 4) % blocks[1].size()];
+		block->attachResidues();
+		getMoves( block, k, moves);
+		double begin = now();
+		block->MultiRotate_noGridUpdate( moves);
+		t_composed += now() - begin;
+	}
+
+	cout << "blocks:\t" << blocks[1].size() << " of 4 residues, " << repetitions << " updates of " << moves.size() << " DOFs" << endl;
+	cout << "  one move after the other:\t" << t_sequential / repetitions * 1e9 << " ns/update" << endl;
+	cout << "  composed:\t" << t_composed / repetitions * 1e9 << " ns/update" << endl;
+	cout << "  speedup:\t" << t_sequential / t_composed << endl;
+	cout << "  max atom distance after one update of every block:\t" << max_error << " A" << endl;
+	return max_error < 1e-3 ? 0 : 1;
+}
@@ -0,0 +1,102 @@
+/*
+ * nerf.cc
+ *
+ *  Created on: Oct 17, 2026
+ *
+ *  Microbenchmark of a multi-torsion move of the whole chain: the DOFs rotated one after the other against
+ *  PInternalCoordinates, which sets the torsions and places the downstream atoms once. The 8 backbone DOFs of a
+ *  4-residue window are changed together, the window moving along the chain. Also reports how far the bond lengths
+ *  have drifted from those read after all moves.
+ *  Build with "make bench" and run from the slikmc directory: ./bench/nerf [pdb file] [repetitions]
+ */
+
+#include "PBasic.h"
+#include "PExtension.h"
+#include "PInternalCoordinates.h"
+#include <iostream>
+#include <stdlib.h>
+#include <math.h>
+#include <time.h>
+using namespace std;
+
+static double now() {
+	struct timespec ts;
+	clock_gettime( CLOCK_MONOTONIC, &ts);
+	return ts.tv_sec + ts.tv_nsec * 1e-9;
+}
+
+/**
+ * @brief Largest change of a bond length of the chain, against the same chain as read.
+ */
+static double maxBondDrift( PChain* chain, PChain* original) {
+	double drift = 0;
+	for( int i = 0; i < chain->size(); i++) {
+		vector<PAtom*>* atoms = chain->getResidue(i)->getAtoms();
+		vector<PAtom*>* atoms_original = original->getResidue(i)->getAtoms();
+		for( int j = 0; j < atoms->size(); j++) {
+			const vector<PBond*>* bonds = (*atoms)[j]->getBonds();
+			const vector<PBond*>* bonds_original = (*atoms_original)[j]->getBonds();
+			for( int b = 0; b < bonds->size(); b++) {
+				//The ring closure of proline is stretched by backbone moves either way.
+				string id1 = (*bonds)[b]->getAtom1()->getID(), id2 = (*bonds)[b]->getAtom2()->getID();
+				if( (id1 == "N" && id2 == "CD") || (id1 == "CD" && id2 == "N"))
+					continue;
+				drift = max( drift, fabs( (double)(*bonds)[b]->getLength() - (*bonds_original)[b]->getLength()));
+			}
+		}
+	}
+	return drift;
+}
+
+/**
+ * @brief Rotation of the i-th DOF of the k-th move, the same for both versions. Every move is undone by the next one
+ * so that the chain stays folded.
+ */
+static double getDegrees( const int k, const int i) {
+	return (k % 2 == 0 ? 1 : -1) * (((k / 2 + 3 * i) % 11) - 5 + 0.37);
+}
+
+int main(int argc, char *argv[]) {
+	LoopTK::Initialize( SUPPRESS_WARNINGS);
+	string filename = argc > 1 ? argv[1] : "../pdbfiles/1B8C.pdb";
+	int repetitions = argc > 2 ? atoi( argv[2]) : 20000;
+	const int window = 8;
+
+	PProtein* original = PDBIO::readFromFile( filename);
+	PProtein* rotated = PDBIO::readFromFile( filename);
+	PProtein* built = PDBIO::readFromFile( filename);
+	PInternalCoordinates coords( built);
+	int num_dofs = built->NumBackboneDOFs();
+	vector<int> torsions( num_dofs);
+	for( int i = 0; i < num_dofs; i++)
+		torsions[i] = coords.getTorsionIndex( "backbone", i);
+
+	double t_rotated = 0;
+	for( int k = 0; k < repetitions; k++) {
+		int first = ((k / 2) * window) % (num_dofs - window);
+		double begin = now();
+		for( int i = 0; i < window; i++)
+			rotated->RotateChain_noGridUpdate( "backbone", first + i, forward, getDegrees( k, i));
+		t_rotated += now() - begin;
+	}
+
+	double t_built = 0;
+	for( int k = 0; k < repetitions; k++) {
+		int first = ((k / 2) * window) % (num_dofs - window);
+		double begin = now();
+		for( int i = 0; i < window; i++)
+			coords.rotateTorsion( torsions[ first + i], getDegrees( k, i));
+		coords.rebuild();
+		t_built += now() - begin;
+	}
+
+	double drift_rotated = maxBondDrift( rotated, original);
+	double drift_built = maxBondDrift( built, original);
+	cout << "chain:\t" << built->size() << " residues, " << coords.getNumAtoms() << " atoms, " << repetitions
+			<< " moves of " << window << " DOFs" << endl;
+	cout << "  one rotation after the other:\t" << t_rotated / repetitions * 1e6 << " us/move" << endl;
+	cout << "  torsions and one rebuild:\t" << t_built / repetitions * 1e6 << " us/move" << endl;
+	cout << "  speedup:\t" << t_rotated / t_built << endl;
+	cout << "  max bond length drift:\t" << drift_rotated << " A rotated, " << drift_built << " A rebuilt" << endl;
+	return drift_built < 1e-3 ? 0 : 1;
+}
@@ -0,0 +1,125 @@
+/*
+ * rotate.cc
+ *
+ *  Created on: Oct 17, 2026
+ *
+ *  Microbenchmark of a torsion move: the recursive walk of the bond graph (a new AtomSet per move) against the
+ *  cached list of atoms moved by the DOF. Every backbone DOF of the 4-residue blocks of the chain is rotated in turn,
+ *  in both directions, as the samplers do.
+ *  Build with "make bench" and run from the slikmc directory: ./bench/rotate [pdb file] [repetitions]
+ */
+
+#include "PBasic.h"
+#include "PExtension.h"
+#include <iostream>
+#include <algorithm>
+#include <stdlib.h>
+#include <time.h>
+using namespace std;
+
+static double now() {
+	struct timespec ts;
+	clock_gettime( CLOCK_MONOTONIC, &ts);
+	return ts.tv_sec + ts.tv_nsec * 1e-9;
+}
+
+static void getPositions( PChain* chain, vector<Vector3>& positions) {
+	positions.clear();
+	for( int i = 0; i < chain->size(); i++) {
+		vector<PAtom*>* atoms = chain->getResidue(i)->getAtoms();
+		for( int j = 0; j < atoms->size(); j++)
+			positions.push_back( (*atoms)[j]->getPos());
+	}
+}
+
+/**
+ * @brief Rotation of the k-th move, the same for both versions.
+ */
+static void getMove( PProtein* block, const int k, PBond*& dof, BondDirection& dir, float& degrees) {
+	vector<PBond*>& dofs = block->GetDOFs( "backbone");
+	dof = dofs[ k % dofs.size()];
+	dir = (k / dofs.size()) % 2 == 0 ? forward : backward;
+	degrees = 5 + k % 7;
+}
+
+/**
+ * @brief Check that the cached atoms of every DOF are the atoms the walk visits.
+ */
+static bool checkMovedAtoms( PProtein* block) {
+	vector<PBond*>& dofs = block->GetDOFs( "backbone");
+	for( int i = 0; i < dofs.size(); i++) {
+		for( int d = 0; d < 2; d++) {
+			BondDirection dir = d == 0 ? forward : backward;
+			pair<PAtom*, PAtom*> atom_pair = dofs[i]->getAtomPair( dir);
+			AtomSet* traversed = PAtom::internalTraverse( atom_pair, block);
+			traversed->erase( atom_pair.first);
+			vector<PAtom*> walked( traversed->begin(), traversed->end());
+			delete traversed;
+			sort( walked.begin(), walked.end());
+			if( walked != dofs[i]->getMovedAtoms( dir, block))
+				return false;
+		}
+	}
+	return true;
+}
+
+int main(int argc, char *argv[]) {
+	LoopTK::Initialize( SUPPRESS_WARNINGS);
+	string filename = argc > 1 ? argv[1] : "../pdbfiles/1B8C.pdb";
+	int repetitions = argc > 2 ? atoi( argv[2]) : 20000;
+
+	//Two copies of the chain, moved by either version.
+	PProtein* proteins[2];
+	vector<PProtein*> blocks[2];
+	for( int c = 0; c < 2; c++) {
+		proteins[c] = PDBIO::readFromFile( filename);
+		for( int j = 0; j + 3 < proteins[c]->size(); j++)
+			blocks[c].push_back( new PProtein( proteins[c], j, j + 3));
+	}
+	vector<Vector3> walked, cached;
+
+	bool ok = true;
+	for( int j = 0; j < blocks[1].size(); j++) {
+		blocks[1][j]->attachResidues();
+		ok = ok && checkMovedAtoms( blocks[1][j]);
+	}
+
+	//The blocks overlap, so they are attached one at a time as SLIKMCSampler does. The cached lists are built
+	//the first time a DOF is rotated in a block, outside of the timed rotations.
+	double t_walk = 0;
+	long atoms = 0;
+	for( int k = 0; k < repetitions; k++) {
+		PProtein* block = blocks[0][k % blocks[0].size()];
+		block->attachResidues();
+		PBond* dof; BondDirection dir; float degrees;
+		getMove( block, k / blocks[0].size(), dof, dir, degrees);
+		pair<PAtom*, PAtom*> atom_pair = dof->getAtomPair( dir);
+		Rotater r( atom_pair.first->getPos(), atom_pair.second->getPos() - atom_pair.first->getPos(), degrees);
+		double begin = now();
+		dof->traverseChain_noGridUpdate( dir, &r, NULL, block);
+		t_walk += now() - begin;
+	}
+	getPositions( proteins[0], walked);
+
+	double t_cached = 0;
+	for( int k = 0; k < repetitions; k++) {
+		PProtein* block = blocks[1][k % blocks[1].size()];
+		block->attachResidues();
+		PBond* dof; BondDirection dir; float degrees;
+		getMove( block, k / blocks[1].size(), dof, dir, degrees);
+		atoms += dof->getMovedAtoms( dir, block).size();
+		double begin = now();
+		dof->Rotate_noGridUpdate( dir, degrees, block);
+		t_cached += now() - begin;
+	}
+	getPositions( proteins[1], cached);
+	ok = ok && cached == walked;
+
+	cout << "blocks:\t" << blocks[1].size() << " of 4 residues, " << repetitions << " moves, "
+			<< atoms / (double)repetitions << " atoms moved" << endl;
+	cout << "  graph walk:\t" << t_walk / repetitions * 1e9 << " ns/move" << endl;
+	cout << "  cached atoms:\t" << t_cached / repetitions * 1e9 << " ns/move" << endl;
+	cout << "  speedup:\t" << t_walk / t_cached << endl;
+	cout << "  moved atoms and positions:\t" << (ok ? "identical" : "NOT identical") << endl;
+	return ok ? 0 : 1;
+}
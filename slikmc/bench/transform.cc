@@ -0,0 +1,113 @@
+/*
+ * transform.cc
+ *
+ *  Created on: Oct 17, 2026
+ *
+ *  Microbenchmark of the rigid-transform kernel of math3d/transformpoints.h: the kernel chosen for the processor
+ *  against the scalar one on a block of points, and a torsion move of the whole chain with the atoms rotated one at
+ *  a time (Rotater::rotateAtom_nonGridUpdate) against rotated as a block (Rotater::rotateAtoms_nonGridUpdate).
+ *  Build with "make bench" and run from the slikmc directory: ./bench/transform [pdb file] [repetitions]
+ */
+
+#include "PBasic.h"
+#include "PExtension.h"
+#include <math3d/transformpoints.h>
+#include <iostream>
+#include <stdlib.h>
+#include <time.h>
+using namespace std;
+
+static double now() {
+	struct timespec ts;
+	clock_gettime( CLOCK_MONOTONIC, &ts);
+	return ts.tv_sec + ts.tv_nsec * 1e-9;
+}
+
+static void getPositions( PChain* chain, vector<Vector3>& positions) {
+	positions.clear();
+	for( int i = 0; i < chain->size(); i++) {
+		vector<PAtom*>* atoms = chain->getResidue(i)->getAtoms();
+		for( int j = 0; j < atoms->size(); j++)
+			positions.push_back( (*atoms)[j]->getPos());
+	}
+}
+
+/**
+ * @brief Rotation of the k-th move, the same for both versions. Every move is undone by the next one.
+ */
+static Rotater getMove( PProtein* protein, const int k, vector<PAtom*>& atoms) {
+	vector<PBond*>& dofs = protein->GetDOFs( "backbone");
+	PBond* dof = dofs[ (k / 2) % dofs.size()];
+	atoms = dof->getMovedAtoms( forward, protein);
+	pair<PAtom*, PAtom*> atom_pair = dof->getAtomPair( forward);
+	return Rotater( atom_pair.first->getPos(), atom_pair.second->getPos() - atom_pair.first->getPos(),
+			(k % 2 == 0 ? 1 : -1) * (5 + (k / 2) % 7));
+}
+
+int main(int argc, char *argv[]) {
+	LoopTK::Initialize( SUPPRESS_WARNINGS);
+	string filename = argc > 1 ? argv[1] : "../pdbfiles/1B8C.pdb";
+	int repetitions = argc > 2 ? atoi( argv[2]) : 20000;
+
+	//The kernel alone, on a block of points of the size of a chain.
+	const int num_points = 1024;
+	vector<Real> x( num_points), y( num_points), z( num_points);
+	vector<Real> out[6];
+	for( int i = 0; i < 6; i++)
+		out[i].resize( num_points);
+	for( int i = 0; i < num_points; i++) {
+		x[i] = (i % 17) * 1.3 - 10;
+		y[i] = (i % 23) * 0.7 - 8;
+		z[i] = (i % 29) * 0.9 - 12;
+	}
+	RigidTransform transform;
+	Rotater( Vector3( 1, 2, 3), Vector3( 0.3, 0.4, 1), 7).getTransform( transform);
+	//The versions take turns, so that both see the same load of the machine.
+	double t_scalar = 0, t_kernel = 0;
+	for( int k = 0; k < repetitions; k++) {
+		double begin = now();
+		TransformPointsScalar( transform, &x[0], &y[0], &z[0], &out[0][0], &out[1][0], &out[2][0], num_points);
+		t_scalar += now() - begin;
+		begin = now();
+		TransformPoints( transform, &x[0], &y[0], &z[0], &out[3][0], &out[4][0], &out[5][0], num_points);
+		t_kernel += now() - begin;
+	}
+	bool ok = out[0] == out[3] && out[1] == out[4] && out[2] == out[5];
+
+	//Torsion moves of the whole chain, on two copies of it.
+	PProtein* proteins[2];
+	for( int c = 0; c < 2; c++)
+		proteins[c] = PDBIO::readFromFile( filename);
+	vector<PAtom*> atoms;
+	long num_moved = 0;
+	double t_atom = 0, t_block = 0;
+	for( int k = 0; k < repetitions; k++) {
+		Rotater r = getMove( proteins[0], k, atoms);
+		double begin = now();
+		for( int i = 0; i < atoms.size(); i++)
+			r.rotateAtom_nonGridUpdate( atoms[i]);
+		t_atom += now() - begin;
+		num_moved += atoms.size();
+
+		r = getMove( proteins[1], k, atoms);
+		begin = now();
+		r.rotateAtoms_nonGridUpdate( atoms);
+		t_block += now() - begin;
+	}
+	vector<Vector3> by_atom, by_block;
+	getPositions( proteins[0], by_atom);
+	getPositions( proteins[1], by_block);
+	ok = ok && by_atom == by_block;
+
+	cout << "kernel:\t" << TransformPointsKernel() << ", " << num_points << " points" << endl;
+	cout << "  scalar:\t" << t_scalar / repetitions / num_points * 1e9 << " ns/point" << endl;
+	cout << "  " << TransformPointsKernel() << ":\t" << t_kernel / repetitions / num_points * 1e9 << " ns/point" << endl;
+	cout << "  speedup:\t" << t_scalar / t_kernel << endl;
+	cout << "chain:\t" << proteins[1]->size() << " residues, " << repetitions << " moves, "
+			<< num_moved / (double)repetitions << " atoms moved" << endl;
+	cout << "  one atom at a time:\t" << t_atom / repetitions * 1e9 << " ns/move" << endl;
+	cout << "  as a block:\t" << t_block / repetitions * 1e9 << " ns/move" << endl;
+	cout << "  speedup:\t" << t_atom / t_block << endl;
+	cout << "  points and positions:\t" << (ok ? "identical" : "NOT identical") << endl;
+	return ok ? 0 : 1;
+}
@@ -0,0 +1,40 @@
+/*
+ * rotcompile.cc
+ *
+ *  Created on: Oct 17, 2026
+ *
+ *  Compiles the rotamer libraries of Data/ExtendedOpt1-5 to binary images (see RotamerImage), so that no sampler
+ *  has to parse them. Build with "make tools" and run from the slikmc directory:
+ *    ./tools/rotcompile [residue names...]
+ *  Without residue names, all residues with side-chain rotamers are compiled.
+ */
+
+#include "PBasic.h"
+#include "PExtension.h"
+#include "Rotamer.h"
+#include <iostream>
+using namespace std;
+
+int main(int argc, char *argv[]) {
+	LoopTK::Initialize( SUPPRESS_WARNINGS);
+	static const char* RESIDUES[] = { "ARG", "CYS", "ILE", "LEU", "LYS", "MET", "PRO", "SER", "THR", "VAL",
+			"ASN", "ASP", "PHE", "TRP", "HIS", "TYR", "GLN", "GLU"};
+	vector<string> names;
+	for( int i = 1; i < argc; i++)
+		names.push_back( argv[i]);
+	if( names.empty())
+		names.assign( RESIDUES, RESIDUES + sizeof( RESIDUES) / sizeof( RESIDUES[0]));
+
+	Rotamer rotamer;
+	int failed = 0;
+	for( int i = 0; i < names.size(); i++) {
+		if( rotamer.compile( names[i])) {
+			cout << names[i] << "\tcompiled" << endl;
+		}
+		else {
+			cout << names[i] << "\tno library or cannot write the image" << endl;
+			failed += 1;
+		}
+	}
+	return failed == 0 ? 0 : 1;
+}
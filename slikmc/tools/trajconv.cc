@@ -0,0 +1,37 @@
+/*
+ * trajconv.cc
+ *
+ *  Created on: Oct 17, 2026
+ *
+ *  Converts between binary trajectory files and PDB files.
+ *  Build with "make tools" and run from the slikmc directory:
+ *    ./tools/trajconv -to-pdb <trajectory> <prefix>
+ *    ./tools/trajconv -from-pdb <trajectory> <first loop residue> <last loop residue> <pdb files...>
+ *  Residue indices of -1 select the whole chain.
+ */
+
+#include "PBasic.h"
+#include "PExtension.h"
+#include "Trajectory.h"
+#include <iostream>
+#include <stdlib.h>
+using namespace std;
+
+int main(int argc, char *argv[]) {
+	LoopTK::Initialize( SUPPRESS_WARNINGS);
+	string mode = argc > 1 ? argv[1] : "";
+	if( mode == "-to-pdb" && argc == 4) {
+		TrajectoryReader::convertToPDB( argv[2], argv[3]);
+		return 0;
+	}
+	if( mode == "-from-pdb" && argc > 5) {
+		vector<string> files;
+		for( int i = 5; i < argc; i++)
+			files.push_back( argv[i]);
+		TrajectoryWriter::convertFromPDB( files, argv[2], atoi( argv[3]), atoi( argv[4]));
+		return 0;
+	}
+	cerr << "usage: " << argv[0] << " -to-pdb <trajectory> <prefix>" << endl;
+	cerr << "       " << argv[0] << " -from-pdb <trajectory> <first loop residue> <last loop residue> <pdb files...>" << endl;
+	return 1;
+}
@@ -22,6 +22,7 @@
 #include "PUtilities.h"
 #include "PConstants.h"
 #include "PBond.h"
+#include "PChainState.h"
 
 #include <queue>
 #include <math/math.h>
@@ -36,6 +37,7 @@ using namespace std;
 PAtom::PAtom(PBlock *block, const string &name, Vector3 position, const string &id) {
   m_atomBlock = block;
   m_atomPos = position;
+  m_undoEpoch = 0;
 
   m_atomShell = PResources::GetAtomShell(name);
   m_colorSet = false;
@@ -88,6 +90,7 @@ void PAtom::DestroyBonds() {
     }
     delete b;
   }
+  PBond::TopologyChanged();
 }
 
 
@@ -191,6 +194,8 @@ PAtom* PAtom::FindAnyCollision() const {
  */
 
 void PAtom::changePosition(const Vector3 &newPosition) {
+	PChainState::record(this);
+	getParentResidue()->atomMoved();
 	if (WithinActiveBlock())
 	{
 		Vector3 curGridPos = getGridPos();
@@ -226,6 +231,8 @@ void PAtom::changePosition(const Vector3 &newPosition) {
 }
 
 void PAtom::changePosition_nonGridUpdate(const Vector3& newPosition) {
+	PChainState::record(this);
+	getParentResidue()->atomMoved();
 	m_atomPos = newPosition;
 }
 
@@ -21,6 +21,7 @@
 #define __P_ATOM_H
 
 #include <string>
+#include <stdint.h>
 using std::string;
 
 #include <math3d/primitives.h>
@@ -53,6 +54,7 @@ class PAtom {
     friend class PBond;		// so it can add itself to the m_bonds array
     friend class PResidue;	// so that it can call CacheDOF
     friend class PBlock;		// so it can remove atoms on deactivation
+    friend class PChainState;	// so it can stamp the atoms it records
 
     /**
      * Constructs a new PAtom in the specified block, with
@@ -331,6 +333,8 @@ class PAtom {
 
     Vector3 m_atomPos;
     Vector3 m_gridPos;
+    // Epoch of the last undo log that recorded this atom, see PChainState.
+    uint64_t m_undoEpoch;
 
     string m_id;
     PAtomShell *m_atomShell;
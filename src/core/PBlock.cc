@@ -183,6 +183,7 @@ PChain* PBlock::getChain() const {
 
 void PBlock::DeactivateBlock(PBlock *block, PBlock *from) {
   block->m_isOn = false;
+  PBond::TopologyChanged();
   block->m_blockReconnector = new PBlockReconnector(from,block);
   for(HASH_MAP_STR(PAtom *)::iterator it=block->m_atoms.begin();it!=block->m_atoms.end();++it) {
     it->second->removeMeFromGrid();
@@ -192,6 +193,7 @@ void PBlock::DeactivateBlock(PBlock *block, PBlock *from) {
 
 void PBlock::ActivateBlock(PBlock *block, PBlock *from) {
   block->m_isOn = true;
+  PBond::TopologyChanged();
   for(HASH_MAP_STR(PAtom *)::iterator it=block->m_atoms.begin();it!=block->m_atoms.end();++it) {
     it->second->insertMeIntoGrid();
   }
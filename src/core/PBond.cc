@@ -21,6 +21,7 @@
 #include "PExtension.h"
 #include "PResources.h"
 #include "PTools.h"
+#include <math3d/transformpoints.h>
 
 using namespace std;
 
@@ -40,6 +41,32 @@ void Rotater::rotateAtom_nonGridUpdate(PAtom* atom) {
 	atom->changePosition_nonGridUpdate(rotMat*currPos+origin);
 }
 
+void Rotater::rotateAtoms_nonGridUpdate(const vector<PAtom*>& atoms) {
+	//NOTE: The coordinates are rotated in blocks on the stack, so that threads rotating their own chains share no scratch.
+	const int BLOCK_SIZE = 256;
+	Real x[BLOCK_SIZE], y[BLOCK_SIZE], z[BLOCK_SIZE];
+	RigidTransform transform(rotMat, origin);
+	for (int start = 0; start < atoms.size(); start += BLOCK_SIZE) {
+		int n = min((int) atoms.size() - start, BLOCK_SIZE);
+		for (int i = 0; i < n; i++) {
+			const Vector3 &pos = atoms[start + i]->getPos();
+			x[i] = pos.x - origin.x;
+			y[i] = pos.y - origin.y;
+			z[i] = pos.z - origin.z;
+		}
+		//rotMat*currPos+origin, as in rotateAtom_nonGridUpdate(), with the same rounding.
+		TransformPoints(transform, x, y, z, x, y, z, n);
+		for (int i = 0; i < n; i++) {
+			atoms[start + i]->changePosition_nonGridUpdate(Vector3(x[i], y[i], z[i]));
+		}
+	}
+}
+
+void Rotater::getTransform(RigidTransform& transform) const {
+	transform.R = rotMat;
+	transform.t = origin - rotMat*origin;
+}
+
 
 //struct Rotater: AtomFunctor {
 //public:
@@ -185,11 +212,84 @@ void PBond::Rotate_noGridUpdate(BondDirection dir, float degrees, PChain *chain)
 
 	  Vector3 axis = endV->getPos()-startV->getPos();
 	  Rotater r(startV->getPos(),axis,degrees);
-//	  traverseChain(dir,&r,NULL,chain);
-	  this->traverseChain_noGridUpdate( dir, &r, NULL, chain);
+//	  this->traverseChain_noGridUpdate( dir, &r, NULL, chain);
+	  //NOTE: The moved atoms are cached, so a rotation does not walk the bond graph.
+	  r.rotateAtoms_nonGridUpdate(getMovedAtoms(dir, chain));
 	  return;
 }
 
+unsigned long PBond::s_topologyVersion = 0;
+unsigned long PBond::s_movedAtomsBuilds = 0;
+
+const vector<PAtom *> &PBond::getMovedAtoms(BondDirection dir, PChain *rootChain)
+{
+	  MovedAtoms *entry = NULL;
+	  for (int i = 0; i < m_movedAtoms.size(); i++) {
+		  if (m_movedAtoms[i].dir == dir && m_movedAtoms[i].rootChain == rootChain) {
+			  entry = &m_movedAtoms[i];
+			  break;
+		  }
+	  }
+	  //NOTE: Chains are built and destroyed by every thread, so the version is read once, before the walk.
+	  unsigned long version = __atomic_load_n(&s_topologyVersion, __ATOMIC_RELAXED);
+	  if (entry != NULL && entry->version == version) {
+		  //NOTE: Overlapping subchains take residues from each other, so only the residues the walk
+		  //examined are checked: the list is valid while they are on the same side of rootChain.
+		  bool valid = true;
+		  for (int i = 0; valid && i < entry->residues.size(); i++) {
+			  valid = entry->residues[i]->getChain()->IsSubChainOf(rootChain) == entry->inside[i];
+		  }
+		  if (valid) {
+			  return entry->atoms;
+		  }
+	  }
+	  if (entry == NULL) {
+		  m_movedAtoms.push_back(MovedAtoms());
+		  entry = &m_movedAtoms.back();
+		  entry->dir = dir;
+		  entry->rootChain = rootChain;
+	  }
+
+	  //Same walk as traverseChain_noGridUpdate, without recursion. The atom behind the bond
+	  //is the origin of the rotation and does not move.
+	  pair<PAtom *, PAtom *> atom_pair = getAtomPair(dir);
+	  AtomSet atomsTraversed;
+	  atomsTraversed.insert(atom_pair.first);
+	  vector<PAtom *> stack(1, atom_pair.second);
+	  entry->atoms.clear();
+	  entry->residues.clear();
+	  entry->inside.clear();
+	  while (!stack.empty()) {
+		  PAtom *atom = stack.back();
+		  stack.pop_back();
+		  if (atomsTraversed.find(atom) != atomsTraversed.end()) {
+			  continue;
+		  }
+		  PResidue *residue = atom->getParentResidue();
+		  bool inside = residue->getChain()->IsSubChainOf(rootChain);
+		  if (find(entry->residues.begin(), entry->residues.end(), residue) == entry->residues.end()) {
+			  entry->residues.push_back(residue);
+			  entry->inside.push_back(inside);
+		  }
+		  if (!atom->WithinActiveBlock() || !inside) {
+			  continue;
+		  }
+		  atomsTraversed.insert(atom);
+		  entry->atoms.push_back(atom);
+		  for (unsigned i = 0; i < atom->m_bonds.size(); i++) {
+			  PAtom *atom1 = atom->m_bonds[i]->getAtom1();
+			  PAtom *atom2 = atom->m_bonds[i]->getAtom2();
+			  stack.push_back(atom1 != atom ? atom1 : atom2);
+		  }
+	  }
+	  //The rotation is independent of the order; keep the atoms in address order for locality.
+	  sort(entry->atoms.begin(), entry->atoms.end());
+	  entry->version = version;
+	  //NOTE: Lists are built by every thread that rotates its own chains.
+	  __sync_fetch_and_add(&s_movedAtomsBuilds, 1);
+	  return entry->atoms;
+}
+
 Rotater* PBond::getBondRotater(BondDirection dir, float degrees) {
 	  assert(isDOF());
 	  PAtom *startV;
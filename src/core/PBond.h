@@ -30,6 +30,12 @@ public:
 
   void rotateAtom_nonGridUpdate( PAtom* atom);
 
+  /* Same as rotateAtom_nonGridUpdate() for every atom, rotated as one block of coordinates. */
+  void rotateAtoms_nonGridUpdate( const vector<PAtom*>& atoms);
+
+  /* The rotation as a rigid transform, x -> R*x + t. */
+  void getTransform( RigidTransform& transform) const;
+
 private:
   Matrix3 rotMat;
   Vector3 origin;
@@ -55,6 +61,7 @@ class PBond {
     m_forwardDirection = NULL;
     a1->m_bonds.push_back(this);
     a2->m_bonds.push_back(this);
+    TopologyChanged();
  }
 
 
@@ -130,6 +137,27 @@ class PBond {
   //Yajia Zhang added this:
   Rotater* getBondRotater( BondDirection dir, float degrees);
   pair< PAtom*, PAtom*> getAtomPair( BondDirection dir);
+
+  /**
+   * Returns the atoms moved by rotating about this bond in the
+   * specified direction, limited to rootChain: the atoms that
+   * traverseChain visits, excluding the atom behind the bond.
+   * The list is cached; it is rebuilt after TopologyChanged() or when a
+   * residue it reached is attached to or detached from rootChain.
+   */
+  const vector<PAtom *> &getMovedAtoms(BondDirection dir, PChain *rootChain);
+
+  /**
+   * Invalidates the moved atoms of every bond. Called whenever bonds are
+   * created or destroyed, blocks are turned on or off or a chain is destroyed.
+   */
+  static void TopologyChanged() { __sync_fetch_and_add(&s_topologyVersion, 1); }
+
+  /**
+   * Number of times a list of moved atoms has been built, so that
+   * anything derived from the lists can tell that they changed.
+   */
+  static unsigned long getMovedAtomsBuilds() { return __atomic_load_n(&s_movedAtomsBuilds, __ATOMIC_RELAXED); }
  private:
 
   /*
@@ -142,6 +170,21 @@ class PBond {
   PAtom *m_atom2;
   PAtom *m_forwardDirection;
   bool m_isDOF;
+
+  struct MovedAtoms {
+    BondDirection dir;
+    PChain *rootChain;
+    unsigned long version;
+    vector<PAtom *> atoms;
+    //residues the walk examined, and whether they were in rootChain
+    vector<PResidue *> residues;
+    vector<bool> inside;
+  };
+  //one entry per direction and root chain the bond has been rotated in
+  vector<MovedAtoms> m_movedAtoms;
+
+  static unsigned long s_topologyVersion;
+  static unsigned long s_movedAtomsBuilds;
 };
 
 #endif  // __P_BOND_H
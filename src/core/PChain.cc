@@ -21,6 +21,7 @@
 #include "PBasic.h"
 #include "PResources.h"
 #include "PConstants.h"
+#include <math3d/transformpoints.h>
 /*I changed here!*/
 #include <memory>
 using namespace std;
@@ -48,6 +49,7 @@ PChain::PChain(const string &firstResidueName) {
 }
 
 PChain::~PChain() {
+  PBond::TopologyChanged();
   list<PChain *> ch_copy = m_children;
 
   for (list<PChain *>::iterator it = ch_copy.begin(); it!=ch_copy.end();++it) {
@@ -309,7 +311,6 @@ void PChain::MultiRotate_noGridUpdate(vector<ChainMove> &moves)
 		}
 		vector<PBond*> &dofs = GetDOFs( blockType);
 
-		vector<AtomSet*> atom_sets;
 		for( int i = 0; i < moves.size(); i++)
 		{
 			int DOF_index = moves[i].DOF_index;
@@ -317,32 +318,197 @@ void PChain::MultiRotate_noGridUpdate(vector<ChainMove> &moves)
 			{
 				PUtilities::AbortProgram(PUtilities::toStr(DOF_index) + ": Invalid index into dofs for block type: " + blockType + ".");
 			}
-			PBond* bond = dofs[ DOF_index];
-			pair< PAtom*, PAtom*> atom_pair = bond->getAtomPair( dir);
-			atom_sets.push_back( atom_pair.first->internalTraverse( atom_pair, this));
 		}
 
-		for( int i = 0; i < atom_sets.size(); i++)
+		if( moves.size() > 64)
 		{
-			AtomSet* atomset = atom_sets[i];
-			int DOF_index = moves[i].DOF_index;
-			PBond* bond = dofs[ DOF_index];
-			Rotater* rotater = bond->getBondRotater( dir, moves[i].degrees);
-			for( AtomSet::iterator it = atomset->begin(); it != atomset->end(); it++)
+			//NOTE: Too many moves for the segment masks, rotate one DOF after the other.
+			for( int i = 0; i < moves.size(); i++)
+			{
+				dofs[ moves[i].DOF_index]->Rotate_noGridUpdate( dir, moves[i].degrees, this);
+			}
+			return;
+		}
+
+		//NOTE: Validate the moved atoms of every DOF first; the plan is stale if any of them is rebuilt.
+		for( int i = 0; i < moves.size(); i++)
+		{
+			dofs[ moves[i].DOF_index]->getMovedAtoms( dir, this);
+		}
+		MultiRotatePlan &plan = m_multiRotate;
+		bool planned = plan.builds == PBond::getMovedAtomsBuilds() && plan.dir == dir && plan.dofs.size() == moves.size();
+		for( int i = 0; planned && i < moves.size(); i++)
+		{
+			planned = plan.dofs[i] == dofs[ moves[i].DOF_index];
+		}
+		if( !planned)
+		{
+			vector<PBond*> bonds;
+			for( int i = 0; i < moves.size(); i++)
 			{
-				rotater->rotateAtom_nonGridUpdate( *it);
+				bonds.push_back( dofs[ moves[i].DOF_index]);
 			}
-			delete rotater;
+			PlanMultiRotate( bonds, dir);
 		}
 
-		for( int i = 0; i < atom_sets.size(); i++)
+		//NOTE: The axis of every move is taken at the positions left by the previous moves, as if the moves were
+		//applied one after the other.
+		RigidTransform move;
+		for( int i = 0; i < moves.size(); i++)
+		{
+			pair<PAtom*, PAtom*> atom_pair = plan.dofs[i]->getAtomPair( dir);
+			Vector3 start = atom_pair.first->getPos();
+			Vector3 end = atom_pair.second->getPos();
+			if( plan.startSlot[i] >= 0)
+			{
+				plan.transforms[ plan.startSlot[i]].mulPoint( atom_pair.first->getPos(), start);
+			}
+			if( plan.endSlot[i] >= 0)
+			{
+				plan.transforms[ plan.endSlot[i]].mulPoint( atom_pair.second->getPos(), end);
+			}
+			Rotater rotater( start, end - start, moves[i].degrees);
+			rotater.getTransform( move);
+			for( int k = plan.moveStart[i]; k < plan.moveStart[i + 1]; k++)
+			{
+				plan.transforms[ plan.composeInto[k]].compose( move, plan.transforms[ plan.composeFrom[k]]);
+			}
+		}
+
+		int num_atoms = plan.atoms.size();
+		if( num_atoms == 0)
+			return;
+		plan.x.resize( num_atoms);
+		plan.y.resize( num_atoms);
+		plan.z.resize( num_atoms);
+		for( int k = 0; k < num_atoms; k++)
+		{
+			const Vector3 &pos = plan.atoms[k]->getPos();
+			plan.x[k] = pos.x;
+			plan.y[k] = pos.y;
+			plan.z[k] = pos.z;
+		}
+		int num_segments = plan.segmentSlot.size();
+		for( int s = 0; s < num_segments; s++)
 		{
-			delete atom_sets[i];
+			int begin = plan.segmentStart[s];
+			TransformPoints( plan.transforms[ plan.segmentSlot[s]], &plan.x[ begin], &plan.y[ begin], &plan.z[ begin],
+					&plan.x[ begin], &plan.y[ begin], &plan.z[ begin], plan.segmentStart[s + 1] - begin);
+		}
+		for( int k = 0; k < num_atoms; k++)
+		{
+			plan.atoms[k]->changePosition_nonGridUpdate( Vector3( plan.x[k], plan.y[k], plan.z[k]));
 		}
 		return;
 }
 
 
+static bool LessMoves(const pair<PAtom*, uint64_t> &a, const pair<PAtom*, uint64_t> &b)
+{
+	return a.second < b.second;
+}
+
+/*
+ * Group the atoms moved by the bonds into segments moved by the same bonds.
+ */
+void PChain::PlanMultiRotate(const vector<PBond*> &dofs, BondDirection dir)
+{
+	MultiRotatePlan &plan = m_multiRotate;
+	//Atoms and the moves that move them, merged from the moved atoms of every bond, which are in address order.
+	vector< pair<PAtom*, uint64_t> > moved;
+	for( int i = 0; i < dofs.size(); i++)
+	{
+		const vector<PAtom*> &atoms = dofs[i]->getMovedAtoms( dir, this);
+		for( int k = 0; k < atoms.size(); k++)
+		{
+			moved.push_back( make_pair( atoms[k], (uint64_t)1 << i));
+		}
+	}
+	sort( moved.begin(), moved.end());
+	int n = 0;
+	for( int k = 0; k < moved.size(); k++)
+	{
+		if( n > 0 && moved[n - 1].first == moved[k].first)
+			moved[n - 1].second |= moved[k].second;
+		else
+			moved[n++] = moved[k];
+	}
+	moved.resize( n);
+
+	vector< pair<PAtom*, uint64_t> > segments( moved);
+	stable_sort( segments.begin(), segments.end(), LessMoves);
+	vector<uint64_t> segmentMoves;
+	plan.atoms.clear();
+	plan.segmentStart.clear();
+	for( int k = 0; k < segments.size(); k++)
+	{
+		if( k == 0 || segments[k].second != segments[k - 1].second)
+		{
+			plan.segmentStart.push_back( k);
+			segmentMoves.push_back( segments[k].second);
+		}
+		plan.atoms.push_back( segments[k].first);
+	}
+	plan.segmentStart.push_back( segments.size());
+
+	vector<int> startSegment, endSegment;
+	for( int i = 0; i < dofs.size(); i++)
+	{
+		pair<PAtom*, PAtom*> atom_pair = dofs[i]->getAtomPair( dir);
+		PAtom* ends[2] = { atom_pair.first, atom_pair.second};
+		for( int e = 0; e < 2; e++)
+		{
+			int segment = -1;
+			vector< pair<PAtom*, uint64_t> >::iterator it = lower_bound( moved.begin(), moved.end(), make_pair( ends[e], (uint64_t)0));
+			if( it != moved.end() && it->first == ends[e])
+			{
+				segment = find( segmentMoves.begin(), segmentMoves.end(), it->second) - segmentMoves.begin();
+			}
+			(e == 0 ? startSegment : endSegment).push_back( segment);
+		}
+	}
+
+	//Slot 0 is the identity. Before move i, segments share a slot if the same moves before i move them;
+	//the move splits off a new slot from every slot of the segments it moves. Along a chain the moved atoms
+	//of the DOFs are nested, so every move composes one transform.
+	int num_segments = segmentMoves.size();
+	plan.segmentSlot.assign( num_segments, 0);
+	plan.moveStart.clear();
+	plan.composeInto.clear();
+	plan.composeFrom.clear();
+	plan.startSlot.clear();
+	plan.endSlot.clear();
+	int num_slots = 1;
+	for( int i = 0; i < dofs.size(); i++)
+	{
+		plan.moveStart.push_back( plan.composeInto.size());
+		plan.startSlot.push_back( startSegment[i] >= 0 ? plan.segmentSlot[ startSegment[i]] : -1);
+		plan.endSlot.push_back( endSegment[i] >= 0 ? plan.segmentSlot[ endSegment[i]] : -1);
+		int first = plan.composeInto.size();
+		for( int s = 0; s < num_segments; s++)
+		{
+			if( !(segmentMoves[s] & ((uint64_t)1 << i)))
+				continue;
+			int k = first;
+			while( k < plan.composeFrom.size() && plan.composeFrom[k] != plan.segmentSlot[s])
+				k++;
+			if( k == plan.composeFrom.size())
+			{
+				plan.composeInto.push_back( num_slots++);
+				plan.composeFrom.push_back( plan.segmentSlot[s]);
+			}
+			plan.segmentSlot[s] = plan.composeInto[k];
+		}
+	}
+	plan.moveStart.push_back( plan.composeInto.size());
+	plan.transforms.resize( num_slots);
+	plan.transforms[0].setIdentity();
+
+	plan.dofs = dofs;
+	plan.dir = dir;
+	plan.builds = PBond::getMovedAtomsBuilds();
+}
+
 void PChain::updateAtomsGrid()
 {
 	int residue_size = this->size();
@@ -468,7 +634,7 @@ void PChain::RandomizeDOFs(BondDirection dir)
     vector<PBond *>& dofs = GetDOFs(it->first);
 
     for (unsigned i = 0; i < dofs.size(); i++) {
-      RotateChain(it->first, i, dir, rand() % 360);
+      RotateChain(it->first, i, dir, PRandom::local().nextInt(360));
     }
   }
 }
@@ -656,30 +822,37 @@ PChainState* PChain::savePartialChainState(int index_start, int index_end) {
 	state->index_end = index_end;
 	for( int i = index_start; i <= index_end; i++)
 	{
-		PResidue* residue = this->getResidue(i);
-		vector<PAtom*>* atoms = residue->getAtoms();
-		vector<Vector3> atom_pos;
+		vector<PAtom*>* atoms = this->getResidue(i)->getAtoms();
 		for( int j = 0; j < atoms->size(); j++)
 		{
-			PAtom* atom = (*atoms)[j];
-			atom_pos.push_back( atom->getPos());
+			state->atoms_pos.push_back( (*atoms)[j]->getPos());
 		}
-		state->atoms_pos.push_back( atom_pos);
 	}
 	return state;
 }
 
+void PChain::saveChainState( PChainState* state)
+{
+	assert( state != NULL);
+	state->atoms_pos.clear();
+	state->startRecording();
+}
+
 void PChain::restoreChainState( PChainState* state)
 {
 	assert( state != NULL);
+	if( state->undo)
+	{
+		state->restore( true);
+		return;
+	}
+	int k = 0;
 	for( int i = state->index_start; i <= state->index_end; i++)
 	{
-		PResidue* residue = this->getResidue(i);
-		vector<PAtom*>* atoms = residue->getAtoms();
+		vector<PAtom*>* atoms = this->getResidue(i)->getAtoms();
 		for( int j = 0; j < atoms->size(); j++)
 		{
-			PAtom* atom = (*atoms)[j];
-			atom->changePosition( state->atoms_pos[ i - state->index_start][j]);
+			(*atoms)[j]->changePosition( state->atoms_pos[k++]);
 		}
 	}
 	return;
@@ -688,14 +861,18 @@ void PChain::restoreChainState( PChainState* state)
 void PChain::restoreChainState_noGridUpdate( PChainState* state)
 {
 	assert( state != NULL);
+	if( state->undo)
+	{
+		state->restore( false);
+		return;
+	}
+	int k = 0;
 	for( int i = state->index_start; i <= state->index_end; i++)
 	{
-		PResidue* residue = this->getResidue(i);
-		vector<PAtom*>* atoms = residue->getAtoms();
+		vector<PAtom*>* atoms = this->getResidue(i)->getAtoms();
 		for( int j = 0; j < atoms->size(); j++)
 		{
-			PAtom* atom = (*atoms)[j];
-			atom->changePosition_nonGridUpdate( state->atoms_pos[ i - state->index_start][j]);
+			(*atoms)[j]->changePosition_nonGridUpdate( state->atoms_pos[k++]);
 		}
 	}
 	return;
@@ -834,9 +1011,14 @@ void PChain::detachResidue(int index) {
 //}
 
 DihedralAngle* PChain::getDihedralAngleAtResidue(int index_local) {
+	DihedralAngle* pair = new DihedralAngle();
+	this->getDihedralAngleAtResidue( index_local, *pair);
+	return pair;
+}
+
+void PChain::getDihedralAngleAtResidue(int index_local, DihedralAngle& pair) {
 	//TODO: Should add some error checking mechanism.
 	assert( this == this->getTopLevelChain() || this->m_parentChain == this->getTopLevelChain());
-	DihedralAngle* pair = new DihedralAngle();
 
 	PChain* chain_toplevel = this;
 	int index = index_local;
@@ -847,7 +1029,31 @@ DihedralAngle* PChain::getDihedralAngleAtResidue(int index_local) {
 		index = index + this->m_startIndex;
 	}
 
-    int residue_size = chain_toplevel->size();
+	//Phi and psi depend on the atoms of the residue and of its neighbours; move counts only grow,
+	//so the sum of the three counts changes as soon as one of them moves.
+	int residue_size = chain_toplevel->size();
+	vector<uint64_t>& moves = chain_toplevel->m_dihedralMoves;
+	if( moves.size() != residue_size)
+	{
+		chain_toplevel->m_dihedralCache.resize( residue_size);
+		moves.assign( residue_size, (uint64_t)-1);
+	}
+	uint64_t count = chain_toplevel->getResidue(index)->getMoves();
+	if( index > 0)
+		count += chain_toplevel->getResidue(index - 1)->getMoves();
+	if( index < residue_size - 1)
+		count += chain_toplevel->getResidue(index + 1)->getMoves();
+	if( moves[index] != count)
+	{
+		chain_toplevel->computeDihedralAngleAtResidue( index, chain_toplevel->m_dihedralCache[index]);
+		moves[index] = count;
+	}
+	pair = chain_toplevel->m_dihedralCache[index];
+}
+
+void PChain::computeDihedralAngleAtResidue(int index, DihedralAngle& pair) {
+	PChain* chain_toplevel = this;
+	int residue_size = chain_toplevel->size();
 	Vector3 b1;
 	Vector3 b2;
 	Vector3 b3;
@@ -871,8 +1077,8 @@ DihedralAngle* PChain::getDihedralAngleAtResidue(int index_local) {
 		double phi_radian = atan2(b2.norm() * b1.dot(cross(b2, b3)), cross(b1, b2).dot(cross(b2, b3)));
 		double psi_radian = atan2(b3.norm() * b2.dot(cross(b3, b4)), cross(b2, b3).dot(cross(b3, b4)));
 
-		pair->phi = phi_radian / PI * 180.0;
-		pair->psi = psi_radian / PI * 180.0;
+		pair.phi = phi_radian / PI * 180.0;
+		pair.psi = psi_radian / PI * 180.0;
 //		pair->residue_name = residue->getName();
 	}
 	else if (index == 0) {
@@ -888,9 +1094,9 @@ DihedralAngle* PChain::getDihedralAngleAtResidue(int index_local) {
 		b4.set(N_next - C);
 		double psi_radian = atan2(b3.norm() * b2.dot(cross(b3, b4)), cross(b2, b3).dot(cross(b3, b4)));
 		//NOTE: change for sidechains
-		pair->phi = 360.0;
-//		pair->phi = 180.0;
-		pair->psi = psi_radian / PI * 180.0;
+		pair.phi = 360.0;
+//		pair.phi = 180.0;
+		pair.psi = psi_radian / PI * 180.0;
 //		pair->residue_name = residue->getName();
 	}
 	else if (index == (residue_size - 1)) {
@@ -905,22 +1111,22 @@ DihedralAngle* PChain::getDihedralAngleAtResidue(int index_local) {
 		b2.set(Ca - N);
 		b3.set(C - Ca);
 		double phi_radian = atan2(b2.norm() * b1.dot(cross(b2, b3)), cross(b1, b2).dot(cross(b2, b3)));
-		pair->phi = phi_radian / PI * 180.0;
-		pair->psi = 360;
-//		pair->psi = 180.0;
+		pair.phi = phi_radian / PI * 180.0;
+		pair.psi = 360;
+//		pair.psi = 180.0;
 //		pair->residue_name = residue->getName();
 	}
 	else {
 		PUtilities::AbortProgram("Something Wrong Here!");
 	}
-	return pair;
 }
 
 void PChain::getDihedralAngles(vector<DihedralAngle>& angles)
 {
+	angles.resize( this->size());
 	for( int i = 0; i < this->size(); i++)
 	{
-		angles.push_back( *this->getDihedralAngleAtResidue(i));
+		this->getDihedralAngleAtResidue( i, angles[i]);
 	}
 	return;
 }
@@ -928,9 +1134,11 @@ void PChain::getDihedralAngles(vector<DihedralAngle>& angles)
 
 
 void PChain::printDihedralAngles() {
+	DihedralAngle da;
 	for( int i = 0; i < this->size(); i++)
 	{
-		cout << this->getDihedralAngleAtResidue(i)->phi << "\t" << this->getDihedralAngleAtResidue(i)->psi << endl;
+		this->getDihedralAngleAtResidue( i, da);
+		cout << da.phi << "\t" << da.psi << endl;
 	}
 	return;
 }
@@ -359,6 +359,7 @@ class PChain: public PLightChain {
 
   /**
    * @brief (Yajia Zhang added) Do similar work as MultiRotate but only virtually change the atom position without changing the atom grid map.
+   * The rotations of the moves are composed, so every moved atom is transformed once.
    * @param moves
    */
   void MultiRotate_noGridUpdate(vector<ChainMove> &moves);
@@ -539,6 +540,9 @@ class PChain: public PLightChain {
   /*NOTE: Start my code here!*/
   PChainState* savePartialChainState( int index_start, int index_end);
   PChainState* saveChainState();
+  //NOTE: Save into a reusable undo log and record the atoms moved from now on, see PChainState.
+  //Restoring the log rewinds only the moved atoms and keeps recording until state->stopRecording().
+  void saveChainState( PChainState* state);
   void restoreChainState( PChainState* state);
   void restoreChainState_noGridUpdate( PChainState* state);
 
@@ -555,7 +559,12 @@ class PChain: public PLightChain {
   bool areResiduesFullyControl();
 
   void getBackbonePositions( vector<Vector3>& positions);
+  //NOTE: The caller owns the returned angle.
   DihedralAngle* getDihedralAngleAtResidue( int index);
+  //NOTE: Same as above without allocation; an undefined phi or psi is set to 360.
+  //The angles are cached by the top level chain until an atom of the residue or of its neighbours moves.
+  void getDihedralAngleAtResidue( int index, DihedralAngle& pair);
+  //NOTE: Resize angles to the chain and set the angles of every residue.
   void getDihedralAngles( vector<DihedralAngle>& angles);
   /*NOTE: End my code here!*/
 
@@ -573,6 +582,7 @@ class PChain: public PLightChain {
 
  private:
   void updateDihedralAngles_subchain( PChain* child);
+  void computeDihedralAngleAtResidue( int index, DihedralAngle& pair);
   void UpdateIndexRangeOnAdd(int amtAdded);
   void InitChain();
   void CheckFinalized() const;
@@ -597,6 +607,35 @@ class PChain: public PLightChain {
   DOF_Cache m_dofs;		/* Map of block types to DOF's of that type. */
   Atom_Cache m_atomCache;
 
+  /* Dihedral angles of every residue of a top level chain, and the sum of the
+   * move counts of the residue and its neighbours they were computed at. */
+  vector<DihedralAngle> m_dihedralCache;
+  vector<uint64_t> m_dihedralMoves;
+
+  /* Atoms moved by the last MultiRotate_noGridUpdate, grouped into segments
+   * moved by the same set of DOFs. Kept until the DOFs change or a list of
+   * moved atoms is rebuilt (see PBond::getMovedAtoms). */
+  struct MultiRotatePlan {
+    MultiRotatePlan() : dir(forward), builds(0) {}
+    vector<PBond *> dofs;
+    BondDirection dir;
+    unsigned long builds;
+    vector<PAtom *> atoms;           /* atoms of segment s: [segmentStart[s], segmentStart[s+1]) */
+    vector<int> segmentStart;
+    vector<int> segmentSlot;         /* transform of segment s after all moves */
+    /* Move i composes transforms[composeInto[k]] = move * transforms[composeFrom[k]] for
+     * k in [moveStart[i], moveStart[i+1]); segments moved by the same moves so far share a slot. */
+    vector<int> moveStart;
+    vector<int> composeInto;
+    vector<int> composeFrom;
+    vector<int> startSlot;           /* slot of the two atoms of the bond of every move, -1 if unmoved */
+    vector<int> endSlot;
+    vector<RigidTransform> transforms;
+    vector<Real> x, y, z;            /* coordinates of the atoms, transformed a segment at a time */
+  };
+  MultiRotatePlan m_multiRotate;
+  void PlanMultiRotate(const vector<PBond *> &dofs, BondDirection dir);
+
   /* Collision-detection helper methods. */
 
   bool InCollision(int resIndex1, int resIndex2, CollisionType type);
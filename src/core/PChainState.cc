@@ -6,18 +6,77 @@
  */
 
 #include "PChainState.h"
+#include "PAtom.h"
+#include <assert.h>
 
-PChainState::PChainState() {
-	// TODO Auto-generated constructor stub
+__thread PChainState* PChainState::recording = NULL;
+
+/*
+ * Epochs are never reused, so an atom stamped by an earlier log is recorded again.
+ */
+static uint64_t nextEpoch = 1;
 
+PChainState::PChainState() {
+	this->index_start = 0;
+	this->index_end = -1;
+	this->undo = false;
+	this->epoch = 0;
 }
 
 PChainState::~PChainState() {
-	// TODO Auto-generated destructor stub
+	this->stopRecording();
 }
 
 void PChainState::clean() {
+	this->stopRecording();
 	this->atoms_pos.clear();
+	this->undo_atoms.clear();
+	this->undo_pos.clear();
+}
+
+void PChainState::stopRecording() {
+	if( recording == this)
+		recording = NULL;
 }
 
+bool PChainState::isRecording() const {
+	return recording == this;
+}
 
+int PChainState::getNumRecorded() const {
+	return this->undo_atoms.size();
+}
+
+void PChainState::startRecording() {
+	assert( recording == NULL || recording == this);
+	this->undo = true;
+	this->undo_atoms.clear();
+	this->undo_pos.clear();
+	this->epoch = __sync_fetch_and_add( &nextEpoch, 1);
+	recording = this;
+}
+
+void PChainState::add(PAtom* atom) {
+	if( atom->m_undoEpoch == this->epoch)
+		return;
+	atom->m_undoEpoch = this->epoch;
+	this->undo_atoms.push_back( atom);
+	this->undo_pos.push_back( atom->getPos());
+}
+
+void PChainState::restore(bool updateGrid) {
+	//Every atom is recorded once, so the order of restoring does not matter. The restored atoms are already stamped.
+	for( int k = 0; k < this->undo_atoms.size(); k++) {
+		if( updateGrid)
+			this->undo_atoms[k]->changePosition( this->undo_pos[k]);
+		else
+			this->undo_atoms[k]->changePosition_nonGridUpdate( this->undo_pos[k]);
+	}
+	//The chain is back in the saved state; keep recording the next move against it.
+	if( recording == this)
+		this->startRecording();
+	else {
+		this->undo_atoms.clear();
+		this->undo_pos.clear();
+	}
+}
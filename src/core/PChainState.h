@@ -9,20 +9,65 @@
 #define PCHAINSTATE_H_
 
 #include <vector.h>
+#include <stdint.h>
 #include <math3d/primitives.h>
 using namespace Math3D;
 
+class PAtom;
+
+/*
+ * Atom positions of a chain saved before a move, to be restored if the move is rejected. A state is either
+ *  - a snapshot of all atoms of a range of residues, see PChain::saveChainState() and PChain::savePartialChainState(), or
+ *  - an undo log, see PChain::saveChainState( state): while the log records, the first change of every atom position
+ *    keeps the previous position, so restoring costs only the atoms moved since. The buffers of a log are kept,
+ *    therefore a log reused for every move allocates nothing once they have grown.
+ * Only one undo log records at a time in a thread.
+ */
 class PChainState {
 	friend class PChain;
 public:
 	PChainState();
 	virtual ~PChainState();
 	void clean();
+
+	/*
+	 * Stop recording changes into the undo log. The log can be saved again for the next move.
+	 */
+	void stopRecording();
+
+	bool isRecording() const;
+
+	/*
+	 * Number of atoms moved since the undo log was saved or last restored.
+	 */
+	int getNumRecorded() const;
+
+	/*
+	 * Called by PAtom before its position changes.
+	 */
+	static inline void record( PAtom* atom) {
+		if( recording != NULL)
+			recording->add( atom);
+	}
+
 private:
+	void add( PAtom* atom);
+	void startRecording();
+	void restore( bool updateGrid);
+
 	//The local residue index in a specific chain
 	int index_start;
 	int index_end;
-	vector<vector<Vector3> > atoms_pos;
+	//Snapshot: positions of the atoms of residues index_start to index_end, residue by residue
+	vector<Vector3> atoms_pos;
+
+	//Undo log: moved atoms and their saved positions. An atom is recorded once per epoch, see PAtom::m_undoEpoch.
+	bool undo;
+	uint64_t epoch;
+	vector<PAtom*> undo_atoms;
+	vector<Vector3> undo_pos;
+
+	static __thread PChainState* recording;
 };
 
 #endif /* PCHAINSTATE_H_ */
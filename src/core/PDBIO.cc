@@ -49,7 +49,6 @@ void PDBIO::writeToFile(PChain *chain, const string &fileName, const string &pre
   HASH_MAP_STR(PAtom*) *curMap;
 
   int curAtomNum = 0;
-  string curLine;
   ofstream outFile(fileName.c_str());
 
   if (chain == NULL) {
@@ -62,30 +61,38 @@ void PDBIO::writeToFile(PChain *chain, const string &fileName, const string &pre
 
     for(HASH_MAP_STR(PAtom *)::const_iterator it = curMap->begin(); it != curMap->end(); ++it) {
       curAtomNum++;
-      curLine = "ATOM  ";
-
-      addAtomNum(curLine, curAtomNum, prefix.length());
-      addAtomName(curLine, it->first, prefix.length());
-      addResName(curLine, curRes->getName(), prefix.length());
-      addChainID(curLine, 'A', prefix.length());
 
 // Removed by Peggy
 //      addResNum(curLine, i + 1, prefix.length());
 
-      // Added by Peggy
-      addResNum(curLine, curRes->getPdbId(), prefix.length());
-
-      addInsertionCode(curLine, " ", prefix.length());
-      addAtomPos(curLine, it->second->getPos(), prefix.length());
-      addAuxData(curLine, it->second->getOccupancy(), it->second->getTempFactor(), "", prefix.length());
-      addElemName(curLine, it->second->getName(), prefix.length());
-
-      outFile << prefix << curLine << endl;
+      // Added by Peggy: residue number from the PDB file
+      outFile << formatAtomLine(curAtomNum, it->first, curRes->getName(), curRes->getPdbId(),
+				it->second->getPos(), it->second->getOccupancy(), it->second->getTempFactor(),
+				it->second->getName(), prefix) << endl;
     }
   }
   outFile.close();
 }
 
+string PDBIO::formatAtomLine(int atomNum, const string &atomName, const string &resName,
+			     int resNum, const Vector3 &atomPos, Real occupancy, Real tempFactor,
+			     const string &elemName, const string &prefix)
+{
+  string curLine = "ATOM  ";
+
+  addAtomNum(curLine, atomNum, prefix.length());
+  addAtomName(curLine, atomName, prefix.length());
+  addResName(curLine, resName, prefix.length());
+  addChainID(curLine, 'A', prefix.length());
+  addResNum(curLine, resNum, prefix.length());
+  addInsertionCode(curLine, " ", prefix.length());
+  addAtomPos(curLine, atomPos, prefix.length());
+  addAuxData(curLine, occupancy, tempFactor, "", prefix.length());
+  addElemName(curLine, elemName, prefix.length());
+
+  return prefix + curLine;
+}
+
 vector<string> PDBIO::getAllAtomLines(const vector<string> &pdbLines)
 {
   vector<string> atomLines = PUtilities::getLinesStarting(pdbLines, "ATOM  ", "", false, "TER   ");
@@ -65,7 +65,9 @@ int PExactIKSolver::FindSolutions(PProtein *loop, int DOF_indices_to_use[3], Vec
 //  real(dp) :: r_n(3,5), r_a(3,5), r_c(3,5)
   double r_n[5][3], r_a[5][3], r_c[5][3];
 //  real(dp) :: r_soln_n(3,3,max_soln), r_soln_a(3,3,max_soln), r_soln_c(3,3,max_soln)
-  double r_soln_n[max_soln][3][3], r_soln_a[max_soln][3][3], r_soln_c[max_soln][3][3];
+  double r_soln_n[PTripepClosure::max_soln][3][3], r_soln_a[PTripepClosure::max_soln][3][3], r_soln_c[PTripepClosure::max_soln][3][3];
+//  solver context: keeps all closure state local to this call, so FindSolutions is reentrant
+  PTripepClosure closure;
 //  real(dp) :: rmsd, sum, dr(3)
   double rmsd, sum, dr[3];
 //  real(dp) :: r0_n(3,3), r0_a(3,3), r0_c(3,3)
@@ -180,7 +182,7 @@ int PExactIKSolver::FindSolutions(PProtein *loop, int DOF_indices_to_use[3], Vec
   if (t_ang[1] < 0)t_ang[1] = t_ang[1] + PI;
   else t_ang[1] = t_ang[1] - PI;
 
-  initialize_loop_closure(b_len, b_ang, t_ang);
+  closure.initialize_loop_closure(b_len, b_ang, t_ang);
   
   r_n[1][0]=loop->getAtomAtRes(PID::N,DOF_indices_to_use[0])->getPos().x;
   r_n[1][1]=loop->getAtomAtRes(PID::N,DOF_indices_to_use[0])->getPos().y;
@@ -203,7 +205,7 @@ int PExactIKSolver::FindSolutions(PProtein *loop, int DOF_indices_to_use[3], Vec
   //          r_soln_n, r_soln_a, r_soln_c, n_soln)
 
   int solution_selection = -1;
-  solve_3pep_poly(r_n[1], r_a[1], r_a[3], r_c[3], r_soln_n, r_soln_a, r_soln_c, &n_soln, solution_selection);
+  closure.solve_3pep_poly(r_n[1], r_a[1], r_a[3], r_c[3], r_soln_n, r_soln_a, r_soln_c, &n_soln, solution_selection);
   Vector3 temp;
   
   double tang;
@@ -313,7 +315,9 @@ IKSolutions PExactIKSolver::FindSolutions(PProtein *loop, int DOF_indices_to_use
 //  real(dp) :: r_n(3,5), r_a(3,5), r_c(3,5)
   double r_n[5][3], r_a[5][3], r_c[5][3];
 //  real(dp) :: r_soln_n(3,3,max_soln), r_soln_a(3,3,max_soln), r_soln_c(3,3,max_soln)
-  double r_soln_n[max_soln][3][3], r_soln_a[max_soln][3][3], r_soln_c[max_soln][3][3];
+  double r_soln_n[PTripepClosure::max_soln][3][3], r_soln_a[PTripepClosure::max_soln][3][3], r_soln_c[PTripepClosure::max_soln][3][3];
+//  solver context: keeps all closure state local to this call, so FindSolutions is reentrant
+  PTripepClosure closure;
 //  real(dp) :: rmsd, sum, dr(3)
   double rmsd, sum, dr[3];
 //  real(dp) :: r0_n(3,3), r0_a(3,3), r0_c(3,3)
@@ -428,7 +432,7 @@ IKSolutions PExactIKSolver::FindSolutions(PProtein *loop, int DOF_indices_to_use
   if (t_ang[1] < 0)t_ang[1] = t_ang[1] + PI;
   else t_ang[1] = t_ang[1] - PI;
 
-  initialize_loop_closure(b_len, b_ang, t_ang);
+  closure.initialize_loop_closure(b_len, b_ang, t_ang);
 
   r_n[1][0]=loop->getAtomAtRes(PID::N,DOF_indices_to_use[0])->getPos().x;
   r_n[1][1]=loop->getAtomAtRes(PID::N,DOF_indices_to_use[0])->getPos().y;
@@ -451,7 +455,7 @@ IKSolutions PExactIKSolver::FindSolutions(PProtein *loop, int DOF_indices_to_use
   //          r_soln_n, r_soln_a, r_soln_c, n_soln)
 
   int solution_selection = -1;
-  solve_3pep_poly(r_n[1], r_a[1], r_a[3], r_c[3], r_soln_n, r_soln_a, r_soln_c, &n_soln, solution_selection);
+  closure.solve_3pep_poly(r_n[1], r_a[1], r_a[3], r_c[3], r_soln_n, r_soln_a, r_soln_c, &n_soln, solution_selection);
   Vector3 temp;
 
   double tang;
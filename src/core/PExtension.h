@@ -201,6 +201,17 @@ class PDBIO {
 
     static void writeToFile(PChain *chain, const string &fileName, const string &prefix = "");
 
+    /**
+     * Returns one PDB "ATOM" line (without newline) for the specified
+     * atom data, formatted exactly as written by <code>writeToFile</code>.
+     * Allows atom data to be snapshotted and formatted later, e.g.
+     * by a background writer.
+     */
+
+    static string formatAtomLine(int atomNum, const string &atomName, const string &resName,
+				 int resNum, const Vector3 &atomPos, Real occupancy, Real tempFactor,
+				 const string &elemName, const string &prefix = "");
+
     /**
      * Returns <code>true</code> if the PDB file specified by
      * <code>fileName</code> appears to represent a cyclic protein,
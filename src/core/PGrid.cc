@@ -37,18 +37,8 @@ PGrid::PGrid()
 
 void PGrid::addAtom(PAtom *atom)
 {
-  Vector3 gridPos = scaleToGrid(atom->getPos());
-  CollisionMap::iterator found = m_collisionGrid.find(gridPos);
-
   /* Add to the collision grid. */
-  if (found == m_collisionGrid.end()) {
-    AtomSet newSet;
-    newSet.insert(atom);
-    m_collisionGrid[gridPos] = newSet;
-  }
-  else {
-    found->second.insert(atom);
-  }
+  m_collisionGrid[cellKey(scaleToGrid(atom->getPos()))].insert(atom);
 }
 
 void PGrid::removeAtom(PAtom *atom)
@@ -57,8 +47,7 @@ void PGrid::removeAtom(PAtom *atom)
     PUtilities::AbortProgram("Can't remove null atom from the grid!");
   }
 
-  Vector3 gridPos = scaleToGrid(atom->getPos());
-  CollisionMap::iterator found = m_collisionGrid.find(gridPos);
+  CollisionMap::iterator found = m_collisionGrid.find(cellKey(scaleToGrid(atom->getPos())));
   
   if (found == m_collisionGrid.end()) {
     PUtilities::AbortProgram("Didn't find requested atom (" + atom->getName() + " in the grid.");
@@ -66,16 +55,13 @@ void PGrid::removeAtom(PAtom *atom)
 
   /* Remove from the collision grid. */
   found->second.erase(atom);
-  if (found->second.size() == 0) {
-    m_collisionGrid.erase(found);
-  }
 }
 
 void PGrid::changeAtomPos(PAtom* atom, Vector3& gridPos_prev, Vector3& gridPos_curr) {
 	  if (atom == NULL) {
 	    PUtilities::AbortProgram("Can't remove null atom from the grid!");
 	  }
-	  CollisionMap::iterator found = m_collisionGrid.find( gridPos_prev);
+	  CollisionMap::iterator found = m_collisionGrid.find( cellKey( gridPos_prev));
 	  if (found == m_collisionGrid.end()) {
 	    PUtilities::AbortProgram("Didn't find requested atom (" + atom->getName() + ") in the grid.");
 //		PUtilities::AbortProgram("haha");
@@ -83,22 +69,9 @@ void PGrid::changeAtomPos(PAtom* atom, Vector3& gridPos_prev, Vector3& gridPos_c
 	  }
 	  /* Remove from the collision grid. */
 	  found->second.erase(atom);
-	  if (found->second.size() == 0) {
-	    m_collisionGrid.erase(found);
-	  }
-
-	  CollisionMap::iterator found2 = m_collisionGrid.find(gridPos_curr);
 
 	  /* Add to the collision grid. */
-	  if (found2 == m_collisionGrid.end()) {
-	    AtomSet newSet;
-	    newSet.insert(atom);
-	    m_collisionGrid[gridPos_curr] = newSet;
-	  }
-	  else
-	  {
-	    found2->second.insert(atom);
-	  }
+	  m_collisionGrid[ cellKey( gridPos_curr)].insert(atom);
 	  return;
 }
 
@@ -113,6 +86,19 @@ Vector3 PGrid::scaleToGrid(const Vector3 &pos) const
   return Vector3(x, y, z);
 }
 
+CellKey PGrid::cellKey(int x, int y, int z)
+{
+  const CellKey mask = (CellKey(1) << 21) - 1, offset = CellKey(1) << 20;
+  return (((CellKey(x) + offset) & mask) << 42) | (((CellKey(y) + offset) & mask) << 21) | ((CellKey(z) + offset) & mask);
+}
+
+Vector3 PGrid::cellPos(CellKey key)
+{
+  const CellKey mask = (CellKey(1) << 21) - 1;
+  const int offset = 1 << 20;
+  return Vector3(int((key >> 42) & mask) - offset, int((key >> 21) & mask) - offset, int(key & mask) - offset);
+}
+
 void PGrid::updateSide(Real atomRadius)
 {
   int atomDiameter = int(2*atomRadius) + 1;
@@ -128,8 +114,8 @@ void PGrid::setSideLength(int newVal)
 
   /* Gather the set of all atoms currently in the grid. */
   for(CollisionMap::const_iterator i = m_collisionGrid.begin(); i != m_collisionGrid.end(); ++i) {
-    for(AtomSet::const_iterator j = i->second.begin(); j != i->second.end(); ++j) {
-      allAtoms.insert(*j);
+    for(int j = 0; j < i->second.size(); j++) {
+      allAtoms.insert(i->second[j]);
     }
   }
 
@@ -179,65 +165,46 @@ bool PGrid::InAnyCollision(const PAtom *atom) const
 
 PAtom* PGrid::getStaticCollidingAtom(const PAtom *atom) const
 {
-  auto_ptr<AtomSet> collSet(findColliding(atom, true, STATIC));
-
-  if (collSet->size() == 0) {
-    return NULL;
-  } else {
-	AtomSet::iterator it;
-	for (it=collSet->begin(); it!=collSet->end(); ++it) {
-		if ((*it)->isActive())
-			return *it;
-	}
-	return NULL;
-
-  }
+  return findColliding(atom, STATIC, NULL);
 }
 
 PAtom* PGrid::getSelfCollidingAtom(const PAtom *atom) const
 {
-  auto_ptr<AtomSet> collSet(findColliding(atom, true, SELF));
-
-  if (collSet->size() == 0) {
-    return NULL;
-  } else {
-        AtomSet::iterator it;
-        for (it=collSet->begin(); it!=collSet->end(); ++it) {
-                if ((*it)->isActive())
-                        return *it;
-        }
-        return NULL;
-
-  }
+  return findColliding(atom, SELF, NULL);
 }
 
 PAtom* PGrid::getAnyCollidingAtom(const PAtom *atom) const
 {
-  PAtom *a = getStaticCollidingAtom(atom);
-  if (a != NULL) return a;
-
-  return getSelfCollidingAtom(atom);
+  //NOTE: One pass over the neighboring cells instead of one for static and one for self collisions.
+  return findColliding(atom, EITHER, NULL);
 }
 
 AtomSet* PGrid::getAllCollidingStatic(const PAtom *atom) const
 {
-  return findColliding(atom, false, STATIC);
+  AtomSet *s = new AtomSet();
+  findColliding(atom, STATIC, s);
+  return s;
 }
 
 AtomSet* PGrid::getAllCollidingSelf(const PAtom *atom) const
 {
-  return findColliding(atom, false, SELF);
+  AtomSet *s = new AtomSet();
+  findColliding(atom, SELF, s);
+  return s;
 }
 
 AtomSet* PGrid::getAllCollidingEither(const PAtom *atom) const
 {
-  return findColliding(atom, false, EITHER);
+  AtomSet *s = new AtomSet();
+  findColliding(atom, EITHER, s);
+  return s;
 }
 
-AtomSet* PGrid::findColliding(const PAtom *atom, bool getOnlyOne, CollisionType type, CollisionMetric inCollision) const
+PAtom* PGrid::findColliding(const PAtom *atom, CollisionType type, AtomSet *all, CollisionMetric inCollision) const
 {
-	AtomSet *s = new AtomSet();
 	Vector3 centerPos = scaleToGrid(atom->getPos());
+	int x = int(centerPos.x), y = int(centerPos.y), z = int(centerPos.z);
+	PAtom *first = NULL;
 
 	for (int xDelta = -m_delta; xDelta <= m_delta; xDelta++)
 	{
@@ -245,13 +212,13 @@ AtomSet* PGrid::findColliding(const PAtom *atom, bool getOnlyOne, CollisionType
 		{
 			for (int zDelta = -m_delta; zDelta <= m_delta; zDelta++)
 			{
-				Vector3 curPos(centerPos.x + xDelta, centerPos.y + yDelta, centerPos.z + zDelta);
-				CollisionMap::const_iterator found = m_collisionGrid.find(curPos); // Loop atoms in this cell
+				CollisionMap::const_iterator found = m_collisionGrid.find(cellKey(x + xDelta, y + yDelta, z + zDelta)); // Loop atoms in this cell
 				if (found != m_collisionGrid.end())
 				{
-					for (AtomSet::const_iterator it = found->second.begin();it != found->second.end(); ++it)
+					const PGridCell &cell = found->second;
+					for (int i = 0; i < cell.size(); i++)
 					{
-						PAtom *curAtom = *it;
+						PAtom *curAtom = cell[i];
 						if (curAtom->isActive())
 						{
 							if (inCollision(atom, curAtom) &&
@@ -259,9 +226,11 @@ AtomSet* PGrid::findColliding(const PAtom *atom, bool getOnlyOne, CollisionType
 									|| (type == SELF && curAtom->getChain()->IsSubChainOf(atom->getChain()))
 									|| (type == STATIC && !(curAtom->getChain()->IsSubChainOf(atom->getChain())))))
 							{
-								s->insert(curAtom);
-								if (getOnlyOne)
-									return s;
+								if (all == NULL)
+									return curAtom;
+								all->insert(curAtom);
+								if (first == NULL)
+									first = curAtom;
 							}
 						}
 					}
@@ -269,7 +238,7 @@ AtomSet* PGrid::findColliding(const PAtom *atom, bool getOnlyOne, CollisionType
 			}
 		}
 	}
-	return s;
+	return first;
 }
 
 bool PGrid::covalentCollision(const PAtom *a1, const PAtom *a2)
@@ -279,13 +248,12 @@ bool PGrid::covalentCollision(const PAtom *a1, const PAtom *a2)
 
   if (a1 == a2)
 	  return false;
-  if (atomsBonded(a1, a2))
-	  return false;
 
   Real  radiusSum = a1->getCovalentRadius() + a2->getCovalentRadius(),
     centerDist = a1->getPos().distance(a2->getPos());
 
-  return (radiusSum >= centerDist);
+  //NOTE: The distance is checked before the bonds, which are only looked up for atoms close enough.
+  return (radiusSum >= centerDist) && !atomsBonded(a1, a2);
 }
 
 bool PGrid::vanDerWaalsCollision(const PAtom *a1, const PAtom *a2)
@@ -295,13 +263,12 @@ bool PGrid::vanDerWaalsCollision(const PAtom *a1, const PAtom *a2)
 
   if (a1 == a2)
 	  return false;
-  if (PAtom::shortestBondPath(a1, a2, BOND_THRESHOLD + 1) <= BOND_THRESHOLD)
-	  return false;
 
   Real  radiusSum = a1->getVanDerWaalsRadius() + a2->getVanDerWaalsRadius(),
     centerDist = a1->getPos().distance(a2->getPos());
 
-  return (COLLISION_THRESHOLD * radiusSum >= centerDist);
+  //NOTE: The distance is checked before the bond path, whose breadth-first search is only run for atoms close enough.
+  return (COLLISION_THRESHOLD * radiusSum >= centerDist) && PAtom::shortestBondPath(a1, a2, BOND_THRESHOLD + 1) > BOND_THRESHOLD;
 }
 
 /* Occupancy functions. */
@@ -315,12 +282,10 @@ list<PAtom *> PGrid::AtomsNearPoint(const Vector3& point, Real distance) const
   for(int xDelta = -numToSearch; xDelta <= numToSearch; xDelta++) {
     for(int yDelta = -numToSearch; yDelta <= numToSearch; yDelta++) {
       for(int zDelta = -numToSearch; zDelta <= numToSearch; zDelta++) {
-        Vector3 curPos(centerPos.x + xDelta, centerPos.y + yDelta, centerPos.z + zDelta);
-
-        CollisionMap::const_iterator found = m_collisionGrid.find(curPos);  // Loop atoms in this cell
+        CollisionMap::const_iterator found = m_collisionGrid.find(cellKey(int(centerPos.x) + xDelta, int(centerPos.y) + yDelta, int(centerPos.z) + zDelta));  // Loop atoms in this cell
         if (found != m_collisionGrid.end()) {
-          for(AtomSet::const_iterator it = found->second.begin(); it != found->second.end(); ++it) {
-            PAtom *curAtom = *it;
+          for(int i = 0; i < found->second.size(); i++) {
+            PAtom *curAtom = found->second[i];
             if (curAtom->getPos().distance(point) <= distance) {
               returnList.push_back(curAtom);
             }
@@ -350,13 +315,15 @@ pair<Vector3, Vector3> PGrid::getGlobalBoundingBox() const
   /* Iterate through all cells in the grid with atoms defined. Update */
   /* the min/max coordinates of the 8 points of the bounding cube.    */
   for(CollisionMap::const_iterator it = m_collisionGrid.begin(); it != m_collisionGrid.end(); ++it) {
-    if (it->first.x < minX) minX = it->first.x;
-    if (it->first.y < minY) minY = it->first.y;
-    if (it->first.z < minZ) minZ = it->first.z;
-
-    if (it->first.x > maxX) maxX = it->first.x;
-    if (it->first.y > maxY) maxY = it->first.y;
-    if (it->first.z > maxZ) maxZ = it->first.z;
+    if (it->second.size() == 0) continue;
+    Vector3 cell = cellPos(it->first);
+    if (cell.x < minX) minX = cell.x;
+    if (cell.y < minY) minY = cell.y;
+    if (cell.z < minZ) minZ = cell.z;
+
+    if (cell.x > maxX) maxX = cell.x;
+    if (cell.y > maxY) maxY = cell.y;
+    if (cell.z > maxZ) maxZ = cell.z;
   }
 
   /* Return the points; order is important because it's assumed by getOccupancy(). */
@@ -381,10 +348,10 @@ OccupancyMap PGrid::getOccupancy() const
 
   /* For each atom, check occupancy of all its 27 neighboring cells (including its own cell). */
   for(CollisionMap::const_iterator i = m_collisionGrid.begin(); i != m_collisionGrid.end(); ++i) {
-    AtomSet curSet = i->second;
+    const PGridCell &atoms = i->second;
 
-    for(AtomSet::const_iterator j = curSet.begin(); j != curSet.end(); ++j) {
-      curAtom = *j;
+    for(int j = 0; j < atoms.size(); j++) {
+      curAtom = atoms[j];
       curCell = scaleToGrid(curAtom->getPos());
 
       for(int x = -1; x <= 1; x++) {
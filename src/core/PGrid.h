@@ -90,10 +90,11 @@ class PGrid: public PSpaceManager {
   AtomSet* getAllCollidingSelf(const PAtom *atom) const;
   AtomSet* getAllCollidingEither(const PAtom *atom) const;
 
-  AtomSet* findColliding(const PAtom *atom,
-                         bool getOnlyOne,
-                         CollisionType type,
-                         CollisionMetric inCollision = vanDerWaalsCollision) const;
+  /* Returns the first colliding atom, or adds all of them to <code>all</code> if it is not NULL. */
+  PAtom* findColliding(const PAtom *atom,
+                       CollisionType type,
+                       AtomSet *all,
+                       CollisionMetric inCollision = vanDerWaalsCollision) const;
 
   bool InStaticCollision(const PAtom *atom) const;
   bool InSelfCollision(const PAtom *atom) const;
@@ -101,6 +102,11 @@ class PGrid: public PSpaceManager {
 
   Vector3 scaleToGrid(const Vector3 &pos) const;
 
+  /* Packed key of the cell at a grid position, and back. */
+  static CellKey cellKey(int x, int y, int z);
+  static CellKey cellKey(const Vector3 &gridPos) { return cellKey(int(gridPos.x), int(gridPos.y), int(gridPos.z)); }
+  static Vector3 cellPos(CellKey key);
+
   /* Collision metrics. */
   static bool covalentCollision(const PAtom *a1, const PAtom *a2);
   static bool vanDerWaalsCollision(const PAtom *a1, const PAtom *a2);
@@ -114,7 +120,8 @@ class PGrid: public PSpaceManager {
   int m_delta;                      /* How many cells in each x, y, z direction */
                                     /* to search for atom collisions; equal to  */
                                     /* ceil(m_defaultSideLength / m_sideLength. */
-  //NOTE: A hash map: this finds all the atoms in the grid given the grid coordinate.
+  //NOTE: A hash map: this finds all the atoms in the grid given the key of the grid coordinate.
+  //Cells are kept when they become empty, so that atoms moving back and forth do not allocate them again.
   CollisionMap m_collisionGrid;     /* The hash_map at the core of the PGrid. */
 
 };
@@ -24,6 +24,7 @@
 #include <vector>
 #include <ext/hash_set>
 #include <ext/hash_map>
+#include <stdint.h>
 #include <math3d/primitives.h>
 
 using namespace std;
@@ -38,9 +39,9 @@ struct vectorHash  {
   public:
     size_t operator()(const Vector3 &v) const
     {
-      hash<int> intHash;
-      int x = int(v.x) + 101, y = int(v.y) + 201, z = int(v.z) + 301;
-      return intHash(x * y * z);
+      //NOTE: Spatial hash of Teschner et al. (2003); x*y*z collided for every permutation of the coordinates.
+      unsigned int x = int(v.x), y = int(v.y), z = int(v.z);
+      return size_t((x * 73856093u) ^ (y * 19349663u) ^ (z * 83492791u));
     }
 };
                                                                                                                                                              
@@ -117,6 +118,23 @@ struct eqStringPairEither
 
 };
 
+/*
+ * Integer cell coordinates packed into one key, 21 bits each.
+ */
+typedef uint64_t CellKey;
+
+struct cellKeyHash {
+  public:
+    size_t operator()(CellKey key) const
+    {
+      //NOTE: Final mix of MurmurHash3, so that neighboring cells spread over the buckets.
+      key ^= key >> 33;
+      key *= 0xff51afd7ed558ccdULL;
+      key ^= key >> 33;
+      return size_t(key);
+    }
+};
+
 /*
  * Hashing functors.
  */
@@ -163,7 +181,49 @@ typedef hash_set<const Vector3 *, vectorPointerHash, vectorPointerEq> ConstVecto
 
 typedef hash_set<pair<PAtom *, PAtom *>, pairAtomHash, pairAtomEq> AtomCollisions;
 typedef hash_map<pair<PAtom *, PAtom *>, int, pairAtomHash, pairAtomEq> AtomSeparations;
-typedef hash_map<Vector3, AtomSet, vectorHash, vectorEq> CollisionMap;
+/*
+ * Atoms of one cell of a PGrid. The few atoms of a cell are kept inline, so that looking at a cell does not
+ * follow the buckets of a hash_set; more atoms go to a vector.
+ */
+class PGridCell {
+  public:
+    PGridCell() : m_size(0) {}
+
+    int size() const { return m_size; }
+    PAtom *operator[](int i) const { return i < INLINE_ATOMS ? m_inline[i] : m_more[i - INLINE_ATOMS]; }
+
+    void insert(PAtom *atom)
+    {
+      for (int i = 0; i < m_size; i++) {
+        if ((*this)[i] == atom) return;
+      }
+      if (m_size < INLINE_ATOMS) m_inline[m_size] = atom;
+      else m_more.push_back(atom);
+      m_size++;
+    }
+
+    void erase(PAtom *atom)
+    {
+      for (int i = 0; i < m_size; i++) {
+        if ((*this)[i] == atom) {
+          PAtom *last = (*this)[m_size - 1];
+          if (i < INLINE_ATOMS) m_inline[i] = last;
+          else m_more[i - INLINE_ATOMS] = last;
+          if (m_size > INLINE_ATOMS) m_more.pop_back();
+          m_size--;
+          return;
+        }
+      }
+    }
+
+  private:
+    static const int INLINE_ATOMS = 8;
+    PAtom *m_inline[INLINE_ATOMS];
+    vector<PAtom *> m_more;
+    int m_size;
+};
+
+typedef hash_map<CellKey, PGridCell, cellKeyHash> CollisionMap;
 typedef hash_map<Vector3, bool, vectorHash, vectorEq> OccupancyMap;
 
 
@@ -39,7 +39,6 @@ const string residuesFileName = "residues.xml";
 const string rotamersFileName = "rotamers.xml";
 
 void PInit::InitializeResources(const string &resourceDir)  {
-  srand(unsigned(time(NULL)));
   string dir = resourceDir;
   if(resourceDir[resourceDir.size()-1]!='/') {
     dir+='/';
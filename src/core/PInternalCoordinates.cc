@@ -0,0 +1,283 @@
+/*
+ * PInternalCoordinates.cc
+ *
+ *  Created on: Oct 17, 2026
+ */
+
+#include "PInternalCoordinates.h"
+#include "PBasic.h"
+#include "PConstants.h"
+#include <algorithm>
+#include <map>
+#include <math.h>
+
+static const double DEGREE = M_PI / 180;
+
+static inline void sub( const double* a, const double* b, double* out) {
+	out[0] = a[0] - b[0]; out[1] = a[1] - b[1]; out[2] = a[2] - b[2];
+}
+
+static inline double dot( const double* a, const double* b) {
+	return a[0] * b[0] + a[1] * b[1] + a[2] * b[2];
+}
+
+static inline void cross( const double* a, const double* b, double* out) {
+	out[0] = a[1] * b[2] - a[2] * b[1];
+	out[1] = a[2] * b[0] - a[0] * b[2];
+	out[2] = a[0] * b[1] - a[1] * b[0];
+}
+
+static inline void normalize( double* a) {
+	double l = sqrt( dot( a, a));
+	a[0] /= l; a[1] /= l; a[2] /= l;
+}
+
+/*
+ * Frame of the bond b-c: bc along the bond, n normal to the plane a-b-c and m = n x bc.
+ */
+static inline void frame( const double* A, const double* B, const double* C, double* bc, double* m, double* n) {
+	double ab[3];
+	sub( B, A, ab);
+	sub( C, B, bc);
+	normalize( bc);
+	cross( ab, bc, n);
+	normalize( n);
+	cross( n, bc, m);
+}
+
+/*
+ * Order of placement: by residue, then by depth in the tree, then in the order the atoms were reached.
+ */
+struct PlacementOrder {
+	const vector<int>* residue;
+	const vector<int>* depth;
+	const vector<int>* reached;
+	bool operator()( int i, int j) const {
+		if( (*residue)[i] != (*residue)[j])
+			return (*residue)[i] < (*residue)[j];
+		if( (*depth)[i] != (*depth)[j])
+			return (*depth)[i] < (*depth)[j];
+		return (*reached)[i] < (*reached)[j];
+	}
+};
+
+PInternalCoordinates::PInternalCoordinates(PChain* chain) {
+	this->chain = chain;
+	int num_residues = chain->size();
+
+	vector<PAtom*> found;
+	vector<int> found_residue;
+	map<PAtom*, int> index;
+	for( int r = 0; r < num_residues; r++) {
+		vector<PAtom*>* residue_atoms = chain->getResidue(r)->getAtoms();
+		for( int k = 0; k < residue_atoms->size(); k++) {
+			PAtom* atom = (*residue_atoms)[k];
+			if( !atom->WithinActiveBlock())
+				continue;
+			index[atom] = found.size();
+			found.push_back( atom);
+			found_residue.push_back( r);
+		}
+	}
+	int n = found.size();
+
+	PAtom* root = chain->getResidue(0)->getAtom( PID::N);
+	if( root == NULL || index.find( root) == index.end())
+		PUtilities::AbortProgram( "PInternalCoordinates: the first residue has no active N atom.");
+
+	//Depth-first from the root, following the DOFs forward first, so that the atoms a DOF moves are below it
+	//(e.g. the ring of a proline hangs from CA, not from N).
+	vector<int> parent( n, -1), depth( n, -1), reached( n, -1);
+	vector< pair<int, int> > stack( 1, make_pair( index[root], -1));
+	int num_reached = 0;
+	while( !stack.empty()) {
+		int v = stack.back().first;
+		int p = stack.back().second;
+		stack.pop_back();
+		if( depth[v] >= 0)
+			continue;
+		parent[v] = p;
+		depth[v] = p < 0 ? 0 : depth[p] + 1;
+		reached[v] = num_reached++;
+		const vector<PBond*>* bonds = found[v]->getBonds();
+		for( int pass = 0; pass < 2; pass++) {
+			for( int k = 0; k < bonds->size(); k++) {
+				PBond* bond = (*bonds)[k];
+				PAtom* other = bond->getAtom1() == found[v] ? bond->getAtom2() : bond->getAtom1();
+				map<PAtom*, int>::iterator it = index.find( other);
+				if( it == index.end() || depth[it->second] >= 0)
+					continue;
+				bool forward_dof = bond->isDOF() && bond->getAtom( forward) == other;
+				if( forward_dof == (pass == 1))
+					stack.push_back( make_pair( it->second, v));
+			}
+		}
+	}
+	if( num_reached != n)
+		PUtilities::AbortProgram( "PInternalCoordinates: some atoms of the chain are not connected to its first residue.");
+
+	vector<int> order( n);
+	for( int i = 0; i < n; i++) {
+		order[i] = i;
+		if( parent[i] >= 0 && found_residue[ parent[i]] > found_residue[i])
+			PUtilities::AbortProgram( "PInternalCoordinates: an atom is bonded back to an earlier residue.");
+	}
+	PlacementOrder less = { &found_residue, &depth, &reached};
+	sort( order.begin(), order.end(), less);
+	vector<int> placed( n);
+	for( int i = 0; i < n; i++)
+		placed[ order[i]] = i;
+
+	this->atoms.resize( n);
+	this->residue.resize( n);
+	this->ref.assign( 3 * n, -1);
+	this->residue_start.assign( num_residues + 1, n);
+	for( int i = n - 1; i >= 0; i--) {
+		int v = order[i];
+		this->atoms[i] = found[v];
+		this->residue[i] = found_residue[v];
+		this->residue_start[ found_residue[v]] = i;
+		int c = parent[v];
+		int b = c >= 0 ? parent[c] : -1;
+		if( b < 0)
+			continue;
+		int a = parent[b];
+		this->ref[3 * i] = a >= 0 ? placed[a] : n;
+		this->ref[3 * i + 1] = placed[b];
+		this->ref[3 * i + 2] = placed[c];
+	}
+	//Residues without active atoms start where the next residue starts.
+	for( int r = num_residues - 1; r >= 0; r--)
+		this->residue_start[r] = min( this->residue_start[r], this->residue_start[r + 1]);
+
+	this->length.resize( n);
+	this->angle.resize( n);
+	this->torsion.resize( n);
+	this->offset.resize( n);
+	this->pos.resize( 3 * (n + 1));
+	this->readPositions();
+}
+
+void PInternalCoordinates::readPositions() {
+	int n = this->atoms.size();
+	for( int i = 0; i < n; i++) {
+		Vector3 p = this->atoms[i]->getPos();
+		this->pos[3 * i] = p[0];
+		this->pos[3 * i + 1] = p[1];
+		this->pos[3 * i + 2] = p[2];
+	}
+
+	//Reference point of the grandchildren of the root: off the bond from the root to their parent.
+	double* V = &this->pos[3 * n];
+	for( int i = 0; i < n; i++) {
+		if( this->ref[3 * i] != n)
+			continue;
+		const double* B = &this->pos[3 * this->ref[3 * i + 1]];
+		double u[3], e[3] = { 0, 0, 0}, w[3];
+		sub( &this->pos[3 * this->ref[3 * i + 2]], B, u);
+		int axis = 0;
+		for( int k = 1; k < 3; k++)
+			if( fabs( u[k]) < fabs( u[axis]))
+				axis = k;
+		e[axis] = 1;
+		cross( u, e, w);
+		normalize( w);
+		V[0] = B[0] + w[0]; V[1] = B[1] + w[1]; V[2] = B[2] + w[2];
+		break;
+	}
+
+	vector<bool> measured( n, false);
+	for( int i = 0; i < n; i++) {
+		int c = this->ref[3 * i + 2];
+		if( c < 0)
+			continue;
+		const double* A = &this->pos[3 * this->ref[3 * i]];
+		const double* B = &this->pos[3 * this->ref[3 * i + 1]];
+		const double* C = &this->pos[3 * c];
+		const double* D = &this->pos[3 * i];
+		double bc[3], m[3], nn[3], cd[3], cb[3];
+		frame( A, B, C, bc, m, nn);
+		sub( D, C, cd);
+		sub( B, C, cb);
+		this->length[i] = sqrt( dot( cd, cd));
+		this->angle[i] = acos( max( -1.0, min( 1.0, dot( cb, cd) / (sqrt( dot( cb, cb)) * this->length[i]))));
+		double t = atan2( dot( cd, nn), dot( cd, m));
+		if( !measured[c]) {
+			measured[c] = true;
+			this->torsion[c] = t;
+		}
+		this->offset[i] = t - this->torsion[c];
+	}
+	this->first_changed = this->chain->size();
+}
+
+int PInternalCoordinates::getTorsionIndex(const string& blockType, int DOF_index) const {
+	vector<PBond*>& dofs = this->chain->GetDOFs( blockType);
+	if( DOF_index < 0 || DOF_index >= dofs.size())
+		PUtilities::AbortProgram( PUtilities::toStr( DOF_index) + ": Invalid index into dofs for block type: " + blockType + ".");
+	PAtom* front = dofs[ DOF_index]->getAtom( forward);
+	PAtom* back = dofs[ DOF_index]->getAtom( backward);
+	int q = find( this->atoms.begin(), this->atoms.end(), front) - this->atoms.begin();
+	int parent = -1;
+	if( q < this->atoms.size())
+		//The children of the root (atom 0) are not placed and have no references.
+		parent = this->ref[3 * q + 2] >= 0 ? this->ref[3 * q + 2] : (q > 0 ? 0 : -1);
+	if( parent < 0 || this->atoms[ parent] != back)
+		PUtilities::AbortProgram( "PInternalCoordinates: the DOF does not lead away from the first residue.");
+	return q;
+}
+
+double PInternalCoordinates::getTorsion(int index) const {
+	double t = this->torsion[index];
+	return atan2( sin( t), cos( t)) / DEGREE;
+}
+
+void PInternalCoordinates::setTorsion(int index, double degrees) {
+	this->torsion[index] = degrees * DEGREE;
+	this->first_changed = min( this->first_changed, this->residue[index]);
+}
+
+void PInternalCoordinates::rotateTorsion(int index, double degrees) {
+	//A DOF rotation turns the far atoms counterclockwise about the bond, which decreases the torsion.
+	this->torsion[index] -= degrees * DEGREE;
+	this->first_changed = min( this->first_changed, this->residue[index]);
+}
+
+void PInternalCoordinates::rebuild() {
+	int last = this->chain->size() - 1;
+	if( this->first_changed <= last)
+		this->rebuild( this->first_changed, last);
+}
+
+void PInternalCoordinates::rebuild(int start, int end) {
+	assert( start >= 0 && end < this->chain->size() && start <= end);
+	for( int i = this->residue_start[start]; i < this->residue_start[end + 1]; i++) {
+		if( this->ref[3 * i + 2] < 0)
+			continue;
+		this->place( i);
+		const double* D = &this->pos[3 * i];
+		this->atoms[i]->changePosition_nonGridUpdate( Vector3( D[0], D[1], D[2]));
+	}
+	if( start <= this->first_changed && end == this->chain->size() - 1)
+		this->first_changed = this->chain->size();
+}
+
+int PInternalCoordinates::getNumAtoms() const {
+	return this->atoms.size();
+}
+
+void PInternalCoordinates::place(int i) {
+	const double* A = &this->pos[3 * this->ref[3 * i]];
+	const double* B = &this->pos[3 * this->ref[3 * i + 1]];
+	const double* C = &this->pos[3 * this->ref[3 * i + 2]];
+	double bc[3], m[3], n[3];
+	frame( A, B, C, bc, m, n);
+	double t = this->torsion[ this->ref[3 * i + 2]] + this->offset[i];
+	double r = this->length[i];
+	double x = -r * cos( this->angle[i]);
+	double y = r * sin( this->angle[i]) * cos( t);
+	double z = r * sin( this->angle[i]) * sin( t);
+	double* D = &this->pos[3 * i];
+	for( int k = 0; k < 3; k++)
+		D[k] = C[k] + x * bc[k] + y * m[k] + z * n[k];
+}
@@ -0,0 +1,111 @@
+/*
+ * PInternalCoordinates.h
+ *
+ *  Created on: Oct 17, 2026
+ */
+
+#ifndef PINTERNALCOORDINATES_H_
+#define PINTERNALCOORDINATES_H_
+
+#include <vector.h>
+#include <string>
+using namespace std;
+
+class PAtom;
+class PChain;
+
+/*
+ * Internal coordinates of the atoms of a chain, and forward kinematics from them.
+ *
+ * The atoms are arranged in a tree rooted at the N atom of the first residue, following the DOFs of the chain
+ * forward. Every atom is placed from its parent c, grandparent b and great-grandparent a by the bond length c-d,
+ * the bond angle b-c-d and the torsion a-b-c-d (NeRF, Parsons et al. 2005). All children of an atom q turn together
+ * about the bond into q, so their torsions are kept as one torsion per bond plus a fixed offset per child: a DOF
+ * rotation is a change of one number. The root, its children and a fixed reference point for its grandchildren do
+ * not move under forward rotations and are kept as they are.
+ *
+ * Setting many torsions and rebuilding once replaces one rotation of all downstream atoms per DOF. Rebuilding from
+ * the internal coordinates, kept in double precision, also keeps bond lengths and angles exact, whereas millions of
+ * incremental rotations let them drift.
+ *
+ * The atoms are written with PAtom::changePosition_nonGridUpdate(), so undo logs and torsion caches see the change.
+ * Positions changed by other means (e.g. PBond::Rotate_noGridUpdate()) are only seen after readPositions(); the
+ * coordinates must be built again if blocks are turned on or off.
+ */
+class PInternalCoordinates {
+public:
+	/*
+	 * Build the tree of the active atoms of the chain and read their internal coordinates.
+	 */
+	PInternalCoordinates( PChain* chain);
+
+	/*
+	 * Read the internal coordinates from the current atom positions.
+	 */
+	void readPositions();
+
+	/*
+	 * Index of the torsion turned by a forward rotation of a DOF of the chain; look it up once, it is a linear search.
+	 */
+	int getTorsionIndex( const string& blockType, int DOF_index) const;
+
+	/*
+	 * Torsion in degrees, measured at the first atom placed after the bond.
+	 */
+	double getTorsion( int index) const;
+	void setTorsion( int index, double degrees);
+
+	/*
+	 * Same change as PChain::RotateChain_noGridUpdate( blockType, DOF_index, forward, degrees) once rebuilt.
+	 */
+	void rotateTorsion( int index, double degrees);
+
+	/*
+	 * Place the atoms of all residues from the first one with a changed torsion to the end of the chain.
+	 */
+	void rebuild();
+
+	/*
+	 * Place the atoms of residues start to end, from the positions of the atoms before them.
+	 */
+	void rebuild( int start, int end);
+
+	int getNumAtoms() const;
+
+private:
+	/*
+	 * Place atom i from its internal coordinates.
+	 */
+	void place( int i);
+
+	PChain* chain;
+
+	/*
+	 * Atoms by residue, parents before children, and the first atom of every residue (plus the number of atoms).
+	 */
+	vector<PAtom*> atoms;
+	vector<int> residue_start;
+	vector<int> residue;
+
+	/*
+	 * Reference atoms a, b, c of every atom, c the parent; -1 for the root and its children.
+	 * The reference point of the grandchildren of the root is the extra position after the atoms.
+	 */
+	vector<int> ref;
+	vector<double> length;
+	vector<double> angle;
+	/*
+	 * Torsion of atom d: torsion[c] + offset[d], in radians.
+	 */
+	vector<double> torsion;
+	vector<double> offset;
+
+	/*
+	 * Positions of the atoms and the reference point, 3 per atom.
+	 */
+	vector<double> pos;
+
+	int first_changed;
+};
+
+#endif /* PINTERNALCOORDINATES_H_ */
@@ -73,6 +73,7 @@ using namespace Math3D;
  */
 
 #include "PHashing.h"
+#include "PRandom.h"
 #include "PUtilities.h"
 
 #endif
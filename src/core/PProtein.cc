@@ -37,7 +37,7 @@ PProtein::PProtein(int numResidues)
   vector<string> resNames = PResources::getResidueNames();
 
   for(int i = 0; i < numResidues; i++) {
-    curResidue = resNames[rand() % resNames.size()];
+    curResidue = resNames[PRandom::local().nextInt(resNames.size())];
     AddResidue(curResidue);
   }
 
@@ -0,0 +1,185 @@
+/*
+    LoopTK: Protein Loop Kinematic Toolkit
+    Copyright (C) 2007 Stanford University
+
+    This program is free software; you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation; either version 2 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License along
+    with this program; if not, write to the Free Software Foundation, Inc.,
+    51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+*/
+
+#include "PRandom.h"
+#include <math.h>
+#include <pthread.h>
+
+/*
+ * Seed and next unused stream for threads that have not drawn yet.
+ */
+static uint64_t globalSeed = PRandom::DEFAULT_SEED;
+static unsigned int nextStream = 0;
+
+/*
+ * The generator of every thread is created on first use and
+ * deleted by the key destructor when the thread exits.
+ */
+static __thread PRandom *threadRandom = NULL;
+static pthread_key_t threadKey;
+static pthread_once_t threadKeyOnce = PTHREAD_ONCE_INIT;
+
+static void DeleteThreadRandom(void *random)
+{
+  delete (PRandom *) random;
+}
+
+static void CreateThreadKey()
+{
+  pthread_key_create(&threadKey, DeleteThreadRandom);
+}
+
+/*
+ * splitmix64, used to expand a seed into the generator state.
+ */
+static uint64_t SplitMix64(uint64_t &x)
+{
+  uint64_t z = (x += 0x9E3779B97F4A7C15ULL);
+  z = (z ^ (z >> 30)) * 0xBF58476D1CE4E5B9ULL;
+  z = (z ^ (z >> 27)) * 0x94D049BB133111EBULL;
+  return z ^ (z >> 31);
+}
+
+PRandom::PRandom(uint64_t seed, unsigned int stream)
+{
+  this->seed(seed, stream);
+}
+
+void PRandom::seed(uint64_t seed, unsigned int stream)
+{
+  uint64_t x = seed;
+  for (int i = 0; i < 4; i++) {
+    m_state.s[i] = SplitMix64(x);
+  }
+  m_state.spare = 0;
+  m_state.hasSpare = 0;
+  for (unsigned int i = 0; i < stream; i++) {
+    jump();
+  }
+}
+
+int PRandom::nextInt(int n)
+{
+  // Lemire's multiply-shift with rejection of the biased low products.
+  uint32_t range = (uint32_t) n;
+  uint64_t m = (next() >> 32) * range;
+  uint32_t low = (uint32_t) m;
+  if (low < range) {
+    uint32_t threshold = (uint32_t) (-range) % range;
+    while (low < threshold) {
+      m = (next() >> 32) * range;
+      low = (uint32_t) m;
+    }
+  }
+  return (int) (m >> 32);
+}
+
+double PRandom::nextNormal()
+{
+  if (m_state.hasSpare) {
+    m_state.hasSpare = 0;
+    return m_state.spare;
+  }
+
+  // Marsaglia's polar method, the second deviate is kept for the next call.
+  double u, v, r;
+  do {
+    u = 2.0 * nextDouble() - 1.0;
+    v = 2.0 * nextDouble() - 1.0;
+    r = u * u + v * v;
+  } while (r >= 1.0 || r == 0.0);
+  double f = sqrt(-2.0 * log(r) / r);
+  m_state.spare = v * f;
+  m_state.hasSpare = 1;
+  return u * f;
+}
+
+void PRandom::fillUniform(double *values, int n)
+{
+  for (int i = 0; i < n; i++) {
+    values[i] = (next() >> 11) * (1.0 / 9007199254740992.0);
+  }
+}
+
+void PRandom::fillNormal(double *values, int n, double mean, double std)
+{
+  int i = 0;
+  for (; i + 1 < n; i += 2) {
+    double u, v, r;
+    do {
+      u = 2.0 * nextDouble() - 1.0;
+      v = 2.0 * nextDouble() - 1.0;
+      r = u * u + v * v;
+    } while (r >= 1.0 || r == 0.0);
+    double f = std * sqrt(-2.0 * log(r) / r);
+    values[i] = mean + u * f;
+    values[i + 1] = mean + v * f;
+  }
+  if (i < n) {
+    values[i] = nextNormal(mean, std);
+  }
+}
+
+void PRandom::jump()
+{
+  static const uint64_t JUMP[4] = { 0x180ec6d33cfd0abaULL, 0xd5a61266f0c9392cULL,
+                                    0xa9582618e03fc9aaULL, 0x39abdc4529b1661cULL };
+  uint64_t s[4] = { 0, 0, 0, 0 };
+  for (int i = 0; i < 4; i++) {
+    for (int b = 0; b < 64; b++) {
+      if (JUMP[i] & (1ULL << b)) {
+        for (int k = 0; k < 4; k++) {
+          s[k] ^= m_state.s[k];
+        }
+      }
+      next();
+    }
+  }
+  for (int k = 0; k < 4; k++) {
+    m_state.s[k] = s[k];
+  }
+}
+
+void PRandom::getState(PRandomState &state) const
+{
+  state = m_state;
+}
+
+void PRandom::setState(const PRandomState &state)
+{
+  m_state = state;
+}
+
+PRandom &PRandom::local()
+{
+  if (threadRandom == NULL) {
+    pthread_once(&threadKeyOnce, CreateThreadKey);
+    unsigned int stream = __sync_fetch_and_add(&nextStream, 1);
+    threadRandom = new PRandom(globalSeed, stream);
+    pthread_setspecific(threadKey, threadRandom);
+  }
+  return *threadRandom;
+}
+
+void PRandom::seedGlobal(uint64_t seed)
+{
+  globalSeed = seed;
+  local().seed(seed, 0);
+  nextStream = 1;
+}
@@ -0,0 +1,154 @@
+/*
+    LoopTK: Protein Loop Kinematic Toolkit
+    Copyright (C) 2007 Stanford University
+
+    This program is free software; you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation; either version 2 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License along
+    with this program; if not, write to the Free Software Foundation, Inc.,
+    51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+*/
+
+#ifndef PRANDOM_H
+#define PRANDOM_H
+
+#include <stdint.h>
+
+/**
+ * The complete state of a <code>PRandom</code> generator,
+ * so that a run can be saved and continued.
+ */
+struct PRandomState {
+  uint64_t s[4];
+  double spare;
+  int hasSpare;
+};
+
+//@package Utilities
+/**
+ * Random number generator used by all sampling code of
+ * <code>LoopTK</code>, based on xoshiro256** by Blackman
+ * and Vigna.  Every thread has its own generator, returned
+ * by <code>local()</code>, so threads never share or lock
+ * a random state.  A seed and a stream index define the
+ * sequence; different streams of the same seed are
+ * 2^128 draws apart and never overlap.
+ */
+
+class PRandom {
+  public:
+    /**
+     * Creates a generator for stream <code>stream</code>
+     * of seed <code>seed</code>.
+     */
+    PRandom(uint64_t seed = DEFAULT_SEED, unsigned int stream = 0);
+
+    /**
+     * Restarts the generator at stream <code>stream</code>
+     * of seed <code>seed</code>.
+     */
+    void seed(uint64_t seed, unsigned int stream = 0);
+
+    /**
+     * Returns 64 random bits.
+     */
+    inline uint64_t next() {
+      uint64_t result = rotl(m_state.s[1] * 5, 7) * 9;
+      uint64_t t = m_state.s[1] << 17;
+      m_state.s[2] ^= m_state.s[0];
+      m_state.s[3] ^= m_state.s[1];
+      m_state.s[1] ^= m_state.s[2];
+      m_state.s[0] ^= m_state.s[3];
+      m_state.s[2] ^= t;
+      m_state.s[3] = rotl(m_state.s[3], 45);
+      return result;
+    }
+
+    /**
+     * Returns a uniformly distributed integer
+     * in [0, <code>n</code>), <code>n</code> > 0.
+     */
+    int nextInt(int n);
+
+    /**
+     * Returns a uniformly distributed double in [0, 1).
+     */
+    inline double nextDouble() {
+      return (next() >> 11) * (1.0 / 9007199254740992.0);
+    }
+
+    /**
+     * Returns a uniformly distributed double
+     * in [<code>a</code>, <code>b</code>).
+     */
+    inline double nextDouble(double a, double b) {
+      return a + nextDouble() * (b - a);
+    }
+
+    /**
+     * Returns a normally distributed double
+     * with mean 0 and standard deviation 1.
+     */
+    double nextNormal();
+
+    /**
+     * Returns a normally distributed double with mean
+     * <code>mean</code> and standard deviation <code>std</code>.
+     */
+    inline double nextNormal(double mean, double std) {
+      return mean + std * nextNormal();
+    }
+
+    /**
+     * Fills <code>values</code> with <code>n</code>
+     * uniformly distributed doubles in [0, 1).
+     */
+    void fillUniform(double *values, int n);
+
+    /**
+     * Fills <code>values</code> with <code>n</code>
+     * normally distributed doubles.
+     */
+    void fillNormal(double *values, int n, double mean = 0, double std = 1);
+
+    /**
+     * Advances the generator by 2^128 draws.
+     */
+    void jump();
+
+    void getState(PRandomState &state) const;
+    void setState(const PRandomState &state);
+
+    /**
+     * Returns the generator of the calling thread.  The first
+     * thread to use it gets stream 0 of the global seed, every
+     * further thread the next unused stream.
+     */
+    static PRandom &local();
+
+    /**
+     * Sets the global seed, restarts the generator of the calling
+     * thread at stream 0 and makes threads that have not drawn
+     * yet start at stream 1, 2, ...
+     */
+    static void seedGlobal(uint64_t seed);
+
+    static const uint64_t DEFAULT_SEED = 1;
+
+  private:
+    static inline uint64_t rotl(uint64_t x, int k) {
+      return (x << k) | (x >> (64 - k));
+    }
+
+    PRandomState m_state;
+};
+
+#endif
@@ -76,6 +76,7 @@ void PResidueShell::addBlockConnection(const string &idDefined, const string &id
 PResidue::PResidue(PChain *loop, const string &shellName) {
 
 	this->type_sidechain = -1;
+  InitMoves();
 
   SetChain(loop);  
   m_shell = PResources::GetResidueShell(shellName);
@@ -89,6 +90,7 @@ PResidue::PResidue(PChain *loop, const string &shellName) {
 
 
 PResidue::PResidue(PChain *loop, const string &shellName, PResidueSpec &spec) {
+  InitMoves();
   m_shell = PResources::GetResidueShell(shellName);
   BuildWithPositions(loop,spec);
   EstablishLink(NULL);
@@ -99,6 +101,7 @@ PResidue::PResidue(PChain *loop, const string &shellName, PResidueSpec &spec) {
 
 
 PResidue::PResidue(PChain *loop, const string &shellName, PResidueSpec &spec, PResidue *toConnect) {
+  InitMoves();
   m_shell = PResources::GetResidueShell(shellName);
   BuildWithPositions(loop,spec);
   EstablishLink(toConnect);
@@ -171,6 +174,7 @@ void PResidue::BuildWithPositions(PChain *loop, const PResidueSpec &spec)
 }
 
 PResidue::PResidue(PChain *loop, const string &shellName, PResidue *toConnect) {
+  InitMoves();
   m_shell = PResources::GetResidueShell(shellName);
   PBlock *tail = toConnect->getTailBlock();
   SetChain(loop);
@@ -345,20 +349,17 @@ bool PResidue::applyRotamer(const int& index, const vector<double>& rotamer) {
 
 void PResidue::getChiAngles( vector<double>& chis) {
 	assert( chis.size() == 0);
-	unsigned chiMax = PResources::numChiIndices(this->getName());
-	vector<string> rotList;
-	for (unsigned i = 1; i <= chiMax; i++) {
-		//get the atoms used to define dihedral angles
-		rotList = PResources::GetChiIndex(this->getName(), i);
-		//calculate current dihedral angle (chi angle) and calculate the delta needed to achive the goal.
-		Real curDihedral = PMath::AngleBetweenPlanes(
-				this->getAtomPosition(rotList[0]),
-				this->getAtomPosition(rotList[1]),
-				this->getAtomPosition(rotList[2]),
-				this->getAtomPosition(rotList[3]));
-
-		chis.push_back( curDihedral);
+	if( m_chiMoves != m_moves) {
+		m_chis.clear();
+		calChi( m_chis);
+		m_chiMoves = m_moves;
 	}
+	chis = m_chis;
+}
+
+void PResidue::InitMoves() {
+  m_moves = 0;
+  m_chiMoves = (uint64_t)-1;
 }
 
 
@@ -420,7 +421,7 @@ void PResidue::RandomizeDOFs(const string &blockType) {
 void PResidue::RandomizeDOFs(const string &blockType, PChain *rootChain) {
   if (m_dofs.find(blockType)==m_dofs.end()) return;
   for(ID_To_DOF_Map::iterator it = m_dofs[blockType].begin();it!=m_dofs[blockType].end();++it) {
-    it->second->Rotate(forward,rand()%360,rootChain);
+    it->second->Rotate(forward,PRandom::local().nextInt(360),rootChain);
   }
 }
 
@@ -20,6 +20,7 @@
 #ifndef __P_RESIDUE_H
 #define __P_RESIDUE_H
 
+#include <stdint.h>
 #include "PEnums.h"
 #include "PResidueShell.h"
 #include "PResidueSpec.h"
@@ -88,8 +89,16 @@ class PResidue {
    * */
   bool applyRotamer( const int&, const vector<double>&);
 
+  //NOTE: The chi angles are cached until an atom of the residue moves.
   void getChiAngles( vector<double>& chis);
 
+  /**
+   * Count a change of an atom position of this residue; called by PAtom.
+   * Cached torsions depending on the residue compare the count they were computed at.
+   */
+  void atomMoved() { m_moves++; }
+  uint64_t getMoves() const { return m_moves; }
+
   /**
    * Yajia Zhang added
    * */
@@ -335,6 +344,7 @@ class PResidue {
  private:
 
   void EstablishLink(PResidue *prior);
+  void InitMoves();
   //these two functions are called by PChain:
   void SetChain(PChain *loop) { assert(loop != NULL); m_loop = loop; }
   //caches atoms, block types
@@ -383,6 +393,11 @@ class PResidue {
   typedef HASH_MAP_STR(vector<PBlock *>) BlockTypeCache;
   BlockTypeCache m_blockTypeCache; 
   HASH_MAP_STR(HASH_MAP_STRPAIR_OR(PBond *)) m_dofs;
+
+  // Number of atom moves, and the chi angles and the count they were computed at.
+  uint64_t m_moves;
+  uint64_t m_chiMoves;
+  vector<double> m_chis;
  public:
   //Yajia added, for indicating side chain type
   int type_sidechain;
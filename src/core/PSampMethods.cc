@@ -64,9 +64,9 @@ IKSolutions PSampMethods::PermuteIK(PProtein *loop, int num_wanted) {
 	IKSolutions ret;
 	while(1){
 		int loopsize = loop->size()-1;
-		Res_indices[2] = 2+(int)((loopsize-3)*(double)rand()/(RAND_MAX+1.0));
-		Res_indices[1] = 1+(int)((Res_indices[2]-1)*(double)rand()/(RAND_MAX+1.0));
-		Res_indices[0] = 0+(int)((Res_indices[1]-1)*(double)rand()/(RAND_MAX+1.0));
+		Res_indices[2] = 2+(int)((loopsize-3)*PRandom::local().nextDouble());
+		Res_indices[1] = 1+(int)((Res_indices[2]-1)*PRandom::local().nextDouble());
+		Res_indices[0] = 0+(int)((Res_indices[1]-1)*PRandom::local().nextDouble());
 		cout<<Res_indices[0]<<","<<Res_indices[1]<<","<<Res_indices[2]<<endl;
 		IKSolutions sols = PExactIKSolver::FindSolutions(loop,Res_indices);
 		for(int k=0;k<sols.size();k++){
@@ -184,7 +184,7 @@ double uniformSample (double A, double B) {
 
         double upper = (A>B?A:B);
         double lower = (A>B?B:A);
-        double i = rand()%100;
+        double i = PRandom::local().nextInt(100);
         return i*(upper-lower)/100+lower;
 }
 
@@ -192,15 +192,15 @@ double uniformSample (double A, double B) {
 double sampleAngle (const vector<double> &distri) {
         double angle=0;
         if (distri.size()<=1)
-                return (rand()%360)-180;
+                return PRandom::local().nextInt(360)-180;
         else {
-                double num = (rand()%10000)/(double)10000; // num is accurate up to 4 decimal points
+                double num = PRandom::local().nextInt(10000)/(double)10000; // num is accurate up to 4 decimal points
                 for (int i=0; i<distri.size(); ++i) {
                         if (num<=distri[i]) { // generate a angle value in interval i
                                 double lower = i*(360/(double)distri.size())-180;
                                 double upper = (i+1)*(360/(double)distri.size())-180;
                                 double range = upper-lower;
-                                angle = (rand()%10000)/(double)10000*range+lower;
+                                angle = PRandom::local().nextInt(10000)/(double)10000*range+lower;
                                 break;
                         }
                         else {
@@ -921,7 +921,7 @@ bool PSampMethods::IKClose (PProtein* move_loop, Vector3 endPriorG, Vector3 endG
                 for (int m=0; m<nC2; ++m)
                         visited[m] = false;
                 for (int m=1; no_sol && m<=nC2; ++m) {
-                        pattern_id = rand()%nC2;
+                        pattern_id = PRandom::local().nextInt(nC2);
                         if (visited[pattern_id]==true) {
                                 --m;
                                 continue;
@@ -933,7 +933,7 @@ bool PSampMethods::IKClose (PProtein* move_loop, Vector3 endPriorG, Vector3 endG
                         IKSolutions sols = PExactIKSolver::FindSolutions(move_loop,res_indices,&endPriorG,&endG,&endNextG);
 
                         if (sols.size()>0) {
-                                int sol_id = rand()%sols.size();
+                                int sol_id = PRandom::local().nextInt(sols.size());
                                 vector<ChainMove> sol = sols[sol_id];
                                 move_loop->MultiRotate(sol);
                                 no_sol = false;
@@ -1247,9 +1247,9 @@ vector<PProtein*> PSampMethods::SeedSampleBackboneLoopOnly (PProtein* original_p
                 if (split) {
                                 // Randomize the loop
                                 for (int i=0; i<2*frontLoop->size(); ++i)
-                                        frontLoop->RotateBackbone(i,forward,rand()%360);
+                                        frontLoop->RotateBackbone(i,forward,PRandom::local().nextInt(360));
                                 for (int i=0; i<2*backLoop->size(); ++i)
-                                        backLoop->RotateBackbone(i,backward,rand()%360);
+                                        backLoop->RotateBackbone(i,backward,PRandom::local().nextInt(360));
 
                                 // Generate new initial forward and backward ends
                                 loop->inactivateResidue(0,loop->size()-1);
@@ -1300,7 +1300,7 @@ vector<PProtein*> PSampMethods::SeedSampleBackboneLoopOnly (PProtein* original_p
                                 cm.blockType = PID::BACKBONE;
                                 cm.dir = forward;
                                 cm.DOF_index = j;
-                                cm.degrees = rand()%360;
+                                cm.degrees = PRandom::local().nextInt(360);
                                 cms.push_back(cm);
                         }
                         move_loop->MultiRotate(cms);
@@ -1402,9 +1402,9 @@ vector<PProtein*> PSampMethods::SeedSampleBackboneLoopOnly (PProtein* original_p
                 if (split) {
                                 // Randomize the loop
                                 for (int i=0; i<2*frontLoop->size(); ++i)
-                                        frontLoop->RotateBackbone(i,forward,rand()%360);
+                                        frontLoop->RotateBackbone(i,forward,PRandom::local().nextInt(360));
                                 for (int i=0; i<2*backLoop->size(); ++i)
-                                        backLoop->RotateBackbone(i,backward,rand()%360);
+                                        backLoop->RotateBackbone(i,backward,PRandom::local().nextInt(360));
 
                                 // Generate new initial forward and backward ends
 				loop->inactivateResidue(0,loop->size()-1);
@@ -1632,9 +1632,9 @@ vector<PProtein*> PSampMethods::SeedSampleBackboneWithSidechainLoopOnly (PProtei
                 if (split) {
                                 // Randomize the loop
                                 for (int i=0; i<2*frontLoop->size(); ++i)
-                                        frontLoop->RotateBackbone(i,forward,rand()%360);
+                                        frontLoop->RotateBackbone(i,forward,PRandom::local().nextInt(360));
                                 for (int i=0; i<2*backLoop->size(); ++i)
-                                        backLoop->RotateBackbone(i,backward,rand()%360);
+                                        backLoop->RotateBackbone(i,backward,PRandom::local().nextInt(360));
 
                                 // Generate new initial forward and backward ends
                                 loop->inactivateResidue(0,loop->size()-1);
@@ -1686,7 +1686,7 @@ vector<PProtein*> PSampMethods::SeedSampleBackboneWithSidechainLoopOnly (PProtei
                                 cm.blockType = PID::BACKBONE;
                                 cm.dir = forward;
                                 cm.DOF_index = j;
-                                cm.degrees = rand()%360;
+                                cm.degrees = PRandom::local().nextInt(360);
                                 cms.push_back(cm);
                         }
                         move_loop->MultiRotate(cms);
@@ -1808,9 +1808,9 @@ vector<PProtein*> PSampMethods::SeedSampleBackboneWithSidechainLoopOnly (PProtei
                 if (split) {
                                 // Randomize the loop
                                 for (int i=0; i<2*frontLoop->size(); ++i)
-                                        frontLoop->RotateBackbone(i,forward,rand()%360);
+                                        frontLoop->RotateBackbone(i,forward,PRandom::local().nextInt(360));
                                 for (int i=0; i<2*backLoop->size(); ++i)
-                                        backLoop->RotateBackbone(i,backward,rand()%360);
+                                        backLoop->RotateBackbone(i,backward,PRandom::local().nextInt(360));
 
                                 // Generate new initial forward and backward ends
 				loop->inactivateResidue(0,loop->size()-1);
@@ -2052,7 +2052,7 @@ PResidue *lastRes = loop->getResidue(loop->size()-1);
         while (not_found) {
                 // Randomize the loop	
 		for (int i=0; i<2*loop->size(); ++i) 
-			loop->RotateBackbone(i,forward,rand()%360);
+			loop->RotateBackbone(i,forward,PRandom::local().nextInt(360));
                 // Find the way to close the loop while keep N and Cb as close to target as possible
                 IKSolutions min_sol;
                 int res_indices[3];
@@ -39,19 +39,17 @@ typedef  	struct	p {
   double	coef[MAX_ORDER+1];
 } poly;
 
+/*
+ * The solver state (termination criteria) used to live in file-scope globals,
+ * which made the solver non-reentrant. It is now held by a PSturmSolver
+ * instance so that every caller (or thread) can own one.
+ */
+class PSturmSolver {
+ public:
 double RELERROR;
 int MAXIT, MAX_ITER_SECANT;
 
-void initialize_sturm(double *tol_secant, int *max_iter_sturm, int *max_iter_secant);
-void solve_sturm(int *p_order, int *n_root, double *poly_coeffs, double *roots);
-double hyper_tan(double a, double x);
-static int modp(poly *u, poly *v, poly *r);
-int buildsturm(int ord, poly *sseq);
-int numroots(int np, poly *sseq, int *atneg, int *atpos);
-int numchanges(int np, poly *sseq, double a);
-void sbisect(int np, poly *sseq, double min, double max, int atmin, int atmax, double *roots);
-double evalpoly(int ord, double *coef, double x);
-int modrf(int ord, double *coef, double	a, double b, double *val);
+PSturmSolver() : RELERROR(1.0e-15), MAXIT(100), MAX_ITER_SECANT(20) {}
 	
 /* set termination criteria for polynomial solver */
 void initialize_sturm(double *tol_secant, int *max_iter_sturm, int *max_iter_secant)
@@ -208,7 +206,7 @@ double hyper_tan(double a, double x)
     }
 }
 
-static int modp(poly *u, poly *v, poly *r)
+int modp(poly *u, poly *v, poly *r)
 //	poly *u, *v, *z;
 {
 	int		k, j;
@@ -611,4 +609,4 @@ int modrf(int ord, double *coef, double	a, double b, double *val)
 
   return(0);
 }
-
+};
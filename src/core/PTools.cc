@@ -610,7 +610,7 @@ void PTools::RandomNullSpacePerturb(PProtein *lp, vector<vector<CDof> > Dofs, do
 	double yb[loopsize+1];
 	
 	for(int j=1;j<=loopsize;j++)
-		yb[j]=((double)rand()/(double)RAND_MAX)*pert_mag-(pert_mag)/2.0;
+		yb[j]=PRandom::local().nextDouble()*pert_mag-(pert_mag)/2.0;
 		
 	PTools::ProjectOnNullSpace(lp,JacInd, true, yb, derivb);
 	for(int j=0;j<Dofs[i].size();j++)
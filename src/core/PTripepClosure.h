@@ -73,12 +73,24 @@
   #define rad2deg 180.0e0/pi
   #define max(a,b) ((a) > (b))? (a) : (b)
   #define min(a,b) ((a) < (b))? (a) : (b)
+
+/*
+ * The module variables of the original Fortran code used to be file-scope
+ * globals, so only one closure could be solved at a time in the whole
+ * process. They are now members of PTripepClosure: each caller owns a
+ * solver context (cheap to create on the stack) and contexts can be used
+ * concurrently from different threads.
+ */
+class PTripepClosure {
+ public:
 //  integer, parameter :: max_soln = 16
-  int max_soln = 16;
+  static const int max_soln = 16;
 //  integer, parameter :: deg_pol = 16
-  int deg_pol = 16;
+  static const int deg_pol = 16;
 //  integer, parameter :: print_level = 0
-  int print_level = 1;
+  static const int print_level = 1;
+//  ! polynomial root finder used by solve_3pep_poly
+  PSturmSolver sturm;
 //  ! parameters for tripeptide loop (including bond lengths & angles)
 //  real(dp) :: len0(6), b_ang0(7), t_ang0(2)
   double len0[6], b_ang0[7], t_ang0[2];
@@ -105,30 +117,6 @@
   double Q[5][17], R[3][17];
 //CONTAINS
 
-///////////////////////////////////////////////////////////////////////////////////////
-double dot_product(double va[], double vb[]);
-void matmul(double ma[3][3], double mb[3], double mc[3]);
-double sign(double a, double b);
-void solve_3pep_poly(double r_n1[3], double r_a1[3], double r_a3[3], double r_c3[3], double r_soln_n[16][3][3], double r_soln_a[16][3][3], double r_soln_c[16][3][3], int *n_soln, int& solution_selection);
-void initialize_loop_closure(double b_len[], double b_ang[], double t_ang[]);
-void get_input_angles(int *n_soln, double r_n1[], double r_a1[], double r_a3[], double r_c3[]);
-void test_two_cone_existence_soln(double tt, double kx, double et, double ap, int *n_soln, char cone_type[]);
-void get_poly_coeff(double poly_coeff[]);
-void poly_mul_sub2(double u1[5][5], double u2[5][5], double u3[5][5], double u4[5][5], int p1[2], int p2[2], int p3[2], int p4[2], double u5[5][5], int p5[2]);
-void poly_mul2(double u1[5][5], double u2[5][5], int p1[2], int p2[2], double u3[5][5], int p3[2]);
-void poly_sub2(double u1[5][5], double u2[5][5], int p1[2], int p2[2], double u3[5][5], int p3[2]);
-void poly_mul_sub1(double u1[17], double u2[17], double u3[17], double u4[17], int p1, int p2, int p3, int p4, double u5[17], int *p5);
-void poly_mul1(double u1[], double u2[], int p1, int p2, double u3[], int *p3);
-void poly_sub1(double u1[], double u2[], int p1, int p2, double u3[], int *p3);
-void coord_from_poly_roots(int *n_soln, double roots[16], double r_n1[3], double r_a1[3], double r_a3[3], double r_c3[3], double r_soln_n[16][3][3], double r_soln_a[16][3][3], double r_soln_c[16][3][3], int& solution_selection);
-double calc_t2(double t0);
-double calc_t1(double t0, double t2);
-void calc_dih_ang(double r1[], double r2[], double r3[], double *angle);
-void calc_bnd_ang(double r1[], double r2[], double *angle);
-void cross(double p[], double q[], double s[]);
-void quaternion(double axis[], double quarter_ang, double p[]);
-void rotation_matrix(double q[4], double U[3][3]);
-////////////////////////////////////////////////////////////////////////////////////////////
 
 double dot_product(double va[3], double vb[3])
 {
@@ -180,7 +168,8 @@ void solve_3pep_poly(double r_n1[3], double r_a1[3], double r_a3[3], double r_c3
   get_poly_coeff(poly_coeff);
 
 //  call solve_sturm(deg_pol, n_soln, poly_coeff, roots)
-  solve_sturm(&deg_pol, n_soln, poly_coeff, roots);
+  int order = deg_pol;
+  sturm.solve_sturm(&order, n_soln, poly_coeff, roots);
 
 //  if (n_soln == 0) then
 //!     print*, 'return 2'
@@ -229,7 +218,7 @@ void initialize_loop_closure(double b_len[6], double b_ang[7], double t_ang[2])
   int i, j;
   
 //  call initialize_sturm(tol_secant, max_iter_sturm, max_iter_secant)
-  initialize_sturm(&tol_secant, &max_iter_sturm, &max_iter_secant);
+  sturm.initialize_sturm(&tol_secant, &max_iter_sturm, &max_iter_secant);
 
 //  len0(1:6) = b_len(1:6)
   for(i=0;i<6;i++)
@@ -1294,7 +1283,7 @@ void coord_from_poly_roots(int *n_soln, double roots[16], double r_n1[3], double
   //NOTE: Yajia: I changed here!
 
 //  for(i_soln=0;i_soln<*n_soln;i_soln++)
-  solution_selection = rand() % *n_soln;
+  solution_selection = PRandom::local().nextInt(*n_soln);
   i_soln = solution_selection;
    {
 //     half_tan(3) = roots(i_soln)
@@ -1770,6 +1759,7 @@ void rotation_matrix(double q[4], double U[3][3])
   return;
 //end subroutine rotation_matrix
  }
+};
 //!----------------------------------------------------------------------------
 //END MODULE tripep_closure
 //!----------------------------------------------------------------------------
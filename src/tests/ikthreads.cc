@@ -0,0 +1,100 @@
+#include "PExtension.h"
+#include "PLibraries.h"
+#include "PIKAlgorithms.h"
+#include "PChain.h"
+#include "PBasic.h"
+#include <assert.h>
+#include <pthread.h>
+
+/*
+ * Stress test for the reentrant tripeptide closure solver: many threads
+ * call PExactIKSolver::FindSolutions at the same time, each on its own
+ * copy of the protein, and must get the same number of solutions as a
+ * single-threaded run on the same perturbed blocks.
+ */
+
+static const int kNumThreads = 16;
+static const int kNumBlocks = 8;
+static const int kNumPerturbations = 36;
+static const int kFirstResidue = 10;
+
+struct IKTask {
+  PProtein *protein;
+  vector<PProtein *> blocks;
+  vector<int> numSolutions;
+};
+
+/*
+ * Perturbs the first backbone DOF of every block and counts the IK solutions
+ * that close it back onto its original end effectors.
+ */
+void CountSolutions(IKTask *task)
+{
+  task->numSolutions.clear();
+  for(int b = 0; b < kNumBlocks; b++) {
+    PProtein *block = task->blocks[b];
+    int indices[3] = {1, 2, 3};
+    Vector3 endPriorG = block->getAtomAtRes(PID::C_ALPHA, 3)->getPos();
+    Vector3 endG = block->getAtomAtRes(PID::C, 3)->getPos();
+    Vector3 endNextG = block->getAtomAtRes(PID::O, 3)->getPos();
+
+    for(int k = 0; k < kNumPerturbations; k++) {
+      PChainState *state = block->saveChainState();
+      block->RotateChain_noGridUpdate(PID::BACKBONE, 1, forward, 10.0 * k);
+      IKSolutions solutions;
+      int n = PExactIKSolver::FindSolutions(block, indices, &endPriorG, &endG, &endNextG, solutions);
+      task->numSolutions.push_back(n);
+      block->restoreChainState_noGridUpdate(state);
+      delete state;
+    }
+  }
+}
+
+void *IKWorker(void *arg)
+{
+  CountSolutions((IKTask *) arg);
+  return NULL;
+}
+
+void LoadTask(IKTask *task, const string &fileName)
+{
+  task->protein = PDBIO::readFromFile(fileName);
+  for(int b = 0; b < kNumBlocks; b++) {
+    int start = kFirstResidue + 4 * b;
+    task->blocks.push_back(new PProtein(task->protein, start, start + 3));
+  }
+}
+
+int main() {
+  LoopTK::Initialize(SUPPRESS_WARNINGS);
+
+  string fileName = "pdbfiles/2CRO.pdb";
+
+  IKTask reference;
+  LoadTask(&reference, fileName);
+  CountSolutions(&reference);
+
+  IKTask tasks[kNumThreads];
+  pthread_t threads[kNumThreads];
+  for(int t = 0; t < kNumThreads; t++) {
+    LoadTask(&tasks[t], fileName);
+  }
+  for(int t = 0; t < kNumThreads; t++) {
+    if (pthread_create(&threads[t], NULL, IKWorker, &tasks[t]) != 0) {
+      PUtilities::AbortProgram("Error: could not create an IK thread.");
+    }
+  }
+  for(int t = 0; t < kNumThreads; t++) {
+    pthread_join(threads[t], NULL);
+  }
+
+  for(int t = 0; t < kNumThreads; t++) {
+    if (tasks[t].numSolutions != reference.numSolutions) {
+      PUtilities::AbortProgram("Error: concurrent IK closure disagrees with the sequential run.");
+    }
+    delete tasks[t].protein;
+  }
+  delete reference.protein;
+
+  return 0;
+}
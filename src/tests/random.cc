@@ -0,0 +1,100 @@
+#include "PExtension.h"
+#include "PLibraries.h"
+#include "PBasic.h"
+#include <assert.h>
+#include <pthread.h>
+
+/*
+ * Tests for PRandom: reproducible sequences, independent streams,
+ * state save/restore, ranges and moments of the distributions, and
+ * one generator per thread.
+ */
+
+static const int kNumDraws = 200000;
+static const int kNumThreads = 8;
+
+void *DrawFirst(void *arg)
+{
+  *(uint64_t *) arg = PRandom::local().next();
+  return NULL;
+}
+
+int main() {
+  // The same seed and stream give the same sequence, other streams differ.
+  PRandom a(42), b(42), c(42, 1), d(43);
+  for (int i = 0; i < 1000; i++) {
+    uint64_t x = a.next();
+    assert(x == b.next());
+    assert(x != c.next());
+    assert(x != d.next());
+  }
+
+  // Restoring a saved state continues the sequence, including the spare normal deviate.
+  a.nextNormal();
+  PRandomState state;
+  a.getState(state);
+  double expected[3] = { a.nextNormal(), a.nextDouble(), (double) a.nextInt(7) };
+  b.setState(state);
+  assert(b.nextNormal() == expected[0]);
+  assert(b.nextDouble() == expected[1]);
+  assert(b.nextInt(7) == expected[2]);
+
+  // Ranges and moments.
+  PRandom r(7);
+  vector<int> counts(10, 0);
+  double sum = 0, sumsq = 0;
+  for (int i = 0; i < kNumDraws; i++) {
+    int k = r.nextInt(10);
+    assert(k >= 0 && k < 10);
+    counts[k]++;
+    double u = r.nextDouble();
+    assert(u >= 0 && u < 1);
+    sum += u;
+  }
+  assert(fabs(sum / kNumDraws - 0.5) < 0.01);
+  for (int k = 0; k < 10; k++) {
+    assert(fabs(counts[k] / (double) kNumDraws - 0.1) < 0.01);
+  }
+
+  vector<double> normals(kNumDraws + 1);
+  r.fillNormal(&normals[0], normals.size(), 2.0, 3.0);
+  sum = 0;
+  for (unsigned i = 0; i < normals.size(); i++) {
+    sum += normals[i];
+    sumsq += normals[i] * normals[i];
+  }
+  double mean = sum / normals.size();
+  double var = sumsq / normals.size() - mean * mean;
+  assert(fabs(mean - 2.0) < 0.05);
+  assert(fabs(var - 9.0) < 0.2);
+
+  vector<double> uniforms(1000);
+  r.fillUniform(&uniforms[0], uniforms.size());
+  for (unsigned i = 0; i < uniforms.size(); i++) {
+    assert(uniforms[i] >= 0 && uniforms[i] < 1);
+  }
+
+  // Every thread draws from its own stream.
+  PRandom::seedGlobal(5);
+  uint64_t first[kNumThreads];
+  pthread_t threads[kNumThreads];
+  for (int t = 0; t < kNumThreads; t++) {
+    if (pthread_create(&threads[t], NULL, DrawFirst, &first[t]) != 0) {
+      PUtilities::AbortProgram("Error: could not create a thread.");
+    }
+  }
+  for (int t = 0; t < kNumThreads; t++) {
+    pthread_join(threads[t], NULL);
+  }
+  PRandom reference(5);
+  uint64_t mainFirst = reference.next();
+  assert(PRandom::local().next() == mainFirst);
+  for (int t = 0; t < kNumThreads; t++) {
+    assert(first[t] != mainFirst);
+    for (int u = 0; u < t; u++) {
+      assert(first[t] != first[u]);
+    }
+  }
+
+  return 0;
+}
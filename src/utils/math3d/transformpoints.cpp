@@ -0,0 +1,138 @@
+/*
+    LoopTK: Protein Loop Kinematic Toolkit
+    Copyright (C) 2007 Stanford University
+
+    This program is free software; you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation; either version 2 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License along
+    with this program; if not, write to the Free Software Foundation, Inc.,
+    51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+*/
+
+#include "transformpoints.h"
+
+#if !defined(MATH_DOUBLE) && defined(__GNUC__) && (defined(__x86_64__) || defined(__i386__)) \
+  && (__GNUC__ > 4 || (__GNUC__ == 4 && __GNUC_MINOR__ >= 9))
+//the vector kernels are compiled for their own instruction sets and
+//only called when the processor supports them
+#define MATH3D_TRANSFORMPOINTS_SIMD
+#include <immintrin.h>
+#endif
+
+namespace Math3D {
+
+typedef void (*TransformPointsFunction)(const RigidTransform&,
+					const Real*,const Real*,const Real*,
+					Real*,Real*,Real*,int);
+
+void TransformPointsScalar(const RigidTransform& T,
+			   const Real* x,const Real* y,const Real* z,
+			   Real* xout,Real* yout,Real* zout,int n)
+{
+  const Matrix3& R=T.R;
+  Real r00=R(0,0),r01=R(0,1),r02=R(0,2);
+  Real r10=R(1,0),r11=R(1,1),r12=R(1,2);
+  Real r20=R(2,0),r21=R(2,1),r22=R(2,2);
+  Real t0=T.t.x,t1=T.t.y,t2=T.t.z;
+  for(int i=0;i<n;i++) {
+    Real px=x[i],py=y[i],pz=z[i];
+    xout[i] = r00*px + r01*py + r02*pz + t0;
+    yout[i] = r10*px + r11*py + r12*pz + t1;
+    zout[i] = r20*px + r21*py + r22*pz + t2;
+  }
+}
+
+#ifdef MATH3D_TRANSFORMPOINTS_SIMD
+
+__attribute__((target("sse")))
+static void TransformPointsSSE(const RigidTransform& T,
+			       const Real* x,const Real* y,const Real* z,
+			       Real* xout,Real* yout,Real* zout,int n)
+{
+  const Matrix3& R=T.R;
+  __m128 r00=_mm_set1_ps(R(0,0)),r01=_mm_set1_ps(R(0,1)),r02=_mm_set1_ps(R(0,2));
+  __m128 r10=_mm_set1_ps(R(1,0)),r11=_mm_set1_ps(R(1,1)),r12=_mm_set1_ps(R(1,2));
+  __m128 r20=_mm_set1_ps(R(2,0)),r21=_mm_set1_ps(R(2,1)),r22=_mm_set1_ps(R(2,2));
+  __m128 t0=_mm_set1_ps(T.t.x),t1=_mm_set1_ps(T.t.y),t2=_mm_set1_ps(T.t.z);
+  int i=0;
+  for(;i+4<=n;i+=4) {
+    __m128 px=_mm_loadu_ps(x+i),py=_mm_loadu_ps(y+i),pz=_mm_loadu_ps(z+i);
+    //same order of operations as the scalar kernel
+    __m128 ox=_mm_add_ps(_mm_add_ps(_mm_add_ps(_mm_mul_ps(r00,px),_mm_mul_ps(r01,py)),_mm_mul_ps(r02,pz)),t0);
+    __m128 oy=_mm_add_ps(_mm_add_ps(_mm_add_ps(_mm_mul_ps(r10,px),_mm_mul_ps(r11,py)),_mm_mul_ps(r12,pz)),t1);
+    __m128 oz=_mm_add_ps(_mm_add_ps(_mm_add_ps(_mm_mul_ps(r20,px),_mm_mul_ps(r21,py)),_mm_mul_ps(r22,pz)),t2);
+    _mm_storeu_ps(xout+i,ox);
+    _mm_storeu_ps(yout+i,oy);
+    _mm_storeu_ps(zout+i,oz);
+  }
+  TransformPointsScalar(T,x+i,y+i,z+i,xout+i,yout+i,zout+i,n-i);
+}
+
+__attribute__((target("avx")))
+static void TransformPointsAVX(const RigidTransform& T,
+			       const Real* x,const Real* y,const Real* z,
+			       Real* xout,Real* yout,Real* zout,int n)
+{
+  const Matrix3& R=T.R;
+  __m256 r00=_mm256_set1_ps(R(0,0)),r01=_mm256_set1_ps(R(0,1)),r02=_mm256_set1_ps(R(0,2));
+  __m256 r10=_mm256_set1_ps(R(1,0)),r11=_mm256_set1_ps(R(1,1)),r12=_mm256_set1_ps(R(1,2));
+  __m256 r20=_mm256_set1_ps(R(2,0)),r21=_mm256_set1_ps(R(2,1)),r22=_mm256_set1_ps(R(2,2));
+  __m256 t0=_mm256_set1_ps(T.t.x),t1=_mm256_set1_ps(T.t.y),t2=_mm256_set1_ps(T.t.z);
+  int i=0;
+  for(;i+8<=n;i+=8) {
+    __m256 px=_mm256_loadu_ps(x+i),py=_mm256_loadu_ps(y+i),pz=_mm256_loadu_ps(z+i);
+    __m256 ox=_mm256_add_ps(_mm256_add_ps(_mm256_add_ps(_mm256_mul_ps(r00,px),_mm256_mul_ps(r01,py)),_mm256_mul_ps(r02,pz)),t0);
+    __m256 oy=_mm256_add_ps(_mm256_add_ps(_mm256_add_ps(_mm256_mul_ps(r10,px),_mm256_mul_ps(r11,py)),_mm256_mul_ps(r12,pz)),t1);
+    __m256 oz=_mm256_add_ps(_mm256_add_ps(_mm256_add_ps(_mm256_mul_ps(r20,px),_mm256_mul_ps(r21,py)),_mm256_mul_ps(r22,pz)),t2);
+    _mm256_storeu_ps(xout+i,ox);
+    _mm256_storeu_ps(yout+i,oy);
+    _mm256_storeu_ps(zout+i,oz);
+  }
+  TransformPointsSSE(T,x+i,y+i,z+i,xout+i,yout+i,zout+i,n-i);
+}
+
+#endif //MATH3D_TRANSFORMPOINTS_SIMD
+
+static TransformPointsFunction SelectTransformPoints(const char** name)
+{
+#ifdef MATH3D_TRANSFORMPOINTS_SIMD
+  __builtin_cpu_init();
+  if(__builtin_cpu_supports("avx")) { *name="avx"; return TransformPointsAVX; }
+  if(__builtin_cpu_supports("sse")) { *name="sse"; return TransformPointsSSE; }
+#endif
+  *name="scalar";
+  return TransformPointsScalar;
+}
+
+//selected on first use, so that it can be used by static initializers
+static TransformPointsFunction GetTransformPoints(const char** name=NULL)
+{
+  static const char* selectedName=NULL;
+  static TransformPointsFunction selected=SelectTransformPoints(&selectedName);
+  if(name) *name=selectedName;
+  return selected;
+}
+
+void TransformPoints(const RigidTransform& T,
+		     const Real* x,const Real* y,const Real* z,
+		     Real* xout,Real* yout,Real* zout,int n)
+{
+  GetTransformPoints()(T,x,y,z,xout,yout,zout,n);
+}
+
+const char* TransformPointsKernel()
+{
+  const char* name;
+  GetTransformPoints(&name);
+  return name;
+}
+
+} //namespace Math3D
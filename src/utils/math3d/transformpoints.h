@@ -0,0 +1,59 @@
+/*
+    LoopTK: Protein Loop Kinematic Toolkit
+    Copyright (C) 2007 Stanford University
+
+    This program is free software; you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation; either version 2 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License along
+    with this program; if not, write to the Free Software Foundation, Inc.,
+    51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+*/
+
+#ifndef MATH3D_TRANSFORMPOINTS_H
+#define MATH3D_TRANSFORMPOINTS_H
+
+#include "primitives.h"
+
+/** @file math3d/transformpoints.h
+ * @ingroup Math3D
+ * @brief Rigid transforms of blocks of points.
+ */
+
+namespace Math3D {
+  /** @addtogroup Math3D */
+  /*@{*/
+
+/** @brief Applies the rigid transform T to n points stored as a
+ * structure of arrays: (xout[i],yout[i],zout[i]) = T*(x[i],y[i],z[i]).
+ *
+ * The output arrays may be the input arrays.  With single precision
+ * Reals the points are transformed 8 at a time with AVX or 4 at a time
+ * with SSE, whichever the processor supports; otherwise one at a time.
+ * All kernels give the same results as RigidTransform::mulPoint up to
+ * rounding.
+ */
+void TransformPoints(const RigidTransform& T,
+		     const Real* x,const Real* y,const Real* z,
+		     Real* xout,Real* yout,Real* zout,int n);
+
+/// Name of the kernel TransformPoints uses on this processor:
+/// "avx", "sse" or "scalar".
+const char* TransformPointsKernel();
+
+/// Same as TransformPoints, always one point at a time.
+void TransformPointsScalar(const RigidTransform& T,
+			   const Real* x,const Real* y,const Real* z,
+			   Real* xout,Real* yout,Real* zout,int n);
+
+  /*@}*/
+} //namespace Math3D
+
+#endif